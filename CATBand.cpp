@@ -0,0 +1,94 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   CAT Band - the IC-746's amateur bands, and the band of a frequency
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***************************************************************************/
+
+#include "Arduino.h"
+#include "CATBand.h"
+
+#define xx  CAT_BAND_NONE
+
+struct CATBandTable {
+  // IARU region 2, as the US IC-746 - edit a band here and the slots below with it
+  static constexpr CATBandEdge bands[CAT_BANDS] PROGMEM = {
+    //  low         high        code
+    {   1800000UL,   2000000UL, 0x01},   // 160 m
+    {   3500000UL,   4000000UL, 0x02},   // 80 m
+    {   7000000UL,   7300000UL, 0x03},   // 40 m
+    {  10100000UL,  10150000UL, 0x04},   // 30 m
+    {  14000000UL,  14350000UL, 0x05},   // 20 m
+    {  18068000UL,  18168000UL, 0x06},   // 17 m
+    {  21000000UL,  21450000UL, 0x07},   // 15 m
+    {  24890000UL,  24990000UL, 0x08},   // 12 m
+    {  28000000UL,  29700000UL, 0x09},   // 10 m
+    {  50000000UL,  54000000UL, 0x10},   // 6 m
+    { 144000000UL, 148000000UL, 0x11},   // 2 m
+  };
+
+  // The band reaching into each slot of 2^CAT_BAND_SHIFT Hz
+  static constexpr byte slots[CAT_BAND_SLOTS] PROGMEM = {
+     0,  1, xx,  2,  3, xx,  4, xx,  5, xx,  6,  7,    //   0 -  25 MHz
+    xx,  8,  8, xx, xx, xx, xx, xx, xx, xx, xx,  9,    //  25 -  50 MHz
+     9,  9, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx,    //  50 -  75 MHz
+    xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx,    //  75 - 100 MHz
+    xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx,    // 100 - 126 MHz
+    xx, xx, xx, xx, xx, xx, xx, xx, 10, 10, 10,        // 126 - 149 MHz
+  };
+
+  // slot s holds band b exactly when band b reaches into it
+  static constexpr boolean reaches(int b, int s) {
+    return (bands[b].low >> CAT_BAND_SHIFT) <= CATFreq(s) && CATFreq(s) <= (bands[b].high >> CAT_BAND_SHIFT);
+  }
+  static constexpr boolean slotOk(int s, int b) {
+    return b == CAT_BANDS || (reaches(b, s) == (slots[s] == b) && slotOk(s, b + 1));
+  }
+  static constexpr boolean valid(int s) {
+    return s == CAT_BAND_SLOTS || (slotOk(s, 0) && valid(s + 1));
+  }
+};
+
+#undef xx
+
+constexpr CATBandEdge CATBandTable::bands[CAT_BANDS];
+constexpr byte CATBandTable::slots[CAT_BAND_SLOTS];
+
+static_assert((CATBandTable::bands[CAT_BANDS - 1].high >> CAT_BAND_SHIFT) < CAT_BAND_SLOTS, "CAT band slots too few");
+static_assert(CATBandTable::valid(0), "CAT band slots do not match the bands");
+
+byte catBand(CATFreq freq) {
+  unsigned long slot;
+  CATBandEdge edge;
+  byte band;
+
+  if (freq >= CATFreq(CAT_BAND_SLOTS) << CAT_BAND_SHIFT) return CAT_BAND_NONE;
+  slot = (unsigned long)freq >> CAT_BAND_SHIFT;    // below 2^28 - a 32 bit shift
+  band = pgm_read_byte(&CATBandTable::slots[slot]);
+  if (band == CAT_BAND_NONE) return CAT_BAND_NONE;
+  memcpy_P(&edge, &CATBandTable::bands[band], sizeof(edge));
+  return freq >= edge.low && freq <= edge.high ? band : CAT_BAND_NONE;
+}
+
+void catBandEdge(byte band, CATBandEdge &edge) {
+  memcpy_P(&edge, &CATBandTable::bands[band], sizeof(edge));
+}
+
+byte catBandOfCode(byte code) {
+  for (byte band = 0; band < CAT_BANDS; band++) {
+    if (pgm_read_byte(&CATBandTable::bands[band].code) == code) return band;
+  }
+  return CAT_BAND_NONE;
+}
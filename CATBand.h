@@ -0,0 +1,68 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   CAT Band - the IC-746's amateur bands, and the band of a frequency
+
+   The band of a frequency is found without a search: the frequency shifted
+   right by CAT_BAND_SHIFT (2.097 MHz slots) indexes a table, made once by
+   hand and checked by the compiler, that holds the one band reaching into
+   each slot, if any.  Two compares against that band's edges finish the job,
+   cheap enough for every set frequency.
+
+   Bands are numbered in frequency order, CAT_BAND_160M to CAT_BAND_2M.  Each
+   has the code the IC-746 uses for it in the band stacking register command
+   (1A 01) - 01 to 11, in BCD.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ * **************************************************************************/
+
+#ifndef CATBand_h
+#define CATBand_h
+
+#include <Arduino.h>
+#include "CATBcd.h"
+
+#define CAT_BAND_160M       0
+#define CAT_BAND_80M        1
+#define CAT_BAND_40M        2
+#define CAT_BAND_30M        3
+#define CAT_BAND_20M        4
+#define CAT_BAND_17M        5
+#define CAT_BAND_15M        6
+#define CAT_BAND_12M        7
+#define CAT_BAND_10M        8
+#define CAT_BAND_6M         9
+#define CAT_BAND_2M         10
+#define CAT_BANDS           11
+#define CAT_BAND_NONE       0xFF    // outside every band
+
+#define CAT_BAND_SHIFT      21      // slot of a frequency - 2.097 MHz, no slot holds two bands
+#define CAT_BAND_SLOTS      71      // up to the top of 2 m
+
+struct CATBandEdge {
+  CATFreq low;              // Hz, both edges in the band
+  CATFreq high;
+  byte code;                // IC-746 band code, BCD
+};
+
+// The band of freq, CAT_BAND_NONE outside every band
+byte catBand(CATFreq freq);
+
+// Edges and code of a band, band < CAT_BANDS
+void catBandEdge(byte band, CATBandEdge &edge);
+
+// The band with an IC-746 band code, CAT_BAND_NONE if there is none
+byte catBandOfCode(byte code);
+
+#endif
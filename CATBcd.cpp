@@ -0,0 +1,147 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   CAT BCD - frequency to / from CI-V BCD without division
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***************************************************************************/
+
+#include "Arduino.h"
+#include "CATBcd.h"
+
+//
+// One decimal digit of *x by binary search: try subtracting 8p, 4p, 2p and p in turn.
+//
+static inline byte digit64(uint64_t *x, uint64_t p) {
+  byte digit = 0;
+  if (*x >= (p << 3)) { *x -= p << 3; digit += 8; }
+  if (*x >= (p << 2)) { *x -= p << 2; digit += 4; }
+  if (*x >= (p << 1)) { *x -= p << 1; digit += 2; }
+  if (*x >= p)        { *x -= p;      digit += 1; }
+  return digit;
+}
+
+//
+// Two digits (0-99) to one BCD byte.  x/10 == (x*205)>>11 for every x below 1029.
+//
+static inline byte pairBCD(byte x) {
+  byte tens = (unsigned int)(x * 205U) >> 11;
+  return (tens << 4) | (x - tens * 10);
+}
+
+//
+// Four digits (0-9999) to two BCD bytes.  x/100 == (x*5243)>>19 for every x below 43699.
+//
+static inline void quadBCD(unsigned int x, byte *bcd) {
+  byte hundreds = (unsigned long)x * 5243U >> 19;
+  bcd[0] = pairBCD(x - hundreds * 100U);
+  bcd[1] = pairBCD(hundreds);
+}
+
+//
+// catFreqToBCD() - the frequency is split into four digit groups, each group into digit
+// pairs by reciprocal multiplication, and each pair into a BCD byte the same way.
+// The only 32 bit step, splitting 8 digits into two groups of four, is an estimate from a
+// 16x16 multiply followed by at most two correcting subtractions.
+// Digits 8 and up are peeled off first by subtraction; above 1 GHz that needs 64 bit
+// arithmetic, which the common case never touches.  Values above CAT_BCD_MAX_FREQ are clamped.
+//
+void catFreqToBCD(uint64_t freq, byte *bcd, byte len) {
+  byte out[CAT_BCD_MAX_BYTES];
+  unsigned long lo;
+  unsigned int high4;
+  byte d8, d9, d10, d11;
+
+  if (freq > CAT_BCD_MAX_FREQ) freq = CAT_BCD_MAX_FREQ;
+
+  d9 = d10 = d11 = 0;
+  if (freq >= 1000000000ULL) {
+    d11 = digit64(&freq, 100000000000ULL);
+    d10 = digit64(&freq, 10000000000ULL);
+    d9  = digit64(&freq, 1000000000ULL);
+  }
+
+  lo = (unsigned long)freq;                    // now below 10^9
+  d8 = 0;
+  if (lo >= 800000000UL) { lo -= 800000000UL; d8 += 8; }
+  if (lo >= 400000000UL) { lo -= 400000000UL; d8 += 4; }
+  if (lo >= 200000000UL) { lo -= 200000000UL; d8 += 2; }
+  if (lo >= 100000000UL) { lo -= 100000000UL; d8 += 1; }
+
+  // lo / 10000 and lo % 10000.  Estimate from the top 14 bits: (lo>>13) * 8192/10000, with
+  // 8192/10000 as 26843/32768.  The product fits in 32 bits and the estimate is never more
+  // than 2 short, then correct.
+  high4 = (unsigned long)(unsigned int)(lo >> 13) * 26843U >> 15;
+  lo -= (unsigned long)high4 * 10000U;
+  while (lo >= 10000UL) {
+    lo -= 10000UL;
+    high4++;
+  }
+
+  quadBCD((unsigned int)lo, &out[0]);
+  quadBCD(high4, &out[2]);
+  out[4] = (d9 << 4) | d8;
+  out[5] = (d11 << 4) | d10;
+
+  memcpy(bcd, out, len);
+}
+
+//
+// Decode one BCD byte (two digits)
+//
+static inline byte pairValue(byte b) {
+  return (b >> 4) * 10 + (b & 0x0F);
+}
+
+//
+// Decode up to four BCD bytes (eight digits) as two independent halves of four digits.
+// Only 8x8 and 16x16 multiplies are needed, both are cheap on an ATmega.
+//
+static inline unsigned long quadValue(const byte *bcd, byte len) {
+  unsigned int low = 0, high = 0;
+
+  switch (len) {
+    case 4: high = pairValue(bcd[3]) * 100U;
+    /* fall through */
+    case 3: high += pairValue(bcd[2]);
+    /* fall through */
+    case 2: low = pairValue(bcd[1]) * 100U;
+    /* fall through */
+    case 1: low += pairValue(bcd[0]);
+  }
+  return (unsigned long)high * 10000U + low;
+}
+
+//
+// catBCDToFreq() - the low 8 digits always fit in 32 bits; anything from 100 MHz up is
+// added in with a single 64 bit step.
+//
+uint64_t catBCDToFreq(const byte *bcd, byte len) {
+  unsigned long lo, hi;
+
+  if (len <= 4) return quadValue(bcd, len);
+
+  lo = quadValue(bcd, 4);
+  hi = quadValue(bcd + 4, len - 4);
+  if (hi == 0) return lo;
+  return (uint64_t)hi * 100000000ULL + lo;
+}
+
+boolean catFreqField(const byte *bcd, CATFreq &freq) {
+  uint64_t f = catBCDToFreq(bcd, CAT_FREQ_BYTES);
+
+  if (f > CAT_FREQ_MAX) return false;
+  freq = CATFreq(f);
+  return true;
+}
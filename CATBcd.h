@@ -0,0 +1,70 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   CAT BCD - frequency to / from CI-V BCD without division
+
+   CI-V sends frequencies as packed BCD, least significant digit pair first:
+     Byte 0 10Hz   | 1Hz
+     Byte 1 1KHz   | 100Hz
+     Byte 2 100KHz | 10KHz
+     Byte 3 10MHz  | 1MHz
+     Byte 4 1GHz   | 100MHz
+     Byte 5 100GHz | 10GHz    (6 byte format of newer rigs, not used by the IC-746)
+   Example: 7,123,456 is encoded 56 | 34 | 12 | 07 | 00
+
+   The conversions use only shifts, adds and subtractions - an ATmega has no divide
+   instruction and a 32 bit software division costs hundreds of cycles.  Frequencies are
+   64 bit so the full 10 digit range (and the 12 digit one of the 6 byte format) is covered,
+   not just the 2.147 GHz that fits in a long.
+
+   Everywhere else - the handler, the VFOs, memory channels, band stacking registers and band
+   edges - a frequency is a CATFreq, unsigned 64 bits so the 5.76 and 10.368 GHz of a
+   transverter are carried in full, or 32 bits with CAT_FREQ_BITS 32 (IC746Config.h).  The
+   width is the same on the host as on an ATmega.  A frequency field above CAT_FREQ_MAX is
+   refused, never clamped or wrapped.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ * **************************************************************************/
+
+#ifndef CATBcd_h
+#define CATBcd_h
+
+#include <Arduino.h>
+#include "IC746Config.h"
+
+#define CAT_FREQ_BYTES      5               // IC-746 frequency field, 10 digits
+#define CAT_BCD_MAX_BYTES   6               // longest frequency field handled, 12 digits
+#define CAT_BCD_MAX_FREQ    999999999999ULL // largest value of a 12 digit field
+
+// A frequency in Hz at the library's interfaces, and the largest one a frequency field gives it
+#if CAT_FREQ_BITS == 64
+typedef uint64_t CATFreq;
+#define CAT_FREQ_MAX        9999999999ULL   // 10 digits, 9.999 GHz
+#else
+typedef uint32_t CATFreq;
+#define CAT_FREQ_MAX        0xFFFFFFFFUL    // 4.294 GHz
+#endif
+
+// Encode freq into len bytes (len <= CAT_BCD_MAX_BYTES).  Digits that do not fit are dropped,
+// values above CAT_BCD_MAX_FREQ are clamped.
+void catFreqToBCD(uint64_t freq, byte *bcd, byte len);
+
+// Decode len bytes (len <= CAT_BCD_MAX_BYTES) of BCD
+uint64_t catBCDToFreq(const byte *bcd, byte len);
+
+// Decode a CAT_FREQ_BYTES frequency field as a CATFreq - false, and freq untouched, if it is
+// above CAT_FREQ_MAX (or has digits above 9 that take it there)
+boolean catFreqField(const byte *bcd, CATFreq &freq);
+
+#endif
@@ -0,0 +1,277 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   CAT Memory - memory channels in EEPROM, wear levelled, writes coalesced
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***************************************************************************/
+
+#include "Arduino.h"
+#include "CATMemory.h"
+
+#define CAT_MEM_FREE        0xFF      // waiting place not in use
+#define CAT_MEM_CHECK_XOR   0xA5      // an all zero slot does not check
+#define CAT_MEM_SEQ_MASK    0xFFFFFFUL
+
+CATMemory::CATMemory(CATStorage &s, unsigned int writeDelay) : store(s), hold(writeDelay) {
+  for (byte ch = 0; ch < CAT_MEM_CHANNELS; ch++) index[ch] = CAT_MEM_NONE;
+  for (byte w = 0; w < CAT_MEM_PENDING; w++) waiting[w].ch = CAT_MEM_FREE;
+  rec[CAT_MEM_IX_CHAN] = CAT_MEM_FREE;
+}
+
+// Check byte of a record - CRC-8, polynomial x^8 + x^2 + x + 1, bit by bit (no table in flash)
+static byte recordCheck(const byte *r) {
+  byte crc = 0;
+
+  for (byte i = 0; i < CAT_MEM_IX_CHECK; i++) {
+    crc ^= r[i];
+    for (byte b = 0; b < 8; b++) crc = (crc & 0x80) ? byte(crc << 1) ^ 0x07 : byte(crc << 1);
+  }
+  return crc ^ CAT_MEM_CHECK_XOR;
+}
+
+byte CATMemory::channels() {
+  return CAT_MEM_CHANNELS;
+}
+
+unsigned int CATMemory::slots() {
+  return nSlots;
+}
+
+// Read a slot - true if it holds a whole record of one of the channels
+boolean CATMemory::loadSlot(unsigned int slot, byte *r) {
+  unsigned int addr = slot * CAT_MEM_RECORD;
+
+  for (byte i = 0; i < CAT_MEM_RECORD; i++) r[i] = store.read(addr + i);
+  return r[CAT_MEM_IX_CHAN] < CAT_MEM_CHANNELS && r[CAT_MEM_IX_CHECK] == recordCheck(r);
+}
+
+unsigned long CATMemory::seqOf(const byte *r) {
+  return r[CAT_MEM_IX_SEQ] | ((unsigned long)r[CAT_MEM_IX_SEQ + 1] << 8) |
+         ((unsigned long)r[CAT_MEM_IX_SEQ + 2] << 16);
+}
+
+//
+// begin() - find the latest record of each channel, and the end of the ring
+//
+// One pass over the store.  The head goes after the newest record, so the ring carries on where
+// it stopped before the power cycle.
+//
+void CATMemory::begin() {
+  byte r[CAT_MEM_RECORD];
+  unsigned long latest[CAT_MEM_CHANNELS] = {0};
+  unsigned long newest = 0;
+  boolean any = false;
+
+  nSlots = store.size() / CAT_MEM_RECORD;
+  head = 0;
+  recPos = CAT_MEM_RECORD;
+  rec[CAT_MEM_IX_CHAN] = CAT_MEM_FREE;
+  for (byte ch = 0; ch < CAT_MEM_CHANNELS; ch++) index[ch] = CAT_MEM_NONE;
+
+  for (unsigned int s = 0; s < nSlots; s++) {
+    if (!loadSlot(s, r)) continue;
+    byte ch = r[CAT_MEM_IX_CHAN];
+    unsigned long q = seqOf(r);
+    if (index[ch] == CAT_MEM_NONE || q > latest[ch]) {
+      index[ch] = s;
+      latest[ch] = q;
+    }
+    if (!any || q > newest) {
+      newest = q;
+      head = s + 1 < nSlots ? s + 1 : 0;
+      any = true;
+    }
+  }
+  seq = any ? (newest + 1) & CAT_MEM_SEQ_MASK : 0;
+}
+
+// A slot that holds the latest record of a channel - the ring steps over it
+boolean CATMemory::isLive(unsigned int slot) {
+  for (byte ch = 0; ch < CAT_MEM_CHANNELS; ch++) {
+    if (index[ch] == slot) return true;
+  }
+  return false;
+}
+
+//
+// read() - a channel, newest copy first: waiting in RAM, in the record buffer, then the store
+//
+boolean CATMemory::read(byte ch, CATChannel &c) {
+  byte r[CAT_MEM_RECORD];
+  byte flags, w;
+  CATFreq freq;
+
+  if (ch >= CAT_MEM_CHANNELS) return false;
+
+  for (w = 0; w < CAT_MEM_PENDING && waiting[w].ch != ch; w++) ;
+  if (w < CAT_MEM_PENDING) {
+    flags = waiting[w].flags;
+    freq = waiting[w].freq;
+  } else {
+    if (rec[CAT_MEM_IX_CHAN] == ch && (recPos < CAT_MEM_RECORD || index[ch] == recSlot)) {
+      memcpy(r, rec, CAT_MEM_RECORD);   // being written, or written last - the EEPROM may still be busy
+    } else if (index[ch] == CAT_MEM_NONE || !loadSlot(index[ch], r)) {
+      return false;
+    }
+    flags = r[CAT_MEM_IX_FLAGS];
+    freq = CATFreq(r[CAT_MEM_IX_FREQ]) | (CATFreq(r[CAT_MEM_IX_FREQ + 1]) << 8) |
+           (CATFreq(r[CAT_MEM_IX_FREQ + 2]) << 16) | (CATFreq(r[CAT_MEM_IX_FREQ + 3]) << 24);
+#if CAT_FREQ_BITS == 64
+    freq |= CATFreq(flags & CAT_MEM_FREQ_HIGH) << 26;
+#endif
+  }
+
+  if (flags & CAT_MEM_CLEARED) return false;
+  c.freq = freq;
+  c.mode = flags & CAT_MEM_MODE_MASK;
+  c.split = (flags & CAT_MEM_SPLIT) != 0;
+  return true;
+}
+
+boolean CATMemory::write(byte ch, const CATChannel &c) {
+  byte flags = (c.mode & CAT_MEM_MODE_MASK) | (c.split ? CAT_MEM_SPLIT : 0);
+
+#if CAT_FREQ_BITS == 64
+  if (c.freq > CAT_MEM_FREQ_MAX) return false;
+  flags |= byte(c.freq >> 26) & CAT_MEM_FREQ_HIGH;
+#endif
+  return put(ch, flags, c.freq);
+}
+
+// A cleared channel is a record too - the older ones would come back at the next begin()
+boolean CATMemory::clear(byte ch) {
+  return put(ch, CAT_MEM_CLEARED, 0);
+}
+
+// The waiting place that has waited longest, CAT_MEM_FREE if none
+byte CATMemory::longest() {
+  unsigned long now = millis();
+  byte oldest = CAT_MEM_FREE;
+
+  for (byte w = 0; w < CAT_MEM_PENDING; w++) {
+    if (waiting[w].ch == CAT_MEM_FREE) continue;
+    if (oldest == CAT_MEM_FREE || now - waiting[w].since > now - waiting[oldest].since) oldest = w;
+  }
+  return oldest;
+}
+
+//
+// put() - queue a channel for writing
+//
+// A channel already waiting is replaced and keeps its place in the queue, so a channel written
+// over and over still reaches the store CAT_MEM_WRITE_DELAY after the first write.  With every
+// place in use the channel that has waited longest is written there and then.
+//
+boolean CATMemory::put(byte ch, byte flags, CATFreq freq) {
+  byte place = CAT_MEM_FREE;
+
+  if (ch >= CAT_MEM_CHANNELS || nSlots <= CAT_MEM_CHANNELS) return false;
+
+  for (byte w = 0; w < CAT_MEM_PENDING; w++) {
+    if (waiting[w].ch == ch) {
+      waiting[w].flags = flags;
+      waiting[w].freq = freq;
+      coalesced++;
+      return true;
+    }
+    if (waiting[w].ch == CAT_MEM_FREE) place = w;
+  }
+
+  if (place == CAT_MEM_FREE) {
+    place = longest();
+    finish();
+    start(place);
+    finish();
+    forced++;
+  }
+
+  waiting[place].ch = ch;
+  waiting[place].flags = flags;
+  waiting[place].freq = freq;
+  waiting[place].since = millis();
+  return true;
+}
+
+//
+// start() - move waiting place w into the record buffer, bound for the next free slot
+//
+// There are more slots than channels, so the ring always has a slot that is not some channel's
+// latest record.
+//
+void CATMemory::start(byte w) {
+  unsigned int s;
+
+  do {
+    s = head;
+    head = head + 1 < nSlots ? head + 1 : 0;
+  } while (isLive(s));
+
+  rec[CAT_MEM_IX_CHAN] = waiting[w].ch;
+  rec[CAT_MEM_IX_FLAGS] = waiting[w].flags;
+  for (byte i = 0; i < 4; i++) rec[CAT_MEM_IX_FREQ + i] = byte(waiting[w].freq >> (8 * i));
+  for (byte i = 0; i < 3; i++) rec[CAT_MEM_IX_SEQ + i] = byte(seq >> (8 * i));
+  seq = (seq + 1) & CAT_MEM_SEQ_MASK;
+  rec[CAT_MEM_IX_CHECK] = recordCheck(rec);
+
+  recSlot = s;
+  recPos = 0;
+  waiting[w].ch = CAT_MEM_FREE;
+}
+
+// Write the next byte of the record, if it differs from what the slot holds.  The check byte goes
+// last, so the record only counts once it is whole.
+void CATMemory::step() {
+  unsigned int addr = recSlot * CAT_MEM_RECORD + recPos;
+
+  if (store.read(addr) != rec[recPos]) store.write(addr, rec[recPos]);
+  if (++recPos == CAT_MEM_RECORD) {
+    index[rec[CAT_MEM_IX_CHAN]] = recSlot;
+    recordsWritten++;
+  }
+}
+
+// Finish the record being written, waiting for the store
+void CATMemory::finish() {
+  while (recPos < CAT_MEM_RECORD) {
+    store.wait();
+    step();
+  }
+}
+
+//
+// service() - write what is due, a byte at a time, never waiting for the store
+//
+void CATMemory::service() {
+  if (recPos == CAT_MEM_RECORD) {
+    byte w = longest();
+    if (w == CAT_MEM_FREE || millis() - waiting[w].since < hold) return;
+    start(w);
+  }
+  while (recPos < CAT_MEM_RECORD && store.ready()) step();
+}
+
+void CATMemory::flush() {
+  byte w;
+
+  finish();
+  while ((w = longest()) != CAT_MEM_FREE) {
+    start(w);
+    finish();
+  }
+}
+
+boolean CATMemory::busy() {
+  return recPos < CAT_MEM_RECORD || longest() != CAT_MEM_FREE;
+}
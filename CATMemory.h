@@ -0,0 +1,134 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   CAT Memory - memory channels in EEPROM, wear levelled, writes coalesced
+
+   Each channel holds a frequency, a mode and split.  The store (CATStorage.h)
+   is a ring of fixed size records, and a write never overwrites a channel in
+   place: it goes to the next slot of the ring that does not hold the latest
+   record of some channel, so the writes are spread over the whole store
+   instead of wearing out one spot.  Only the bytes that change are written.
+   A RAM index holds the slot of each channel's latest record.
+
+     |channel|flags|frequency (4)|sequence (3)|check|
+
+   flags      bits 0-3 mode, bit 4 split, bit 5 cleared, bits 6-7 frequency bits
+              32-33 - up to 17.18 GHz, more than the 10 digits of CI-V
+   sequence   counts every record written, the highest is the newest - 16
+              million records, far more than an EEPROM lasts
+   check      CRC-8 (polynomial 07) of the other bytes, XOR A5 - a record whose
+              write was cut short by a power failure is ignored, the channel's
+              previous record still holds.  Unlike a sum it also catches two
+              bytes wrong the opposite way, or a byte of an older record left
+              in the middle of a new one
+
+   Writes are not made at once.  A written channel waits in RAM for
+   CAT_MEM_WRITE_DELAY ms, and more writes to it in that time only replace
+   the waiting copy - a logger that stores the same channel at every QSO
+   costs one record, not dozens.  service(), from IC746::check(), then
+   writes the record a byte at a time, starting a byte only when the store
+   is ready, so the loop never waits for the EEPROM.  Call flush() before
+   the power goes, waiting channels are lost otherwise.
+
+   A channel is read from the newest copy: waiting in RAM, then the record
+   buffer - which keeps serving its channel after the last byte went out,
+   until the next record starts - then the store.  The channel being written
+   is never read back from an EEPROM still busy with it; another channel's
+   read may wait for the byte in progress, as eeprom_read_byte() does.
+
+   Needs more slots than channels - store size / CAT_MEM_RECORD.  The more
+   spare slots, the more the writes are spread.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ * **************************************************************************/
+
+#ifndef CATMemory_h
+#define CATMemory_h
+
+#include <Arduino.h>
+#include "IC746Config.h"
+#include "CATStorage.h"
+#include "CATBcd.h"
+
+#define CAT_MEM_RECORD      10        // bytes per slot
+#define CAT_MEM_NONE        0xFFFF    // no slot
+
+// Record layout
+#define CAT_MEM_IX_CHAN     0
+#define CAT_MEM_IX_FLAGS    1
+#define CAT_MEM_IX_FREQ     2
+#define CAT_MEM_IX_SEQ      6
+#define CAT_MEM_IX_CHECK    9
+
+#define CAT_MEM_MODE_MASK   0x0F
+#define CAT_MEM_SPLIT       0x10
+#define CAT_MEM_CLEARED     0x20
+#define CAT_MEM_FREQ_HIGH   0xC0      // frequency bits 32-33, shifted down by 26
+#define CAT_MEM_FREQ_MAX    0x3FFFFFFFFULL
+
+struct CATChannel {
+  CATFreq freq;
+  byte mode;
+  boolean split;
+};
+
+class CATMemory {
+  public:
+    CATMemory(CATStorage &store, unsigned int writeDelay = CAT_MEM_WRITE_DELAY);
+    void begin();                                  // read the store, build the index - IC746::setMemory() calls it
+    byte channels();                               // CAT_MEM_CHANNELS, numbered from 0 here, from 1 over CI-V
+    unsigned int slots();
+    boolean read(byte ch, CATChannel &c);          // false if the channel is empty
+    boolean write(byte ch, const CATChannel &c);   // false for no such channel, too few slots or freq above CAT_MEM_FREQ_MAX
+    boolean clear(byte ch);
+    void service();                                // write what is due, never waits
+    void flush();                                  // write everything now, waiting for the store
+    boolean busy();                                // channels waiting to be written
+
+    unsigned long recordsWritten = 0;   // records written to the store
+    unsigned long coalesced      = 0;   // writes that replaced a channel still waiting
+    unsigned int forced          = 0;   // channels written early, all waiting places in use
+
+  private:
+    struct Waiting {
+      byte ch;                      // 0xFF - place free
+      byte flags;
+      CATFreq freq;
+      unsigned long since;          // millis() of the first write not yet in the store
+    };
+
+    CATStorage &store;
+    unsigned int hold;               // ms a written channel waits
+    unsigned int nSlots     = 0;
+    unsigned int head       = 0;    // next slot to try
+    unsigned long seq       = 0;    // of the next record
+    unsigned int index[CAT_MEM_CHANNELS];
+    Waiting waiting[CAT_MEM_PENDING];
+
+    // the record being written
+    byte rec[CAT_MEM_RECORD];       // ... and the latest record of rec[CAT_MEM_IX_CHAN] once written
+    byte recPos             = CAT_MEM_RECORD;   // next byte, CAT_MEM_RECORD when idle
+    unsigned int recSlot    = 0;
+
+    boolean loadSlot(unsigned int slot, byte *r);
+    unsigned long seqOf(const byte *r);
+    boolean isLive(unsigned int slot);
+    boolean put(byte ch, byte flags, CATFreq freq);
+    byte longest(void);
+    void start(byte w);
+    void step(void);
+    void finish(void);
+};
+
+#endif
@@ -0,0 +1,54 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   CAT Metrics - command counters, latency histogram and error counters
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***************************************************************************/
+
+#include <limits.h>
+#include "Arduino.h"
+#include "CATMetrics.h"
+
+void CATMetrics::reset() {
+  memset(this, 0, sizeof(*this));
+  since = millis();
+}
+
+// Counters stop at the top of unsigned int - 65535 on an ATmega, more on 32 bit boards and the host
+void CATMetrics::bump(unsigned int &counter, unsigned int n) {
+  counter = (counter > UINT_MAX - n) ? UINT_MAX : counter + n;
+}
+
+//
+// command() - count one command and file its latency
+//
+void CATMetrics::command(byte op, unsigned long us) {
+  byte bucket = 0;
+  unsigned long v = us;
+
+  if (commands != ULONG_MAX) commands++;
+  if (op < CAT_METRICS_OPCODES) {
+    bump(byOpcode[op]);
+    if (us > worst[op]) worst[op] = us > UINT_MAX ? UINT_MAX : (unsigned int)us;
+  } else {
+    bump(otherOpcodes);
+  }
+
+  while (v && bucket < CAT_METRICS_BUCKETS - 1) {   // bit length of us, capped
+    v >>= 1;
+    bucket++;
+  }
+  bump(latency[bucket]);
+}
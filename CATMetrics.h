@@ -0,0 +1,69 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   CAT Metrics - command counters, latency histogram and error counters
+
+   Kept by the engine when CAT_FEATURE_METRICS is on, read with IC746::metrics()
+   or over CI-V with the vendor command CAT_METRICS_CMD (see IC746.cpp).
+
+   Latency is from the end of a command (its EOM reaching the receiver) to its
+   response being queued for transmit.  It includes time spent waiting in the
+   receive queue, so a slow main loop shows up as well as a slow handler.  When
+   check() reads the transport itself the clock starts when check() gets to the
+   EOM, not when it arrived at the UART.
+
+   Histogram bucket i counts latencies of 2^(i-1) to 2^i - 1 microseconds
+   (bucket 0 is 0us), the last bucket everything longer.  Counters stop at their
+   maximum value rather than wrapping.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ * **************************************************************************/
+
+#ifndef CATMetrics_h
+#define CATMetrics_h
+
+#include <Arduino.h>
+#include "IC746Config.h"
+
+// Opcodes counted one by one - every opcode of the command table, CAT_CMD_TABLE_LENGTH (IC746.h)
+#if CAT_FEATURE_DUAL_VFO
+#define CAT_METRICS_OPCODES     0x27    // 00 - 26
+#else
+#define CAT_METRICS_OPCODES     0x1D    // 00 - 1C
+#endif
+#define CAT_METRICS_BUCKETS     16      // 0us, 1us, 2-3us ... 16.4ms and over
+
+class CATMetrics {
+  public:
+    unsigned long since;                                // millis() at the last reset
+    unsigned long commands;                             // all commands processed
+    unsigned int byOpcode[CAT_METRICS_OPCODES];         // commands by opcode
+    unsigned int otherOpcodes;                          // commands with an opcode outside the table
+    unsigned int worst[CAT_METRICS_OPCODES];            // longest latency by opcode, us
+    unsigned int latency[CAT_METRICS_BUCKETS];          // latency histogram, all commands
+
+    // errors
+    unsigned int rxErrors;      // framing errors - broken preamble, frame too long, stalled,
+                                // cut short by a new preamble or jammed (FC)
+    unsigned int rxOverruns;    // commands lost, receive queue full
+    unsigned int txDrops;       // responses lost, transmit queue full
+    unsigned int rejects;       // commands NACKed - unknown opcode or bad length
+
+    CATMetrics() { reset(); }
+    void reset(void);
+    void command(byte op, unsigned long micros);   // one command processed, with its latency
+    static void bump(unsigned int &counter, unsigned int n = 1);   // saturating add
+};
+
+#endif
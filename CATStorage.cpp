@@ -0,0 +1,46 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   CAT Storage - AVR EEPROM implementation
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***************************************************************************/
+
+#include "Arduino.h"
+#include "CATStorage.h"
+
+#ifdef __AVR__
+#include <avr/eeprom.h>
+
+CATEepromStorage::CATEepromStorage(unsigned int b, unsigned int size) : base(b), len(size) {
+}
+
+unsigned int CATEepromStorage::size() {
+  return len;
+}
+
+byte CATEepromStorage::read(unsigned int addr) {
+  return eeprom_read_byte((const uint8_t *)(base + addr));
+}
+
+// eeprom_write_byte() waits for the previous write, then starts this one and returns -
+// after ready() it does not wait at all
+void CATEepromStorage::write(unsigned int addr, byte b) {
+  eeprom_write_byte((uint8_t *)(base + addr), b);
+}
+
+boolean CATEepromStorage::ready() {
+  return eeprom_is_ready();
+}
+#endif
@@ -0,0 +1,65 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   CAT Storage - non-volatile bytes for the memory channels (CATMemory.h)
+
+   CATMemory keeps its records in a CATStorage.  The AVR's own EEPROM is
+   provided; flash emulated EEPROM, an I2C EEPROM or FRAM, or a file on a
+   Linux host only need the functions below.
+
+   Writes are started one byte at a time and need not be finished when
+   write() returns - an AVR EEPROM byte takes 3.3 ms.  CATMemory only
+   starts the next byte when ready() says so, and never waits in check();
+   flush(), and a write with every waiting place in use, wait() instead.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ * **************************************************************************/
+
+#ifndef CATStorage_h
+#define CATStorage_h
+
+#include <Arduino.h>
+
+/*
+   The storage interface - a small array of bytes that survives a power cycle
+*/
+class CATStorage {
+  public:
+    virtual unsigned int size() = 0;                     // bytes available
+    virtual byte read(unsigned int addr) = 0;
+    virtual void write(unsigned int addr, byte b) = 0;   // start writing one byte
+    virtual boolean ready() { return true; }             // the last write is done, the next may start
+    virtual void wait() { while (!ready()) ; }           // until ready()
+};
+
+#ifdef __AVR__
+/*
+   The AVR's EEPROM, or the part of it from base on - the sketch may keep its own
+   settings below base.  Erased EEPROM reads FF, which CATMemory takes as empty.
+*/
+class CATEepromStorage : public CATStorage {
+  public:
+    CATEepromStorage(unsigned int base, unsigned int size);
+    unsigned int size();
+    byte read(unsigned int addr);
+    void write(unsigned int addr, byte b);
+    boolean ready();
+
+  private:
+    unsigned int base;
+    unsigned int len;
+};
+#endif
+
+#endif
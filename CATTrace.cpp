@@ -0,0 +1,92 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   CAT Trace - binary event recorder
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***************************************************************************/
+
+#include "Arduino.h"
+#include "CATTrace.h"
+
+void CATTrace::put(byte b) {
+  buf[tail & CAT_TRACE_BUF_MASK] = b;
+  tail++;
+}
+
+// Drop the oldest record to make room
+void CATTrace::discard() {
+  head += CAT_TRACE_HDR + buf[(head + 3) & CAT_TRACE_BUF_MASK];
+  drops++;
+}
+
+//
+// record() - append one record, overwriting the oldest ones if need be
+//
+void CATTrace::record(byte code, const byte *data, byte len) {
+  unsigned long now = micros();
+  unsigned long ticks = now >> CAT_TRACE_TICK_SHIFT;
+  unsigned long dt = ticks - last;
+
+  if (len > CAT_TRACE_BUF_LENGTH / 2 - CAT_TRACE_HDR) {
+    len = CAT_TRACE_BUF_LENGTH / 2 - CAT_TRACE_HDR;
+  }
+  last = ticks;
+
+  if (!synced || dt >= 0xFFFF) {   // first record, or too long for the 16 bit delta - sync the decoder
+    byte t[4] = {byte(now), byte(now >> 8), byte(now >> 16), byte(now >> 24)};
+    while (tail - head + CAT_TRACE_HDR + sizeof(t) > CAT_TRACE_BUF_LENGTH) discard();
+    put(CAT_TRC_TIME);
+    put(0xFF);
+    put(0xFF);
+    put(sizeof(t));
+    for (byte i = 0; i < sizeof(t); i++) put(t[i]);
+    dt = 0;
+    synced = true;
+  }
+
+  while (tail - head + CAT_TRACE_HDR + len > CAT_TRACE_BUF_LENGTH) discard();
+  put(code);
+  put(byte(dt));
+  put(byte(dt >> 8));
+  put(len);
+  for (byte i = 0; i < len; i++) put(data[i]);
+}
+
+//
+// read() - copy out as many whole records as fit in max bytes, oldest first, and free them
+//
+int CATTrace::read(byte *out, int max) {
+  int n = 0;
+
+  while (head != tail) {
+    int size = CAT_TRACE_HDR + buf[(head + 3) & CAT_TRACE_BUF_MASK];
+    if (n + size > max) break;
+    for (int i = 0; i < size; i++) {
+      out[n++] = buf[head & CAT_TRACE_BUF_MASK];
+      head++;
+    }
+  }
+  return n;
+}
+
+unsigned int CATTrace::lost() {
+  return drops;
+}
+
+void CATTrace::clear() {
+  head = tail;
+  drops = 0;
+  synced = false;
+}
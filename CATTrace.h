@@ -0,0 +1,78 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   CAT Trace - binary event recorder
+
+   A fixed size ring of binary records, cheap enough to leave on in a working rig:
+   recording a frame is a call to micros() and a copy of its bytes, nothing is
+   formatted and nothing is allocated.  When the ring is full the oldest records
+   are overwritten (and counted).  The sketch pulls the records out with read()
+   whenever it likes - over a spare serial port, to an SD card - and
+   extras/host/cat_trace decodes them.
+
+   Record format, all records back to back:
+     byte 0     event code (CAT_TRC_xxx)
+     byte 1-2   time since the previous record, 16us units, little endian
+                (0xFFFF - more than a second, a CAT_TRC_TIME record comes first)
+     byte 3     data length n
+     byte 4..   n data bytes
+   A CAT_TRC_TIME record carries the absolute micros() value, 4 bytes little endian.
+
+   Records are written from the main loop only, never from the receive interrupt.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ * **************************************************************************/
+
+#ifndef CATTrace_h
+#define CATTrace_h
+
+#include <Arduino.h>
+#include "IC746Config.h"
+
+// Ring size CAT_TRACE_BUF_LENGTH is set in IC746Config.h
+#define CAT_TRACE_BUF_MASK      (CAT_TRACE_BUF_LENGTH - 1)
+#define CAT_TRACE_HDR           4       // code, time (2), length
+#define CAT_TRACE_TICK_SHIFT    4       // time unit is 1 << 4 microseconds
+
+// Event codes
+#define CAT_TRC_TIME        0x00  // absolute time, micros()
+#define CAT_TRC_RX          0x01  // command taken off the receive queue, without preamble / EOM
+#define CAT_TRC_TX          0x02  // frame queued for transmit, without preamble / EOM
+#define CAT_TRC_TX_DROP     0x03  // frame dropped, transmit queue full - data is the frame
+#define CAT_TRC_RX_ERROR    0x04  // framing errors (NACKs owed) seen by the receiver - data is the count
+#define CAT_TRC_RX_OVERRUN  0x05  // commands dropped, receive queue full - data is the count
+#define CAT_TRC_REJECT      0x06  // command NACKed, unknown or bad length - data is opcode, length
+#define CAT_TRC_BAUD        0x07  // automatic baud rate changed the rate - data is the rate, 4 bytes little endian, and 1 if locked
+#define CAT_TRC_RX_RESYNC   0x08  // frames dropped without a NACK - stalled, cut short by a preamble or jammed - data is the count
+#define CAT_TRC_USER        0x80  // codes from here up are the sketch's own, see IC746::trace()
+
+class CATTrace {
+  public:
+    void record(byte code, const byte *data, byte len);
+    int read(byte *buf, int max);   // move whole records out, returns bytes copied
+    unsigned int lost();            // records overwritten before they were read
+    void clear();
+
+  private:
+    byte buf[CAT_TRACE_BUF_LENGTH];
+    unsigned int head       = 0;   // oldest record
+    unsigned int tail       = 0;   // next free byte
+    unsigned int drops      = 0;
+    unsigned long last      = 0;   // time of the previous record, in ticks
+    boolean synced          = false;   // a TIME record has been written
+    void put(byte b);
+    void discard(void);
+};
+
+#endif
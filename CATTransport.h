@@ -0,0 +1,75 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   CAT Transport - byte stream interface between the protocol engine and the link
+
+   The IC746 protocol engine does not talk to a serial port directly, it reads and
+   writes bytes through a CATTransport.  The default transport is the board's
+   serial port "Serial", so existing sketches work unchanged.  Other transports
+   (a second UART on a Mega, a pseudo-terminal on a Linux host, a test harness)
+   only need to implement the functions below.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ * **************************************************************************/
+
+#ifndef CATTransport_h
+#define CATTransport_h
+
+#include <Arduino.h>
+
+/*
+   The transport interface - Stream-like, byte at a time.  Queued responses are handed over a run
+   at a time with writeBytes(); a transport that can pass a run on in one go overrides it.
+*/
+class CATTransport {
+  public:
+    virtual void begin(long baudrate, int mode) = 0;  // open / configure the link
+    virtual void end() {}                              // close it, before a begin() at another rate
+    virtual int available() = 0;                       // number of bytes waiting to be read
+    virtual int read() = 0;                            // next byte, -1 if none
+    virtual void write(byte b) = 0;                    // send one byte
+    virtual void writeBytes(const byte *buf, int len) {   // send len bytes
+      for (int i = 0; i < len; i++) write(buf[i]);
+    }
+    virtual int availableForWrite() = 0;               // bytes that can be written without blocking
+};
+
+/*
+   Transport over an Arduino serial port, whatever its class - HardwareSerial for a UART,
+   Serial_ for the native USB port of a Leonardo or Micro, USBSerial and the like elsewhere.
+   The port's own begin() and end() are called, so the mode goes to the UART as before.
+*/
+template <class Port>
+class CATSerialPort : public CATTransport {
+  public:
+    CATSerialPort(Port &p) : port(p) {}
+    void begin(long baudrate, int mode) { port.begin(baudrate, mode); }
+    void end() { port.end(); }
+    int available() { return port.available(); }
+    int read() { return port.read(); }
+    void write(byte b) { port.write(b); }
+    void writeBytes(const byte *buf, int len) { port.write(buf, len); }
+    int availableForWrite() { return port.availableForWrite(); }
+
+  private:
+    Port &port;
+};
+
+// A UART - Serial1, Serial2 ...
+typedef CATSerialPort<HardwareSerial> CATSerialTransport;
+
+// The board's "Serial", a UART or native USB
+typedef CATSerialPort<decltype(Serial)> CATDefaultTransport;
+
+#endif
@@ -1,805 +1,2502 @@
-/*************************************************************************
-   IC746 CAT Library, by KK4DAS, Dean Souleles
-   V1.3 1/21/2023
-      - Included all defined modes in Get/Set Mode (thanks to Mike, KA4CDN)
-      - Fix to allow frequencies greater than 100MHz -(thanks to Bob, KA1GT)
-
-   V1.2 10/22/2021
-      - Fixes bug that caused "WSJTX Rig Control Error"  for versions after 2.2.2
-      - The problem was caused by an unsupported CIV command being sent by WSJTX
-      - This fix responds to unimplemented commands with a NACK instead of an ACK
-      - Bug was reported on the WSJTX groups board.
-
-   V1.1 2/3/2021 
-      - various fixes, now works properly with OmniRig and flrig
-      - smeter now returns proper BCD code - calibrated to emulate ICOM responses
-      
-   V1.0 1/24/2021
-      - Initial build
-   Inspired by:  ft857d CAT Library, by Pavel Milanes, CO7WT, pavelmc@gmail.com
-
-   Emulates an ICOM 746 CAT functionality to work with all ham radio software that include CAT control
-
-   This program is free software: you can redistribute it and/or modify
-   it under the terms of the GNU General Public License as published by
-   the Free Software Foundation, either version 3 of the License, or
-   (at your option) any later version.
-
-   This program is distributed in the hope that it will be useful,
-   but WITHOUT ANY WARRANTY; without even the implied warranty of
-   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-   GNU General Public License for more details.
-
-   You should have received a copy of the GNU General Public License
-   along with this program.  If not, see <http://www.gnu.org/licenses/>.
-
-***************************************************************************/
-
-#include "Arduino.h"
-#include "IC746.h"
-
-//#define DEBUG_CAT
-#ifdef DEBUG_CAT
-#define DEBUG_CAT_DETAIL
-//#define DEBUG_CAT_SMETER
-#include <SoftwareSerial.h>
-SoftwareSerial catDebug(11,12); // RX, TX
-String dbg;
-#endif
-
-//extern void displayBanner(String s);
-
-// User supplied calback function work variables, must be static
-static FuncPtrBoolean catSplit;
-static FuncPtrBoolean catSetPtt;
-static FuncPtrVoidBoolean catGetPtt;
-static FuncPtrVoidLong catGetFreq;
-static FuncPtrLong catSetFreq;
-static FuncPtrVoidByte catGetMode;
-static FuncPtrByte catSetMode;
-static FuncPtrVoidByte catGetSmeter;
-static FuncPtrByte catSetVFO;
-static FuncPtrVoid catAtoB;
-static FuncPtrVoid catSwapVfo;
-
-
-// Command indices
-//
-// Command structure after preamble and EOM have been discarded
-// |56|E0|cmd|sub-cmd|data
-//   56 - fixed transceiver address for IC746
-//   E0 - fixed cat xontroller address
-// The sub-command field varies by command. For somme commands the sub-cmd field is not supplied and the data
-// begins immediatedly follwing the command.
-//
-// The following are the array indedes within the command buffer for command elements that are sent with the command
-// or are where we put data to return to the conroller
-//
-#define CAT_IX_TO_ADDR     0
-#define CAT_IX_FROM_ADDR   1
-#define CAT_IX_CMD         2
-#define CAT_IX_SUB_CMD     3
-#define CAT_IX_FREQ        3   // Set Freq has no sub-command
-#define CAT_IX_MODE        3   // Get mode has no sub-command
-#define CAT_IX_TUNE_STEP   3   // Get step has no sub-command
-#define CAT_IX_ANT_SEL     3   // Get amt has no sub-command
-#define CAT_IX_PTT         4   // PTT RX/TX indicator
-#define CAT_IX_IF_FILTER   4   // IF Filter value
-#define CAT_IX_SMETER      4   // S Meter 0-255
-#define CAT_IX_SQUELCH     4   // Squelch 0=close, 1= open
-#define CAT_IX_ID          5
-#define CAT_IX_DATA        4   // Data following sub-comand
-
-// Lentgth of commands that request data 
-#define CAT_RD_LEN_NOSUB   3   //  3 bytes - 56 E0 cc
-#define CAT_RD_LEN_SUB     4   //  4 bytes - 56 E0 cc ss  (cmd, sub command)
-
-// Length of data responses
-#define CAT_SZ_SMETER      6   //  6 bytes - E0 56 15 02 nn nn 
-#define CAT_SZ_SQUELCH     5   //  5 bytes - E0 56 15 01 nn
-#define CAT_SZ_PTT         5   //  5 bytes - E0 56 1C 00 nn
-#define CAT_SZ_FREQ        8   //  8 bytes - E0 56 03 ff ff ff ff ff  (frequency in little endian BCD)
-#define CAT_SZ_MODE        5   //  5 bytes - E0 56 04 mm ff  (mode, then filter)
-#define CAT_SZ_IF_FILTER   5   //  5 bytes - E0 56 1A 03 nn
-#define CAT_SZ_TUNE_STEP   4   //  4 bytes - E0 56 10 nn
-#define CAT_SZ_ANT_SEL     4   //  4 bytes - E0 56 12 nn
-#define CAT_SZ_ID          5   //  5 bytes - E0 56 19 00 56    (returns RIG ID)
-#define CAT_SZ_UNIMP_1B    5   //  5 bytes - E0 56 NN SS 00    (unimplemented commands that require 1 data byte
-#define CAT_SZ_UNIMP_2B    6   //  6 bytes - EO 56 NN SS 00 00 (unimplemented commandds that required 2 data bytes
-
-
-
-/*
-   Contructor, simple constructor, it initiates the serial port in the
-   default mode for the radio: 9600 @ 8N2
-*/
-void IC746::begin() {
-  Serial.begin(9600, SERIAL_8N2);
-//  while (!Serial);;
-//  Serial.flush();
-
-#ifdef DEBUG_CAT
-  catDebug.begin(9600);
-  dbg = "CAT Debug Ready:";
-  catDebug.println(dbg.c_str());
-#endif
-}
-
-// Alternative initializer with a custom baudrate and mode
-void IC746::begin(long br, int mode) {
-  /*
-     Allowed Arduino modes for the serial:
-      SERIAL_5N1; SERIAL_6N1; SERIAL_7N1; SERIAL_8N1; SERIAL_5N2; SERIAL_6N2;
-      SERIAL_7N2; SERIAL_8N2; SERIAL_5E1; SERIAL_6E1; SERIAL_7E1; SERIAL_8E1;
-      SERIAL_5E2; SERIAL_6E2; SERIAL_7E2; SERIAL_8E2; SERIAL_5O1; SERIAL_6O1;
-      SERIAL_7O1; SERIAL_8O1; SERIAL_5O2; SERIAL_6O2; SERIAL_7O2; SERIAL_8O2
-  */
-  Serial.begin(br, mode);
- // Serial.flush();
-#ifdef DEBUG_CAT
-  catDebug.begin(9600);
-  dbg = "CAT Debug Ready";
-  catDebug.println(dbg.c_str());
-  delay(1000);
-  catDebug.println(dbg.c_str());
-  catDebug.println(dbg.c_str());
-  catDebug.println(dbg.c_str());
-#endif
-}
-
-/*
-   Linking user supplied callback functions
-*/
-
-// PTT
-void IC746::addCATPtt(void (*userFunc)(boolean)) {
-  catSetPtt = userFunc;
-}
-
-// Split
-void IC746::addCATsplit(void (*userFunc)(boolean)) {
-  catSplit = userFunc;
-}
-
-// VFO A=B - set both VFOs to be the same as the active VFO
-void IC746::addCATAtoB(void (*userFunc)(void)) {
-  catAtoB = userFunc;
-}
-
-// Swap Active VFO
-void IC746::addCATSwapVfo(void (*userFunc)(void)) {
-  catSwapVfo = userFunc;
-}
-
-// Get the freq of operation, the function must return the freq
-void IC746::addCATGetFreq(long (*userFunc)(void)) {
-  catGetFreq = userFunc;
-}
-
-// Get the mode of operation, the function must return the mode
-void IC746::addCATGetMode(byte (*userFunc)(void)) {
-  catGetMode = userFunc;
-}
-
-// GetPTT - function must return true for Tx and false for Rx
-void IC746::addCATGetPtt(boolean (*userFunc)(void)) {
-  catGetPtt = userFunc;
-}
-
-
-// S meter (user function must return 0-15)
-void IC746::addCATSMeter(byte (*userFunc)(void)) {
-  catGetSmeter = userFunc;
-}
-
-// Set Frequency - user function must accept a long as the freq in hz
-void IC746::addCATFSet(void (*userFunc)(long)) {
-  catSetFreq = userFunc;
-}
-
-// Set Mode -  user function must interpret MODE per the constants in IC746.h
-void IC746::addCATMSet(void (*userFunc)(byte)) {
-  catSetMode = userFunc;
-}
-
-// SEt VFOA or B - user function must interpret VFO per the constants in IC746.h
-void IC746::addCATVSet(void (*userFunc)(byte)) {
-  catSetVFO = userFunc;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-// Protocol Message Handling
-////////////////////////////////////////////////////////////////////////////////
-
-//
-// Send a message back to CAT controller
-// Format PREAMBLE, PREAMBLE, MSG, EOM
-//
-void IC746::send(byte *buf, int len) {
-  int i;
-
-  Serial.write(CAT_PREAMBLE);
-  Serial.write(CAT_PREAMBLE);
-
-  for (i = 0; i < len; i++) {
-    Serial.write(buf[i]);
-  }
-  Serial.write(CAT_EOM);
-
-#ifdef DEBUG_CAT_DETAIL
-  dbg = "sent: ";
-  dbg += String(len);
-  dbg += ": ";
-  for (int i = 0; i < len; i++) {
-    dbg += String(buf[i], HEX);
-    dbg += " ";
-  }
-  catDebug.println(dbg.c_str());
-#endif
-
-}
-
-//
-// sendResponse
-// 
-void IC746::sendResponse(byte *buf, int len) {
-  buf[CAT_IX_FROM_ADDR] = CAT_RIG_ADDR;
-  buf[CAT_IX_TO_ADDR] = CAT_CTRL_ADDR;
-  send(buf, len);
-}
-
-//
-// sendAck() - send back hard-code acknowledge message
-//
-void IC746::sendAck() {
-  byte ack[] = {CAT_RIG_ADDR, CAT_CTRL_ADDR, CAT_ACK};
-  send(ack, 3);
-}
-
-//
-// sendNack() - send back hard-code negative-acknowledge message
-//
-void IC746::sendNack() {
-  byte nack[] = {CAT_RIG_ADDR, CAT_CTRL_ADDR, CAT_NACK};
-//  displayBanner(String("Nack"));
-  send(nack, 3);
-}
-
-
-/*
-   readCMD - state machine to receive a command from the controller
-   States:
-      CAT_RCV_WAITING    - scan incoming serial data for first preamble byte
-      CAT_RCV_INIT       - second premable byte confirms start of message
-      CAT_RCV_RECEIVING  - fill command buffer until EOM received
-
-   Command format
-   |FE|FE|56|E0|cmd|sub-cmd|data|FD|
-
-    FE FE = preamble, FD = end of command
-    56 = transceiver default address for IC746 (unused)
-    E0 = CAT controller default address (unused)
-
-    Upon successful receipt of EOM, protocol requires echo back of enitre message
-    On interrupted preamble or buffer overflow (no EOM received), send NAK
-
-    On successful receipt of a command the global array cmdBuf
-    will have the received CAT command (without the preamble and EOM)
-*/
-boolean IC746::readCmd() {
-  byte bt;
-  boolean cmdRcvd = false;
-
-  while (Serial.available() && !cmdRcvd) {
-
-    bt = byte(Serial.read());
-
-    switch (rcvState) {
-
-      case CAT_RCV_WAITING:   // scan for start of new command
-        if (bt == CAT_PREAMBLE) {
-          rcvState = CAT_RCV_INIT;
-        }
-        break;
-
-      case CAT_RCV_INIT:      // check for second preamble byte
-        if (bt == CAT_PREAMBLE) {
-          rcvState = CAT_RCV_RECEIVING;
-        } else {              // error - should not happen, reset and report
-          rcvState = CAT_RCV_WAITING;
-          bytesRcvd = 0;
-          sendNack();
-        }
-        break;
-
-      case CAT_RCV_RECEIVING:
-        switch (bt) {
-
-          case CAT_EOM:        // end of message received, return for processing, reset state
-
-#ifdef DEBUG_CAT_DETAIL
-            dbg = "rcvd: ";
-            dbg += String(bytesRcvd);
-            dbg += ": ";
-            for (int i = 0; i < bytesRcvd; i++) {
-              dbg += String(cmdBuf[i], HEX);
-              dbg += " ";
-            }
-            catDebug.println(dbg.c_str());
-#endif
-
-            send(cmdBuf, bytesRcvd);  // echo received packet for protocol
-            cmdRcvd = true;
-            rcvState = CAT_RCV_WAITING;
-            cmdLength = bytesRcvd;
-            bytesRcvd = 0;
-            break;
-
-          default:            // fill command buffer
-            if (bytesRcvd <= CAT_CMD_BUF_LENGTH) {
-              cmdBuf[bytesRcvd] = bt;
-              bytesRcvd++;
-            } else {           // overflow - should not happen reset for new comand
-              rcvState = CAT_RCV_WAITING;
-              bytesRcvd = 0;
-              sendNack();      // report error
-            }
-            break;
-        }
-        break;
-    }
-  }
-  return cmdRcvd;
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-//
-//                        COMMAND PROCESSORS
-//
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-// doSmeter() - process the CAT_READ_SMETER Command
-// This command has two sub-commands, SMETER and SQUELCH, only SMETER is fully implemented
-//
-// The SMETER sub command requests the current Return S-meter readingscaled for IC 746 appropriate values
-//      It calls a user function returns 0-15  S0-9, +10, +20, +30, +40, +50 +60
-//      The mapping of s-units to IC746 equivalents done imperically using the CatBkt cat test program
-//
-// The second sub-command, SQUELCH request wheterh Squelch is open or closed.  Return a fixed value
-// of "Open" to keep the protocol happly
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-
-  void IC746::doSmeter() {
-  switch (cmdBuf[CAT_IX_SUB_CMD]) {
-    case CAT_READ_SUB_SMETER:
-      if (catGetSmeter) {
-                          //S0  S1  S2  S3  S4  S5  S6  S7   S8   S9  +10  +20  +30  +40  +50  +60
-        const byte smap[] = {0, 15, 25, 40, 55, 65, 75, 90, 100, 120, 135, 150, 170, 190, 210, 241};
-        byte s = catGetSmeter();
-
-        SmetertoBCD(smap[s]);
-  #ifdef DEBUG_CAT_DETAIL
-        dbg = "doSmeter- s:";
-        dbg += String(s);
-        dbg += " map: ";
-        dbg += String(smap[s]);
-        dbg += " BCD: ";
-        for (int i = CAT_IX_SMETER; i < CAT_IX_SMETER+2; i++) {
-          dbg += String(cmdBuf[i], HEX);
-          dbg += " ";
-        }
-        catDebug.println(dbg.c_str());
-  #endif
-
-      } else {
-        cmdBuf[CAT_IX_SMETER] = 0;      // user has not supplied S Meter function - keep the protocol happy
-        cmdBuf[CAT_IX_SMETER + 1] = 0;
-      }
-      sendResponse(cmdBuf, CAT_SZ_SMETER);
-      break;
-
-    case CAT_READ_SUB_SQL:        // Squelch condition 0=closed, 1=open
-      cmdBuf[CAT_IX_SQUELCH] = 1;
-      send(cmdBuf, CAT_SZ_SQUELCH);
-      break;
-  }
-  }
-
-
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-// doPtt() - process the CAT_PTT Command
-// CAT_PTT calls the user supplied functions to either put the rig in to Tx or Rx or to request the rigs
-// current Tx/Rx state
-//
-// A "read ptt" request does not have a data byte and is therefore one byte shorter
-// than a "set ptt" request.
-//      56 | E0 | 1C | 00      - Read request 1C is PTT command, sub-command 0 is uused, no data byte
-//      56 | E0 | 1C | 00 | 01 - Set Tx, trailing data bit 1 for Tx, 0 for Rx
-////////////////////////////////////////////////////////////////////////////////////////////////////////
-void IC746::doPtt() {
-  if (cmdLength == CAT_RD_LEN_SUB) {  // Read request
-    if (catGetPtt) {
-      cmdBuf[CAT_IX_PTT] = catGetPtt();
-      sendResponse(cmdBuf, CAT_SZ_PTT);
-    }
-  } else {               // Set request
-    if (catSetPtt) {
-      if (cmdBuf[CAT_IX_PTT] == CAT_PTT_TX) {
-        catSetPtt(true);
-      } else {
-        catSetPtt(false);
-      }
-    }
-    sendAck();  // always acknowledge "set" commands
-  }
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-// doSplit() - process the CAT_SPLIT Command
-// Call user supplied function to turn split on or off
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-void IC746::doSplit() {
-  switch (cmdBuf[CAT_IX_SUB_CMD]) {
-    case CAT_SPLIT_OFF:
-      if (catSplit) {
-        catSplit(false);
-      }
-      break;
-    case CAT_SPLIT_ON:
-    case CAT_SIMPLE_DUP:
-      if (catSplit) {
-        catSplit(true);
-      }
-    default:
-      break;
-  }
-  sendAck();
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-// doSetVfo() - process the CAT_SET_VFO Command, calls user supplied functions
-// SET_VFO with no sub-command selects VFO Tuning vice Memory Tuning (memory tuning is not implemented)
-// SET_VFO has four sub-commands:
-//    VFOA or VFOB - directs the rig to make the selected VFO the active VFO
-//    VFO_A_TO_B - directs the rig to copy the make both VFO frequencies the same as the Active VFO
-//    VFO_SWAP - directs the rig to exchange VFOA and VFOB
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-void IC746::doSetVfo() {
-
-  if (cmdLength == CAT_RD_LEN_NOSUB) {  // No sub-command - sets VFO Tuning vice memory tuning
-    sendAck();           // Memory tuning is not implemented so send ack to keep protocol happy
-    return;
-  }
-
-  switch (cmdBuf[CAT_IX_SUB_CMD]) {
-    case CAT_VFO_A:
-    case CAT_VFO_B:
-      if (catSetVFO) {
-        catSetVFO(cmdBuf[CAT_IX_SUB_CMD]);
-      }
-      break;
-    case CAT_VFO_A_TO_B:
-      if (catAtoB) {
-        catAtoB();
-      }
-      break;
-    case CAT_VFO_SWAP:
-      if (catSwapVfo) {
-        catSwapVfo();
-      }
-      break;
-  }
-  sendAck();
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-// doSetFreq() - proces CAT_SET_FREQ command
-// Call the user supplied function to set the righ frequency
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-void IC746::doSetFreq() {
-  if (catSetFreq) {
-    catSetFreq(BCDtoFreq());  // Convert the frequency BCD to Long and call the user function
-  }
-  sendAck();
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-// doReadFreq() - process the CAT_READ_FREQ command
-// Call the user supplied function to read set the rig frequency
-// Frequecies are sent and received in BCD - call the support functions to do the conversion
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-void IC746::doReadFreq() {
-  if (catGetFreq) {
-//    displayBanner(String("Read Freq"));
-    FreqtoBCD(catGetFreq());  // get the frequency, convert to BCD and stuff it in the response buffer
-    sendResponse(cmdBuf, CAT_SZ_FREQ);
-  }
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-// doSetMode() - process the CAT_SET_MODE command
-// Call the user function to put the rig into the requested mode. 
-// The rig must handle all of the possible modes
-//   CAT_MODE_LSB
-//   CAT_MODE_USB
-//   CAT_MODE_AM:
-//   CAT_MODE_CW - (LSB)
-//   CAT_MODE_RTTY - (LSB)
-//   CAT_MODE_FM
-//   CAT_MODE_CW_R - (Reverse - USB)
-//   CAT_MODE_RTTY_R - (Reverse - LSB)
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-void IC746::doSetMode() {
-  if (catSetMode) {
-
-    catSetMode(cmdBuf[CAT_IX_SUB_CMD]);
-   
-  }
-  sendAck();
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-// doReadMode() - process the CAT_READ_MODE command
-// Call the user function to query the rig's current mode
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-void IC746::doReadMode() {
-  if (catGetMode) {
-    cmdBuf[CAT_IX_MODE] = catGetMode();
-    cmdBuf[CAT_IX_MODE+1] = CAT_MODE_FILTER1;  // protocol filter - return reasonable value
-    sendResponse(cmdBuf, CAT_SZ_MODE);
-  }
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-// doMisc() - process the CAT_MISC command
-//
-// The MISC command has several unrelated sub-commands
-// The only one implemented here is the sub-command to read the IF Filter Setting
-// The code sends a hard-coded response since most homebrew rigs won't have such a setting
-// but programs like WSJTX and FLDIGI request it
-//
-// Commands that "set" values are replied to with an ACK message
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-void IC746::doMisc() {
-  switch (cmdBuf[CAT_IX_SUB_CMD]) {
-    case CAT_READ_IF_FILTER:
-      cmdBuf[CAT_IX_IF_FILTER] = 0;
-      sendResponse(cmdBuf, CAT_SZ_IF_FILTER);
-      break;
-
-    // Not implemented
-    // Reply with ACK to keep the protocol happy
-    case CAT_SET_MEM_CHAN:
-    case CAT_SET_BANDSTACK:
-    case CAT_SET_MEM_KEYER:
-      sendAck();
-      break;
-  }
-}
-
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-//                       UNIMPLEMENTED COMMAND STUBS
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-// doUnimplemented() - reasonable processing for features that are not fully implemented
-//
-// Unimplimented command handling
-//
-// These following commands are used to both set and read various parameters in the IC-746 that are not
-// typically implemented in a homebrew transceiver.
-// Commands requesting the state of various parameters require one or two data bytes returned.
-// We return zero in all cases which typically means the requsted feature is OFF - eg AGC, NB, VOX, etc.
-// Command that "set" various parameters only require an ACK reply
-// A "read" request has no data byte and is one byte shorter than a set request  (length =4)
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-void IC746::doUnimplemented_1b() {
-  if (cmdLength == CAT_RD_LEN_SUB) {        // Read request
-    cmdBuf[CAT_IX_DATA] = 0;   // return 0 for all read requests
-    sendResponse(cmdBuf, CAT_SZ_UNIMP_1B);
-  } else {                   // Set parameter request
-    sendAck();               // Send an acknowledgement to keep the protocol happy
-  }
-}
-
-void IC746::doUnimplemented_2b() {
-  if (cmdLength == CAT_RD_LEN_SUB) {        // Read request
-    cmdBuf[CAT_IX_DATA] = 0;   // return 0 for all read requests
-    cmdBuf[CAT_IX_DATA+1] = 0; 
-    sendResponse(cmdBuf, CAT_SZ_UNIMP_2B);
-  } else {                   // Set parameter request
-    sendAck();               // Send an acknowledgement to keep the protocol happy
-  }
-}
-
-void IC746::doTuneStep() {
-  if (cmdLength == CAT_RD_LEN_NOSUB) {             // Read request
-    cmdBuf[CAT_IX_TUNE_STEP] = 0;   // return 0 for all read requests
-    sendResponse(cmdBuf, CAT_SZ_TUNE_STEP);
-  } else {                   // Set parameter request
-    sendAck();               // Send an acknowledgement to keep the protocol happy
-  }
-}
-
-void IC746::doAntSel() {
-  if (cmdLength == CAT_RD_LEN_NOSUB) {           // Read request
-    cmdBuf[CAT_IX_ANT_SEL] = 0;   // return 0 for all read requests
-    sendResponse(cmdBuf, CAT_SZ_ANT_SEL);
-  } else {                   // Set parameter request
-    sendAck();               // Send an acknowledgement to keep the protocol happy
-  }
-}
-
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-//  check() - process commands from CAT controller, should be called from the sketch main loop
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-void IC746::check() {
-
-  // do nothing if it was disabled by software
-  if (!enabled) return;
-
-  // Receive a CAT Command
-  if (!readCmd()) return;
-
-/*
-#ifdef DEBUG_CAT_DETAIL
-  dbg = "rcvd: ";
-  dbg += String(cmdLength);
-  dbg += ": ";
-  for (int i = 0; i < cmdLength; i++) {
-    dbg += String(cmdBuf[i], HEX);
-    dbg += " ";
-  }
-  catDebug.println(dbg.c_str());
-#endif
-*/
-  // Process the command - command opcode is at CAT_IX_CMD location in command buffer
-  switch (cmdBuf[CAT_IX_CMD]) {
-
-    case CAT_PTT:
-      doPtt();
-      break;
-
-    case CAT_SPLIT:
-      doSplit();
-      break;
-
-    case CAT_SET_VFO:
-      doSetVfo();
-      break;
-
-    case CAT_SET_FREQ:
-      doSetFreq();
-      break;
-
-    case CAT_SET_MODE:
-      doSetMode();
-      break;
-
-    case CAT_READ_MODE:
-      doReadMode();
-      break;
-
-    case CAT_READ_FREQ:
-      doReadFreq();
-      break;
-
-    case CAT_READ_SMETER:
-      doSmeter();
-      break;
-
-    case CAT_MISC:
-      doMisc();
-      break;
-
-    case CAT_READ_ID:
-      cmdBuf[CAT_IX_ID] = CAT_RIG_ADDR;      // Send back the transmitter ID
-      send(cmdBuf, CAT_SZ_ID);
-      break;
-
-    // Unimplemented commands that request one or two bytes of data from the rig - keep the protocol happy
-    case CAT_SET_RD_STEP:
-      doTuneStep();
-      break;
-      
-    case CAT_SET_RD_ANT:
-      doAntSel();
-      break;
-      
-    case CAT_SET_RD_ATT:
-    case CAT_SET_RD_PARAMS2:
-      doUnimplemented_1b();
-      break;
-
-    case CAT_SET_RD_PARAMS1:
-    case CAT_READ_OFFSET:
-      doUnimplemented_2b();
-      break;
-      
-    default:                // For all other commands respond with an NACK
-#ifdef DEBUG_CAT
-      String dbg;
-      dbg = "unimp cmd: ";
-      dbg += String(cmdBuf[CAT_IX_CMD], HEX);
-      dbg += " ";
-      dbg += String(cmdBuf[CAT_IX_SUB_CMD], HEX);
-//      displayBanner(dbg);
-      catDebug.println(dbg.c_str());
-#endif
-      sendNack();
-      break;
-  }
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-//
-//                        UTILITY FUNCTIONS
-//
-///////////////////////////////////////////////////////////////////////////////////////////////////////
-//
-// BCD FrequencyConversion Routines
-// Convert BCD frequency to/from command buffer to/from long
-// Format (beginning at first data byte in buffer is
-//  Byte 0 10Hz   | 1Hz
-//  Byte 1 1KHz   | 100Hz
-//  Byte 2 100KHz | 10KHz
-//  Byte 3 10MHz  | 1MHz
-// Example: 7,123,456 is encoded 56 | 34 | 12 | 07
-//
-long IC746::BCDtoFreq() {
-  long freq;
-
-  freq = cmdBuf[CAT_IX_FREQ] & 0xf;                 // lower 4 bits
-  freq += 10L * (cmdBuf[CAT_IX_FREQ] >> 4);          // upper 4 bits
-  freq += 100L * (cmdBuf[CAT_IX_FREQ + 1] & 0xf);
-  freq += 1000L * (cmdBuf[CAT_IX_FREQ + 1] >> 4);
-  freq += 10000L * (cmdBuf[CAT_IX_FREQ + 2] & 0xf);
-  freq += 100000L * (cmdBuf[CAT_IX_FREQ + 2] >> 4);
-  freq += 1000000L * (cmdBuf[CAT_IX_FREQ + 3] & 0xf);
-  freq += 10000000L * (cmdBuf[CAT_IX_FREQ + 3] >> 4);
-  freq += 100000000L * (cmdBuf[CAT_IX_FREQ + 4] & 0xf);
-  freq += 1000000000L * (cmdBuf[CAT_IX_FREQ + 4] >> 4);
-
-
-  return freq;
-}
-
-void IC746::FreqtoBCD(long freq) {
-  byte ones, tens, hund, thou, ten_thou, hund_thou, mil, ten_mil, hund_mil, thou_mil;
-
-  ones =     byte(freq % 10);
-  tens =     byte((freq / 10L) % 10);
-  cmdBuf[CAT_IX_FREQ] = byte((tens << 4)) | ones;
-
-  hund =      byte((freq / 100L) % 10);
-  thou =      byte((freq / 1000L) % 10);
-  cmdBuf[CAT_IX_FREQ + 1] = byte((thou << 4)) | hund;
-
-  ten_thou =  byte((freq / 10000L) % 10);
-  hund_thou = byte((freq / 100000L) % 10);
-  cmdBuf[CAT_IX_FREQ + 2] = byte((hund_thou << 4)) | ten_thou;
-
-  mil =       byte((freq / 1000000L) % 10);
-  ten_mil =   byte(freq  / 10000000L) % 10; 
-  cmdBuf[CAT_IX_FREQ + 3] = byte((ten_mil << 4)) | mil;
-
-  hund_mil = byte((freq / 100000000L) % 10);
-  thou_mil = byte(freq  / 1000000000L % 10); // Allow frequencies up to 9999.999999 MHz to be enterd
-  cmdBuf[CAT_IX_FREQ + 4] = byte((thou_mil << 4)) | hund_mil;
-}
-
-void IC746::SmetertoBCD(byte s) {
-  byte ones, tens, hund;
-
-  ones =     byte(s % 10);
-  tens =     byte((s / byte(10)) % 10);
-  cmdBuf[CAT_IX_SMETER+1] = byte((tens << 4)) | ones;
-
-  hund =      byte((s / byte(100)) % 10);
-  cmdBuf[CAT_IX_SMETER] = hund;
-
-}
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   V1.3 1/21/2023
+      - Included all defined modes in Get/Set Mode (thanks to Mike, KA4CDN)
+      - Fix to allow frequencies greater than 100MHz -(thanks to Bob, KA1GT)
+
+   V1.2 10/22/2021
+      - Fixes bug that caused "WSJTX Rig Control Error"  for versions after 2.2.2
+      - The problem was caused by an unsupported CIV command being sent by WSJTX
+      - This fix responds to unimplemented commands with a NACK instead of an ACK
+      - Bug was reported on the WSJTX groups board.
+
+   V1.1 2/3/2021 
+      - various fixes, now works properly with OmniRig and flrig
+      - smeter now returns proper BCD code - calibrated to emulate ICOM responses
+      
+   V1.0 1/24/2021
+      - Initial build
+   Inspired by:  ft857d CAT Library, by Pavel Milanes, CO7WT, pavelmc@gmail.com
+
+   Emulates an ICOM 746 CAT functionality to work with all ham radio software that include CAT control
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***************************************************************************/
+
+#include "Arduino.h"
+#include "IC746.h"
+#include "CATBcd.h"
+
+// Trace points compile to nothing unless CAT_FEATURE_TRACE is on
+#if CAT_FEATURE_TRACE
+#define CAT_TRACE(code, data, len)  tracer.record((code), (data), (len))
+#else
+#define CAT_TRACE(code, data, len)
+#endif
+
+// ... and so do the metrics counters unless CAT_FEATURE_METRICS is on
+#if CAT_FEATURE_METRICS
+#define CAT_COUNT(counter, n)       CATMetrics::bump(stats.counter, (n))
+#else
+#define CAT_COUNT(counter, n)
+#endif
+
+// Command indices
+//
+// Command structure after preamble and EOM have been discarded
+// |56|E0|cmd|sub-cmd|data
+//   56 - fixed transceiver address for IC746
+//   E0 - fixed cat xontroller address
+// The sub-command field varies by command. For somme commands the sub-cmd field is not supplied and the data
+// begins immediatedly follwing the command.
+//
+// The following are the array indedes within the command buffer for command elements that are sent with the command
+// or are where we put data to return to the conroller
+//
+#define CAT_IX_TO_ADDR     0
+#define CAT_IX_FROM_ADDR   1
+#define CAT_IX_CMD         2
+#define CAT_IX_SUB_CMD     3
+#define CAT_IX_FREQ        3   // Set Freq has no sub-command
+#define CAT_IX_MODE        3   // Get mode has no sub-command
+#define CAT_IX_TUNE_STEP   3   // Get step has no sub-command
+#define CAT_IX_ANT_SEL     3   // Get amt has no sub-command
+#define CAT_IX_PTT         4   // PTT RX/TX indicator
+#define CAT_IX_IF_FILTER   4   // IF Filter value
+#define CAT_IX_SMETER      4   // S Meter 0-255
+#define CAT_IX_SQUELCH     4   // Squelch 0=close, 1= open
+#define CAT_IX_ID          4
+#define CAT_IX_MEM_CHAN    3   // Select memory has no sub-command
+#define CAT_IX_MEM_DATA    6   // Memory contents, after the sub-command and channel number
+#define CAT_IX_BSR_BAND    4   // Band stacking register - band code, register, then the contents
+#define CAT_IX_BSR_REG     5
+#define CAT_IX_BSR_DATA    6
+#define CAT_IX_DATA        4   // Data following sub-comand
+
+// Lentgth of commands that request data 
+#define CAT_RD_LEN_NOSUB   3   //  3 bytes - 56 E0 cc
+#define CAT_RD_LEN_SUB     4   //  4 bytes - 56 E0 cc ss  (cmd, sub command)
+
+// Length of commands the receiver picks out
+#define CAT_RX_LEN_PTT     5   //  5 bytes - 56 E0 1C 00 nn  (set PTT)
+
+// Length of data responses
+#define CAT_SZ_SMETER      6   //  6 bytes - E0 56 15 02 nn nn 
+#define CAT_SZ_SQUELCH     5   //  5 bytes - E0 56 15 01 nn
+#define CAT_SZ_PTT         5   //  5 bytes - E0 56 1C 00 nn
+#define CAT_SZ_FREQ        8   //  8 bytes - E0 56 03 ff ff ff ff ff  (frequency in little endian BCD)
+#define CAT_SZ_MODE        5   //  5 bytes - E0 56 04 mm ff  (mode, then filter)
+#define CAT_SZ_IF_FILTER   5   //  5 bytes - E0 56 1A 03 nn
+#define CAT_SZ_TUNE_STEP   4   //  4 bytes - E0 56 10 nn
+#define CAT_SZ_ANT_SEL     4   //  4 bytes - E0 56 12 nn
+#define CAT_SZ_ID          5   //  5 bytes - E0 56 19 00 56    (returns RIG ID)
+#define CAT_SZ_UNIMP_1B    5   //  5 bytes - E0 56 NN SS 00    (unimplemented commands that require 1 data byte
+#define CAT_SZ_UNIMP_2B    6   //  6 bytes - EO 56 NN SS 00 00 (unimplemented commandds that required 2 data bytes
+#define CAT_SZ_SET_FREQ    8   //  8 bytes - 56 E0 05 ff ff ff ff ff
+#define CAT_SZ_TCV_FREQ    8   //  8 bytes - 00 56 00 ff ff ff ff ff  (transceive frequency broadcast)
+#define CAT_SZ_TCV_MODE    5   //  5 bytes - 00 56 01 mm ff  (transceive mode broadcast)
+#define CAT_SZ_SPLIT       4   //  4 bytes - E0 56 0F nn
+#define CAT_SZ_VFO_FREQ    9   //  9 bytes - E0 56 25 ss ff ff ff ff ff  (selected / unselected VFO)
+#define CAT_SZ_VFO_MODE    7   //  7 bytes - E0 56 26 ss mm dd ff  (mode, data mode, filter)
+#define CAT_SZ_SEL_MEM     5   //  5 bytes - 56 E0 08 cc cc  (channel, 2 digit pairs)
+#define CAT_SZ_MEM_READ    6   //  6 bytes - 56 E0 1A 00 cc cc
+#define CAT_SZ_MEM_BLANK   7   //  7 bytes - E0 56 1A 00 cc cc FF  (blank channel)
+#define CAT_SZ_MEM        14   // 14 bytes - E0 56 1A 00 cc cc ff ff ff ff ff mm fl ss  (ss - split)
+#define CAT_SZ_BAND_EDGE  14   // 14 bytes - E0 56 02 ff ff ff ff ff 2D ff ff ff ff ff  (low - high)
+#define CAT_SZ_BSR_READ    6   //  6 bytes - 56 E0 1A 01 bb rr  (band code, register 01 - 03)
+#define CAT_SZ_BSR        13   // 13 bytes - E0 56 1A 01 bb rr ff ff ff ff ff mm fl
+
+
+
+/*
+   Constructor - the default transport is the board's serial port "Serial"
+*/
+IC746::IC746() : serialPort(Serial) {
+  transport = &serialPort;
+  handler = &callbacks;
+#if CAT_FEATURE_BANDSTACK
+  // every register starts at the bottom of its band, LSB below 10 MHz and USB above
+  for (byte b = 0; b < CAT_BANDS; b++) {
+    CATBandEdge e;
+    catBandEdge(b, e);
+    for (byte r = 0; r < CAT_BANDSTACK_DEPTH; r++) {
+      bandRegs[b][r].freq = e.low;
+      bandRegs[b][r].mode = e.low < 10000000UL ? CAT_MODE_LSB : CAT_MODE_USB;
+    }
+  }
+#endif
+}
+
+/*
+   Initializer, it initiates the serial port in the
+   default mode for the radio: 9600 @ 8N2
+*/
+void IC746::begin() {
+  begin(serialPort, 9600, SERIAL_8N2);
+}
+
+// Alternative initializer with a custom baudrate and mode
+void IC746::begin(long br, int mode, byte profile) {
+  begin(serialPort, br, mode, profile);
+}
+
+// Alternative initializer with a user supplied transport that is already open
+void IC746::begin(CATTransport &port, byte profile) {
+  static const CATLink profiles[] PROGMEM = {
+    // echo   nackFraming  checkAddress  gap
+    {true,    true,        true,         CAT_LINK_CIV_GAP},   // CAT_LINK_CIV
+    {false,   false,       false,        0},                  // CAT_LINK_USB
+    {true,    false,       false,        0},                  // CAT_LINK_HAMLIB
+  };
+  CATLink l;
+
+  memcpy_P(&l, &profiles[profile <= CAT_LINK_HAMLIB ? profile : CAT_LINK_CIV], sizeof(l));
+  setLink(l);
+  transport = &port;
+}
+
+// Alternative initializer with a user supplied transport, custom baudrate and mode
+// A baudrate of CAT_BAUD_AUTO follows the controller's rate, see doAutoBaud()
+void IC746::begin(CATTransport &port, long br, int mode, byte profile) {
+#if CAT_FEATURE_AUTOBAUD
+  abOn = (br == CAT_BAUD_AUTO);
+  if (abOn) {
+    abMode = mode;
+    begin(port, profile);
+    setBaud(0);
+    return;
+  }
+#endif
+  port.begin(br, mode);
+  begin(port, profile);
+}
+
+// Link settings other than the three profiles
+void IC746::setLink(const CATLink &custom) {
+  link = custom;
+}
+
+#if CAT_FEATURE_AUTOBAUD
+////////////////////////////////////////////////////////////////////////////////
+// Automatic baud rate
+//
+// The port starts at the fastest rate of the table.  A controller sending slower
+// turns its first FE into a byte of a known shape: the start bit and the low zero
+// bit of FE last 2k of our bit times, k = our rate / its rate, so the byte read
+// ends in 2k - 1 zero bits (F8 for k = 2, E0 for 3, 80 for 4, 00 for more).  The
+// first byte after a quiet line gives the controller's rate in one step when k is
+// 2 - 4, and a jump down past the rates it cannot be otherwise.  A rate that gets
+// CAT_AUTOBAUD_ERRORS bad bytes or framing errors and no good command gives way to
+// the next one, round the table.  A good command locks the rate; a locked rate
+// starts the search again after CAT_AUTOBAUD_ERRORS errors with no good command.
+//
+// After a change the rest of the frame on the line is garbage at any rate, so
+// nothing counts until the line has been quiet for CAT_AUTOBAUD_QUIET ms - the
+// controller waiting for the answer it is not going to get.  While searching,
+// framing errors are not NACKed: at the wrong rate that is only more noise.
+////////////////////////////////////////////////////////////////////////////////
+
+#define CAT_AUTOBAUD_QUIET  20      // ms
+
+#define CAT_BAUD_RATES  8
+static const long catBaudRates[CAT_BAUD_RATES] PROGMEM = {
+  115200, 57600, 38400, 19200, 9600, 4800, 2400, 1200
+};
+
+static long catBaudRate(byte index) {
+  long rate;
+  memcpy_P(&rate, &catBaudRates[index], sizeof(rate));
+  return rate;
+}
+
+long IC746::baudRate() {
+  return abOn ? catBaudRate(abRate) : 0;
+}
+
+boolean IC746::baudLocked() {
+  return abOn && abLocked;
+}
+
+void IC746::setBaud(byte index) {
+  abRate = index;
+  abErrors = 0;
+  abSettled = false;
+  abSampled = true;
+  rxQuiet = millis();
+  transport->end();
+  transport->begin(catBaudRate(index), abMode);
+  while (transport->available()) transport->read();   // read at the old rate
+  rxLock();
+  rcvState = CAT_RCV_WAITING;
+  bytesRcvd = 0;
+  rxUnlock();
+  traceBaud();
+}
+
+void IC746::traceBaud() {
+#if CAT_FEATURE_TRACE
+  long rate = catBaudRate(abRate);
+  byte d[5] = {byte(rate), byte(rate >> 8), byte(rate >> 16), byte(rate >> 24), abLocked};
+  CAT_TRACE(CAT_TRC_BAUD, d, sizeof(d));
+#endif
+}
+
+//
+// guessBaud() - the controller's rate from the first byte after a quiet line, if
+// it was a preamble sent slower than we listen.  False if it tells nothing.
+//
+boolean IC746::guessBaud(byte b) {
+  byte zeros = 1;                  // the start bit
+  long rate = catBaudRate(abRate);
+  long target;
+
+  if (b == CAT_PREAMBLE) return false;
+  while (zeros < 9 && !(b & 1)) {
+    zeros++;
+    b >>= 1;
+  }
+  if (zeros == 9) {
+    target = rate * 2 / 9;         // k is 4.5 or more - this fast at most
+  } else if (!(zeros & 1) && zeros > 2) {
+    target = rate / (zeros / 2);
+  } else {
+    return false;
+  }
+
+  for (byte i = abRate + 1; i < CAT_BAUD_RATES; i++) {
+    long r = catBaudRate(i);
+    long off = r > target ? r - target : target - r;
+    if (zeros == 9 ? r <= target : off < target / 32) {
+      setBaud(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+void IC746::doAutoBaud() {
+  byte frames, noise, nacks, errors;
+
+  if (!abOn) return;
+  frames = abFrames;               // the receiver may be counting from an interrupt
+  noise = abNoise;
+  nacks = rxNacks;
+  errors = (byte)(noise - abNoiseSeen) + (byte)(nacks - abNacksSeen);
+  abNoiseSeen = noise;
+  abNacksSeen = nacks;
+
+  if (frames != abFramesSeen) {    // a good command - this is the rate
+    abFramesSeen = frames;
+    abErrors = 0;
+    abSettled = true;
+    if (!abLocked) {
+      abLocked = true;
+      traceBaud();
+    }
+  }
+
+  if (millis() - rxQuiet >= CAT_AUTOBAUD_QUIET) {
+    abSettled = true;
+    if (!abLocked) abSampled = false;   // catch the first byte of the next frame
+    return;
+  }
+
+  if (!abLocked && abSampled && abSettled && guessBaud(abSample)) return;
+  if (!abSettled || !errors) return;
+
+  abErrors = abErrors > 255 - errors ? 255 : abErrors + errors;
+  if (abErrors >= CAT_AUTOBAUD_ERRORS) {
+    if (abLocked) {                // the controller has changed its rate
+      abLocked = false;
+      setBaud(0);
+    } else {
+      setBaud(abRate + 1 < CAT_BAUD_RATES ? abRate + 1 : 0);
+    }
+  }
+}
+#endif
+
+/*
+   Linking user supplied callback functions
+*/
+
+// PTT
+void IC746::addCATPtt(void (*userFunc)(boolean)) {
+  callbacks.catSetPtt = userFunc;
+}
+
+// Split
+void IC746::addCATsplit(void (*userFunc)(boolean)) {
+  callbacks.catSplit = userFunc;
+}
+
+// VFO A=B - set both VFOs to be the same as the active VFO
+void IC746::addCATAtoB(void (*userFunc)(void)) {
+  callbacks.catAtoB = userFunc;
+}
+
+// Swap Active VFO
+void IC746::addCATSwapVfo(void (*userFunc)(void)) {
+  callbacks.catSwapVfo = userFunc;
+}
+
+// Get the freq of operation, the function must return the freq
+void IC746::addCATGetFreq(long (*userFunc)(void)) {
+  callbacks.catGetFreq = userFunc;
+}
+
+// Get the mode of operation, the function must return the mode
+void IC746::addCATGetMode(byte (*userFunc)(void)) {
+  callbacks.catGetMode = userFunc;
+}
+
+// GetPTT - function must return true for Tx and false for Rx
+void IC746::addCATGetPtt(boolean (*userFunc)(void)) {
+  callbacks.catGetPtt = userFunc;
+}
+
+
+// S meter (user function must return 0-15)
+void IC746::addCATSMeter(byte (*userFunc)(void)) {
+  callbacks.catGetSmeter = userFunc;
+}
+
+// Set Frequency - user function must accept a long as the freq in hz
+void IC746::addCATFSet(void (*userFunc)(long)) {
+  callbacks.catSetFreq = userFunc;
+}
+
+// Set Mode -  user function must interpret MODE per the constants in IC746.h
+void IC746::addCATMSet(void (*userFunc)(byte)) {
+  callbacks.catSetMode = userFunc;
+}
+
+// SEt VFOA or B - user function must interpret VFO per the constants in IC746.h
+void IC746::addCATVSet(void (*userFunc)(byte)) {
+  callbacks.catSetVFO = userFunc;
+}
+
+// Handler object in place of the functions above
+void IC746::setHandler(IC746Handler &h) {
+  handler = &h;
+}
+
+/*
+   CATCallbacks - the handler that calls the addCATxxx() functions, if they were supplied
+*/
+void CATCallbacks::setPtt(boolean tx) {
+  if (catSetPtt) catSetPtt(tx);
+}
+
+void CATCallbacks::setSplit(boolean on) {
+  if (catSplit) catSplit(on);
+}
+
+void CATCallbacks::vfoAtoB() {
+  if (catAtoB) catAtoB();
+}
+
+void CATCallbacks::swapVfo() {
+  if (catSwapVfo) catSwapVfo();
+}
+
+void CATCallbacks::setFreq(CATFreq freq) {
+  if (catSetFreq) catSetFreq(long(freq));
+}
+
+void CATCallbacks::setMode(byte mode) {
+  if (catSetMode) catSetMode(mode);
+}
+
+void CATCallbacks::setVfo(byte vfo) {
+  if (catSetVFO) catSetVFO(vfo);
+}
+
+boolean CATCallbacks::getFreq(CATFreq &freq) {
+  if (!catGetFreq) return false;
+  freq = CATFreq((unsigned long)catGetFreq());   // a V1.3 long above 2.147 GHz is negative
+  return true;
+}
+
+boolean CATCallbacks::getMode(byte &mode) {
+  if (!catGetMode) return false;
+  mode = catGetMode();
+  return true;
+}
+
+boolean CATCallbacks::getPtt(boolean &tx) {
+  if (!catGetPtt) return false;
+  tx = catGetPtt();
+  return true;
+}
+
+boolean CATCallbacks::getSmeter(byte &s) {
+  if (!catGetSmeter) return false;
+  s = catGetSmeter();
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Shadow registers
+//
+// With the shadow on, polls for frequency, mode, PTT and S-meter are answered from
+// these copies of the rig state instead of calling the user's "get" functions.  The
+// sketch pushes a new value whenever something changes at the rig (knob, band switch,
+// PTT button, new meter reading).  CAT commands that set a value update the copy
+// themselves, as well as calling the user's "set" function.
+// Call these from the main loop, not from an interrupt.
+////////////////////////////////////////////////////////////////////////////////
+
+#if CAT_FEATURE_SHADOW
+void IC746::useShadow(boolean on) {
+  shadowOn = on;
+}
+
+// Frequency of the active VFO
+void IC746::updateFreq(CATFreq f) {
+  updateFreq(shVfo, f);
+}
+
+// Frequency of a given VFO (CAT_VFO_A or CAT_VFO_B), active or not
+void IC746::updateFreq(byte vfo, CATFreq f) {
+  vfo &= 1;
+#if CAT_FEATURE_TRANSCEIVE
+  if (vfo == shVfo && f != shFreq[vfo]) {
+    tcvFreqPending = true;
+  }
+#endif
+  shFreq[vfo] = f;
+  trackBand(false);
+}
+
+void IC746::updateVfo(byte vfo) {
+  vfo &= 1;
+#if CAT_FEATURE_TRANSCEIVE
+  if (shFreq[vfo] != shFreq[shVfo]) {
+    tcvFreqPending = true;
+  }
+  if (shMode[vfo] != shMode[shVfo]) {
+    tcvModePending = true;
+  }
+#endif
+  shVfo = vfo;
+  trackBand(false);
+}
+
+// Mode of the active VFO
+void IC746::updateMode(byte mode) {
+  updateMode(shVfo, mode);
+}
+
+// Mode of a given VFO, active or not
+void IC746::updateMode(byte vfo, byte mode) {
+  vfo &= 1;
+#if CAT_FEATURE_TRANSCEIVE
+  if (vfo == shVfo && mode != shMode[vfo]) {
+    tcvModePending = true;
+  }
+#endif
+  shMode[vfo] = mode;
+  trackBand(false);
+}
+
+void IC746::updateSplit(boolean on) {
+  shSplit = on;
+}
+
+void IC746::updatePtt(boolean tx) {
+  shPtt = tx;
+}
+
+// S meter 0-15, as returned by the S meter callback
+void IC746::updateSmeter(byte s) {
+  shSmeter = s > 15 ? 15 : s;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// The VFO model
+//
+// The library keeps both VFOs - frequency and mode - which one is selected and
+// split, whether or not the shadow registers answer the polls.  CAT commands keep
+// them, and the sketch's updateXxx() calls.  In split the rig receives on the
+// active VFO and transmits on the other, txVfo().
+////////////////////////////////////////////////////////////////////////////////
+
+CATFreq IC746::vfoFreq(byte vfo) {
+  return shFreq[vfo & 1];
+}
+
+byte IC746::vfoMode(byte vfo) {
+  return shMode[vfo & 1];
+}
+
+byte IC746::activeVfo() {
+  return shVfo;
+}
+
+boolean IC746::splitOn() {
+  return shSplit;
+}
+
+byte IC746::txVfo() {
+  return shSplit ? shVfo ^ 1 : shVfo;
+}
+
+// Refresh the copy of the active VFO before it is copied or swapped, or stored - without the shadow
+// registers the sketch does not push the changes made at the rig.  A select does not refresh it:
+// the VFO left is only marked in shStale, and read back by syncOther() if a 25 / 26 asks for it.
+void IC746::syncActive() {
+  CATFreq f;
+  byte m;
+
+  if (shadowOn) return;
+  flushFreq();
+  if (handler->getFreq(f)) shFreq[shVfo] = f;
+  if (handler->getMode(m)) shMode[shVfo] = m;
+  shStale &= ~(1 << shVfo);
+  trackBand(false);
+}
+
+#if CAT_FEATURE_DUAL_VFO
+// Refresh the copy of the unselected VFO if a select left it behind - select it, read it and select
+// the active VFO again, as a set of the unselected VFO does for a handler without setVfoFreq()
+void IC746::syncOther() {
+  byte other = shVfo ^ 1;
+  CATFreq f;
+  byte m;
+
+  if (shadowOn || !(shStale & (1 << other))) return;
+  shStale &= ~(1 << other);
+#if CAT_FEATURE_ASYNC
+  ackDeferOk = false;
+#endif
+  handler->setVfo(other);
+  if (handler->getFreq(f)) shFreq[other] = f;
+  if (handler->getMode(m)) shMode[other] = m;
+  handler->setVfo(shVfo);
+}
+#endif
+
+// Follow the active VFO from band to band.  Entering a band pushes its stacking registers down, and
+// register 1 then follows the VFO while it stays.  notify tells the handler, before the retune.
+void IC746::trackBand(boolean notify) {
+#if CAT_FEATURE_BANDSTACK
+  byte b = catBand(shFreq[shVfo]);
+
+  if (b != curBand) {
+    curBand = b;
+    if (b != CAT_BAND_NONE) {
+      memmove(&bandRegs[b][1], &bandRegs[b][0], (CAT_BANDSTACK_DEPTH - 1) * sizeof(BandReg));
+    }
+    if (notify) handler->setBand(b);
+  }
+  if (b != CAT_BAND_NONE) {
+    bandRegs[b][0].freq = shFreq[shVfo];
+    bandRegs[b][0].mode = shMode[shVfo];
+  }
+#else
+  (void)notify;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Transceive
+//
+// With transceive on, a frequency or mode change pushed by the sketch (updateFreq(),
+// updateVfo(), updateMode()) is broadcast to all controllers with the unsolicited
+// commands 00 (frequency) and 01 (mode), so they can stop polling.
+//   |FE|FE|00|56|00|ff|ff|ff|ff|ff|FD|
+//   |FE|FE|00|56|01|mm|ff|FD|
+// Changes are coalesced - at most one broadcast of each per minInterval milliseconds,
+// carrying the latest value.  Nothing is sent while a controller is in the middle of
+// sending a command.  Changes made by CAT commands are not broadcast.
+////////////////////////////////////////////////////////////////////////////////
+
+#if CAT_FEATURE_TRANSCEIVE
+void IC746::setTransceive(boolean on, unsigned int minInterval) {
+  tcvOn = on;
+  tcvInterval = minInterval;
+  tcvFreqPending = on;      // announce the current state straight away - even in the
+  tcvModePending = on;      // first interval after power up
+  tcvLast = millis() - minInterval;
+}
+#endif
+
+//
+// A broadcast waits, still pending, while the transmit queue has no room for it - it is not
+// dropped, and the interval only starts once something went out.
+//
+void IC746::doTransceive() {
+#if CAT_FEATURE_TRANSCEIVE
+  byte frame[CAT_SZ_TCV_FREQ];
+  boolean sent = false;
+
+  if (!tcvOn || !(tcvFreqPending || tcvModePending)) return;
+  if (rxBusy()) return;                               // the bus is busy with a command
+  if (millis() - tcvLast < tcvInterval) return;
+
+  frame[CAT_IX_TO_ADDR] = CAT_BCAST_ADDR;
+  frame[CAT_IX_FROM_ADDR] = CAT_RIG_ADDR;
+
+  if (tcvFreqPending && txFree() >= CAT_SZ_TCV_FREQ + CAT_FRAME_OVERHEAD) {
+    frame[CAT_IX_CMD] = CAT_SET_TCV_FREQ;
+    catFreqToBCD(shFreq[shVfo], &frame[CAT_IX_FREQ], CAT_FREQ_BYTES);
+    if (send(frame, CAT_SZ_TCV_FREQ)) {
+      tcvFreqPending = false;
+      sent = true;
+    }
+  }
+
+  if (tcvModePending && txFree() >= CAT_SZ_TCV_MODE + CAT_FRAME_OVERHEAD) {
+    frame[CAT_IX_CMD] = CAT_SET_TCV_MODE;
+    frame[CAT_IX_MODE] = shMode[shVfo];
+    frame[CAT_IX_MODE + 1] = CAT_MODE_FILTER1;
+    if (send(frame, CAT_SZ_TCV_MODE)) {
+      tcvModePending = false;
+      sent = true;
+    }
+  }
+
+  if (sent) tcvLast = millis();
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Protocol Message Handling
+////////////////////////////////////////////////////////////////////////////////
+
+//
+// Send a message back to CAT controller
+// Format PREAMBLE, PREAMBLE, MSG, EOM
+//
+// The frame is queued in the transmit ring buffer and written out by drainTx(), so the
+// caller never waits on the UART.  A frame that does not fit is dropped as a whole
+// (a partial frame would only confuse the controller) and false is returned.
+//
+boolean IC746::send(byte *buf, int len) {
+  if (!queue(buf, len)) {
+    CAT_TRACE(CAT_TRC_TX_DROP, buf, len);
+    CAT_COUNT(txDrops, 1);
+    return false;
+  }
+  CAT_TRACE(CAT_TRC_TX, buf, len);
+  return true;
+}
+
+// queue() - the frame, untraced (the echo of a command is implied by its RX trace record)
+boolean IC746::queue(const byte *buf, int len) {
+  if (len + CAT_FRAME_OVERHEAD > txFree()) {
+    txDrops++;
+    return false;
+  }
+
+  txPut(CAT_PREAMBLE);
+  txPut(CAT_PREAMBLE);
+  txWrite(buf, len);
+  txPut(CAT_EOM);
+
+  drainTx();
+  return true;
+}
+
+//
+// sendFrame() - queue a complete frame, preamble to EOM, as is
+//
+boolean IC746::sendFrame(const byte *frame, int len) {
+  if (len > txFree()) {
+    txDrops++;
+    CAT_TRACE(CAT_TRC_TX_DROP, frame + 2, len - CAT_FRAME_OVERHEAD);
+    CAT_COUNT(txDrops, 1);
+    return false;
+  }
+  CAT_TRACE(CAT_TRC_TX, frame + 2, len - CAT_FRAME_OVERHEAD);
+  txWrite(frame, len);
+  drainTx();
+  return true;
+}
+
+//
+// Transmit ring buffer
+// txHead and txTail run freely and are masked on access, the difference is the fill level
+//
+void IC746::txPut(byte b) {
+  txBuf[txTail & CAT_TX_BUF_MASK] = b;
+  txTail++;
+}
+
+// Copy a block into the ring - at most two memcpy()s, either side of the wrap point
+void IC746::txWrite(const byte *buf, int len) {
+  unsigned int at = txTail & CAT_TX_BUF_MASK;
+  unsigned int first = CAT_TX_BUF_LENGTH - at;
+
+  if ((unsigned int)len <= first) {
+    memcpy(&txBuf[at], buf, len);
+  } else {
+    memcpy(&txBuf[at], buf, first);
+    memcpy(txBuf, buf + first, len - first);
+  }
+  txTail += len;
+}
+
+//
+// drainTx() - hand queued bytes to the transport, only as many as it can take without blocking.
+// They go over in runs, at most two - either side of the wrap point
+//
+void IC746::drainTx() {
+  int room;
+
+  if (link.gap) {                   // someone else may still be talking
+    unsigned long last;
+    do {                            // the receiver may be updating it from an interrupt
+      last = rxLast;
+    } while (last != rxLast);
+    if (micros() - last < link.gap) return;
+  }
+
+  room = transport->availableForWrite();
+
+  while (room > 0 && txHead != txTail) {
+    unsigned int at = txHead & CAT_TX_BUF_MASK;
+    int n = txPending();
+
+    if (n > int(CAT_TX_BUF_LENGTH - at)) n = CAT_TX_BUF_LENGTH - at;
+    if (n > room) n = room;
+    transport->writeBytes(&txBuf[at], n);
+    txHead += n;
+    room -= n;
+  }
+}
+
+int IC746::txPending() {
+  return (unsigned int)(txTail - txHead);
+}
+
+int IC746::txFree() {
+  return CAT_TX_BUF_LENGTH - txPending();
+}
+
+unsigned int IC746::txDropped() {
+  return txDrops;
+}
+
+//
+// flush() - block until everything queued has been given to the transport
+//
+void IC746::flush() {
+  while (txHead != txTail) {
+    drainTx();
+  }
+}
+
+//
+// sendResponse
+// 
+void IC746::sendResponse(byte *buf, int len) {
+  buf[CAT_IX_FROM_ADDR] = CAT_RIG_ADDR;
+  buf[CAT_IX_TO_ADDR] = CAT_CTRL_ADDR;
+  send(buf, len);
+}
+
+//
+// sendAck() - send back hard-code acknowledge message
+//
+void IC746::sendAck() {
+  byte ack[] = {CAT_RIG_ADDR, CAT_CTRL_ADDR, CAT_ACK};
+
+#if CAT_FEATURE_ASYNC
+  if (ackState == CAT_ACK_DEFER) {     // the callback deferred it - completeAck() sends it
+    ackState = CAT_ACK_PENDING;
+    ackSince = millis();
+    ackOp = cmdBuf[CAT_IX_CMD];
+#if CAT_FEATURE_METRICS
+    ackTime = cmdTime;
+    cmdCounted = true;
+#endif
+    return;
+  }
+  if (ackState == CAT_ACK_FAILED) {    // deferred and failed before the callback returned
+    ackState = CAT_ACK_NOW;
+    sendNack();
+    return;
+  }
+#endif
+  send(ack, 3);
+}
+
+//
+// buildFrame() - the response in cmdBuf as a complete frame, preamble to EOM, for the response cache
+// frame must hold len + CAT_FRAME_OVERHEAD bytes
+//
+void IC746::buildFrame(byte *frame, int len) {
+  cmdBuf[CAT_IX_FROM_ADDR] = CAT_RIG_ADDR;
+  cmdBuf[CAT_IX_TO_ADDR] = CAT_CTRL_ADDR;
+  frame[0] = CAT_PREAMBLE;
+  frame[1] = CAT_PREAMBLE;
+  memcpy(&frame[2], cmdBuf, len);
+  frame[len + 2] = CAT_EOM;
+}
+
+#if CAT_FEATURE_TRACE
+//
+// Trace - see CATTrace.h.  Call from the main loop, like check().
+//
+int IC746::traceRead(byte *buf, int max) {
+  return tracer.read(buf, max);
+}
+
+void IC746::trace(byte code, const byte *data, byte len) {
+  tracer.record(code, data, len);
+}
+
+unsigned int IC746::traceLost() {
+  return tracer.lost();
+}
+
+void IC746::traceClear() {
+  tracer.clear();
+}
+#endif
+
+#if CAT_FEATURE_METRICS
+//
+// Metrics - see CATMetrics.h
+//
+const CATMetrics &IC746::metrics() {
+  return stats;
+}
+
+void IC746::resetMetrics() {
+  stats.reset();
+}
+#endif
+
+#if CAT_FEATURE_RESPONSE_CACHE
+//
+// Response cache statistics - polls answered from a cached frame / polls that had to be encoded
+//
+unsigned long IC746::cacheHits() {
+  return rcHits;
+}
+
+unsigned long IC746::cacheMisses() {
+  return rcMisses;
+}
+
+void IC746::resetCacheStats() {
+  rcHits = 0;
+  rcMisses = 0;
+}
+#endif
+
+//
+// sendNack() - send back hard-code negative-acknowledge message
+//
+void IC746::sendNack() {
+  byte nack[] = {CAT_RIG_ADDR, CAT_CTRL_ADDR, CAT_NACK};
+//  displayBanner(String("Nack"));
+  send(nack, 3);
+}
+
+
+/*
+   receive - state machine to receive a command from the controller, one byte at a time
+   States:
+      CAT_RCV_WAITING    - scan incoming serial data for first preamble byte
+      CAT_RCV_INIT       - second premable byte confirms start of message
+      CAT_RCV_RECEIVING  - fill frame buffer until EOM received
+
+   Command format
+   |FE|FE|56|E0|cmd|sub-cmd|data|FD|
+
+    FE FE = preamble, FD = end of command
+    56 = transceiver default address for IC746 (unused)
+    E0 = CAT controller default address (unused)
+
+    On successful receipt of EOM the frame (without the preamble and EOM) is pushed onto
+    the receive queue for check() to process.
+    On interrupted preamble or buffer overflow (no EOM received), a NAK is owed to the
+    controller - it is counted here and sent by check() if the link profile NACKs framing
+    errors.  With address checking on, frames not addressed to CAT_RIG_ADDR are dropped here.
+
+    A frame that is cut short is dropped as soon as that is clear, without a NAK - by then the
+    controller is sending again and would take the NAK for the answer to its next command:
+      - a preamble inside a frame starts a new frame (FE never appears in CI-V data)
+      - no byte for CAT_RX_BYTE_TIMEOUT ms, see watchRx() - the EOM was lost
+      - the jam code FC - someone on the bus saw a collision and the frame is void
+
+   receive() touches nothing but the receive side of the queue, so it may be called from
+   an RX interrupt or serialEvent() while check() runs in the main loop (single producer,
+   single consumer).  If the queue is full the frame is dropped and counted.
+*/
+void IC746::receive(byte bt) {
+  rxBytes++;
+#if CAT_FEATURE_AUTOBAUD
+  if (!abSampled) {         // the first byte after a quiet line, see doAutoBaud()
+    abSample = bt;
+    abSampled = true;
+  }
+#endif
+
+  if (link.gap) rxLast = micros();
+#if CAT_RX_BYTE_TIMEOUT
+  if (rxStale) {            // the rest of the frame is not coming
+    rxStale = false;
+    if (rcvState != CAT_RCV_WAITING) {
+      rcvState = CAT_RCV_WAITING;
+      bytesRcvd = 0;
+      rxResyncs++;
+    }
+  }
+#endif
+
+  if (bt == CAT_JAM) {
+    if (rcvState != CAT_RCV_WAITING) {
+      rcvState = CAT_RCV_WAITING;
+      bytesRcvd = 0;
+      rxResyncs++;
+    }
+    return;
+  }
+
+  switch (rcvState) {
+
+    case CAT_RCV_WAITING:   // scan for start of new command
+      if (bt == CAT_PREAMBLE) {
+        rcvState = CAT_RCV_INIT;
+      }
+#if CAT_FEATURE_AUTOBAUD
+      else {                // noise, or a preamble at the wrong rate
+        abNoise++;
+      }
+#endif
+      break;
+
+    case CAT_RCV_INIT:      // check for second preamble byte
+      if (bt == CAT_PREAMBLE) {
+        rcvState = CAT_RCV_RECEIVING;
+      } else {              // error - should not happen, reset and report
+        rcvState = CAT_RCV_WAITING;
+        bytesRcvd = 0;
+        rxNacks++;
+      }
+      break;
+
+    case CAT_RCV_RECEIVING:
+      switch (bt) {
+
+        case CAT_PREAMBLE:   // more preamble, or the start of a new frame
+          if (bytesRcvd > 0) {
+            rcvState = CAT_RCV_INIT;
+            bytesRcvd = 0;
+            rxResyncs++;
+          }
+          break;
+
+        case CAT_EOM:        // end of message received, queue for processing, reset state
+#if CAT_FEATURE_AUTOBAUD
+          if (bytesRcvd > CAT_IX_CMD) abFrames++;   // a whole frame - the rate is right
+#endif
+          if (link.checkAddress && (bytesRcvd == 0 || rxFrame[CAT_IX_TO_ADDR] != CAT_RIG_ADDR)) {
+            // for another rig, or a broadcast - not ours to answer
+          } else if ((byte)(rxQTail - rxQHead) < CAT_RX_QUEUE_LENGTH) {
+            byte slot = rxQTail & CAT_RX_QUEUE_MASK;
+            memcpy(rxQueue[slot], rxFrame, bytesRcvd);
+            rxQueueLen[slot] = bytesRcvd;
+#if CAT_FEATURE_METRICS
+            rxQueueTime[slot] = micros();
+#endif
+#if CAT_FEATURE_PTT_PRIORITY
+            if (pttLane && bytesRcvd == CAT_RX_LEN_PTT &&
+                rxFrame[CAT_IX_CMD] == CAT_PTT && rxFrame[CAT_IX_SUB_CMD] == 0) {
+              byte req = rxFrame[CAT_IX_PTT] == CAT_PTT_TX ? CAT_PTT_TX : CAT_PTT_RX;
+              // a PTT set - into the priority lane as well.  An unkey always takes the lane, a key
+              // never pushes out an unkey: it waits in the queue behind it.  A repeat of the state
+              // the lane has already put the rig in takes the lane over as done - nothing to redo
+              if (req == CAT_PTT_RX || pttReq != CAT_PTT_RX) {
+                pttSeq = rxQTail;
+                if (req != pttReq || !pttDone) {
+                  pttTime = micros();
+                  pttDone = false;
+                }
+                CAT_BARRIER();
+                pttReq = req;
+              }
+            }
+#endif
+            CAT_BARRIER();   // frame contents must be in place before it is published
+            rxQTail++;
+          } else {
+            rxOverruns++;
+          }
+          rcvState = CAT_RCV_WAITING;
+          bytesRcvd = 0;
+          break;
+
+        default:            // fill frame buffer
+          if (bytesRcvd < CAT_CMD_BUF_LENGTH) {
+            rxFrame[bytesRcvd] = bt;
+            bytesRcvd++;
+          } else {           // overflow - should not happen reset for new comand
+            rcvState = CAT_RCV_WAITING;
+            bytesRcvd = 0;
+            rxNacks++;       // report error
+          }
+          break;
+      }
+      break;
+  }
+}
+
+//
+// watchRx() - notice when the line goes quiet, from check().  Keeps the clock out of
+// receive(), which may run for every byte in an interrupt.  A frame that has had no byte
+// for CAT_RX_BYTE_TIMEOUT is marked stale, and the receiver drops it with the next byte.
+// The state is tested and marked under rxLock(), or a frame the interrupt starts in between
+// would be the one dropped.
+//
+void IC746::watchRx() {
+  byte n = rxBytes;
+
+  if (n != rxBytesSeen || transport->available()) {
+    rxBytesSeen = n;
+    rxQuiet = millis();
+  }
+#if CAT_RX_BYTE_TIMEOUT
+  else if (millis() - rxQuiet >= CAT_RX_BYTE_TIMEOUT) {
+    rxLock();
+    if (rcvState != CAT_RCV_WAITING && rxBytes == n) rxStale = true;
+    rxUnlock();
+  }
+#endif
+}
+
+//
+// rxBusy() - a frame is coming in, and has not stalled
+//
+boolean IC746::rxBusy() {
+  boolean busy;
+
+  rxLock();
+  busy = rcvState != CAT_RCV_WAITING && !rxStale;
+  rxUnlock();
+  return busy;
+}
+
+//
+// pollRx() - move bytes from the transport into the receive state machine
+// Stops early when the queue is full, leaving the rest in the transport until there is room.
+//
+void IC746::pollRx() {
+  while ((byte)(rxQTail - rxQHead) < CAT_RX_QUEUE_LENGTH && transport->available()) {
+    receive(byte(transport->read()));
+  }
+}
+
+//
+// useExternalRx() - when on, check() no longer reads the transport itself.  The sketch
+// feeds the receiver with receive() from an interrupt, or pollRx() from serialEvent().
+//
+void IC746::useExternalRx(boolean on) {
+  externalRx = on;
+}
+
+// Mask the RX interrupt around state receive() shares with check(), when it may run from one
+void IC746::rxLock() {
+  if (externalRx) noInterrupts();
+}
+
+void IC746::rxUnlock() {
+  if (externalRx) interrupts();
+}
+
+unsigned int IC746::rxDropped() {
+  unsigned int n;
+
+  do {              // the receiver may be updating it from an interrupt - read until stable
+    n = rxOverruns;
+  } while (n != rxOverruns);
+  return n;
+}
+
+/*
+   readCmd - take the next complete command off the receive queue
+
+   Upon successful receipt of a command, protocol requires echo back of enitre message
+   (except on a CAT_LINK_USB link, where the controller does not expect it).
+   On successful receipt of a command the array cmdBuf will have the received CAT
+   command (without the preamble and EOM)
+*/
+boolean IC746::readCmd() {
+  byte slot;
+
+  // Framing errors seen by the receiver, traced and counted whether a NAK is owed for them or not
+#if CAT_FEATURE_TRACE || CAT_FEATURE_METRICS
+  if (rxNacksSeen != rxNacks) {
+    byte n = rxNacks - rxNacksSeen;
+    rxNacksSeen += n;
+    CAT_TRACE(CAT_TRC_RX_ERROR, &n, 1);
+    CAT_COUNT(rxErrors, n);
+  }
+  if (rxOverrunsSeen != rxDropped()) {
+    unsigned int n = rxDropped() - rxOverrunsSeen;
+    rxOverrunsSeen += n;
+#if CAT_FEATURE_TRACE
+    byte d[2] = {byte(n), byte(n >> 8)};
+    CAT_TRACE(CAT_TRC_RX_OVERRUN, d, sizeof(d));
+#endif
+    CAT_COUNT(rxOverruns, n);
+  }
+  if (rxResyncsSeen != rxResyncs) {
+    byte n = rxResyncs - rxResyncsSeen;
+    rxResyncsSeen += n;
+    CAT_TRACE(CAT_TRC_RX_RESYNC, &n, 1);
+    CAT_COUNT(rxErrors, n);
+  }
+#endif
+  // ... and the NAKs owed for them - none while the baud rate is being searched for, see doAutoBaud()
+#if CAT_FEATURE_AUTOBAUD
+  boolean nack = link.nackFraming && (!abOn || abLocked);
+#else
+  boolean nack = link.nackFraming;
+#endif
+  while (rxNacksSent != rxNacks) {
+    rxNacksSent++;
+    if (nack) sendNack();
+  }
+
+  if (rxQHead == rxQTail) return false;
+
+  slot = rxQHead & CAT_RX_QUEUE_MASK;
+#if CAT_FEATURE_PTT_PRIORITY
+  cmdSeq = rxQHead;
+#endif
+  cmdLength = rxQueueLen[slot];
+  memcpy(cmdBuf, rxQueue[slot], cmdLength);
+#if CAT_FEATURE_METRICS
+  cmdTime = rxQueueTime[slot];
+#endif
+  CAT_BARRIER();     // finished with the slot before handing it back to the receiver
+  rxQHead++;
+
+  CAT_TRACE(CAT_TRC_RX, cmdBuf, cmdLength);
+  if (link.echo) queue(cmdBuf, cmdLength);  // echo received packet for protocol
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//                        COMMAND PROCESSORS
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// doSmeter() - process the CAT_READ_SMETER Command
+// This command has two sub-commands, SMETER and SQUELCH, only SMETER is fully implemented
+//
+// The SMETER sub command requests the current Return S-meter readingscaled for IC 746 appropriate values
+//      It calls a user function returns 0-15  S0-9, +10, +20, +30, +40, +50 +60
+//      The mapping of s-units to IC746 equivalents done imperically using the CatBkt cat test program
+//
+// The second sub-command, SQUELCH request wheterh Squelch is open or closed.  Return a fixed value
+// of "Open" to keep the protocol happly
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+                         //S0  S1  S2  S3  S4  S5  S6  S7   S8   S9  +10  +20  +30  +40  +50  +60
+static const byte smap[] PROGMEM = {0, 15, 25, 40, 55, 65, 75, 90, 100, 120, 135, 150, 170, 190, 210, 241};
+
+  void IC746::doSmeter() {
+  byte s = shSmeter;
+  switch (cmdBuf[CAT_IX_SUB_CMD]) {
+    case CAT_READ_SUB_SMETER:
+      if (shadowOn || handler->getSmeter(s)) {
+        if (s > 15) s = 15;
+        SmetertoBCD(pgm_read_byte(&smap[s]));
+      } else {
+        cmdBuf[CAT_IX_SMETER] = 0;      // user has not supplied S Meter function - keep the protocol happy
+        cmdBuf[CAT_IX_SMETER + 1] = 0;
+      }
+      sendResponse(cmdBuf, CAT_SZ_SMETER);
+      break;
+
+    case CAT_READ_SUB_SQL:        // Squelch condition 0=closed, 1=open
+      cmdBuf[CAT_IX_SQUELCH] = 1;
+      sendResponse(cmdBuf, CAT_SZ_SQUELCH);
+      break;
+  }
+  }
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// doPtt() - process the CAT_PTT Command
+// CAT_PTT calls the user supplied functions to either put the rig in to Tx or Rx or to request the rigs
+// current Tx/Rx state
+//
+// A "read ptt" request does not have a data byte and is therefore one byte shorter
+// than a "set ptt" request.
+//      56 | E0 | 1C | 00      - Read request 1C is PTT command, sub-command 0 is uused, no data byte
+//      56 | E0 | 1C | 00 | 01 - Set Tx, trailing data bit 1 for Tx, 0 for Rx
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+void IC746::doPtt() {
+  if (isRead()) {        // Read request
+    if (shadowOn) {
+      cmdBuf[CAT_IX_PTT] = shPtt;
+      sendResponse(cmdBuf, CAT_SZ_PTT);
+    } else {
+      boolean tx;
+      if (handler->getPtt(tx)) {
+        cmdBuf[CAT_IX_PTT] = tx;
+        sendResponse(cmdBuf, CAT_SZ_PTT);
+      }
+    }
+  } else {               // Set request
+#if CAT_FEATURE_PTT_PRIORITY
+    byte req = CAT_PTT_NONE;
+    unsigned long since = 0;
+    boolean lane;
+
+    // With a PTT command in the lane this is either that one, or one queued before it and pushed
+    // out of the lane - the later command says what the rig should be, this one is only ACKed
+    rxLock();
+    lane = pttReq != CAT_PTT_NONE;
+    if (lane && cmdSeq == pttSeq) {
+      if (!pttDone) {
+        req = pttReq;
+        since = pttTime;
+      }
+      pttReq = CAT_PTT_NONE;
+      pttDone = false;
+    }
+    rxUnlock();
+    if (lane) {
+      if (req != CAT_PTT_NONE) keyPtt(req, since);
+      sendAck();
+      return;
+    }
+#endif
+    flushFreq();         // never transmit on a stale frequency
+    shPtt = (cmdBuf[CAT_IX_PTT] == CAT_PTT_TX);
+    handler->setPtt(shPtt);
+    sendAck();  // always acknowledge "set" commands
+  }
+}
+
+#if CAT_FEATURE_PTT_PRIORITY || CAT_FEATURE_ASYNC
+// A queued command that only reads the rig - read frequency, mode, S meter, ID or PTT
+static boolean catIsPoll(const byte *frame, byte len) {
+  byte op = frame[CAT_IX_CMD];
+
+  return op == CAT_READ_FREQ || op == CAT_READ_MODE || op == CAT_READ_SMETER || op == CAT_READ_ID ||
+         op == CAT_READ_BAND_EDGE ||
+         (op == CAT_PTT && len == CAT_IX_PTT) || (op == CAT_SPLIT && len == CAT_RD_LEN_NOSUB) ||
+         ((op == CAT_VFO_FREQ || op == CAT_VFO_MODE) && len == CAT_RD_LEN_SUB) ||
+         (op == CAT_MISC && len == CAT_SZ_MEM_READ && frame[CAT_IX_SUB_CMD] == CAT_SET_MEM_CHAN) ||
+         (op == CAT_MISC && len == CAT_SZ_BSR_READ && frame[CAT_IX_SUB_CMD] == CAT_SET_BANDSTACK);
+}
+#endif
+
+#if CAT_FEATURE_PTT_PRIORITY
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// PTT priority lane
+//
+// receive() marks a PTT set command as it queues it.  servicePtt() keys or unkeys the rig straight
+// away - check() calls it before and between commands, and a sketch may call it from inside a slow
+// callback.  The command stays in the queue: when doPtt() gets to it, it is only echoed and
+// ACKed, so the replies go out in the order the commands came.
+//
+// The lane holds one command.  An unkey replaces whatever is in it, so a key still waiting cannot
+// hold back an unkey sent after it; a key replaces another key but never an unkey, it queues
+// behind that as an ordinary command.  receive() may write the lane from an interrupt, so it is
+// read and claimed with the RX interrupt masked - never across a call to the sketch.
+//
+// Unkeying is always safe and is never held back.  Keying waits for a callback in progress, and for
+// commands queued ahead of it that change the rig (a set frequency, say) - never transmit on a stale
+// frequency.  Polls queued ahead of it do not hold it back.
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A command in the receive queue ahead of the PTT command that is not a poll
+boolean IC746::setAheadOfPtt() {
+  for (byte i = rxQHead; i != pttSeq; i++) {
+    byte slot = i & CAT_RX_QUEUE_MASK;
+    if (!catIsPoll(rxQueue[slot], rxQueueLen[slot])) return true;
+  }
+  return false;
+}
+
+// Key or unkey for a lane command already claimed - since is the micros() of its EOM
+void IC746::keyPtt(boolean tx, unsigned long since) {
+  if (tx) {
+    inCallback = true;
+    flushFreq();         // never transmit on a stale frequency
+    inCallback = false;
+  }
+  pttLat = micros() - since;
+  if (pttLat > pttLatMax) pttLatMax = pttLat;
+  shPtt = tx;
+  handler->setPtt(tx);
+}
+
+void IC746::servicePtt() {
+  byte req;
+  unsigned long since;
+
+  rxLock();
+  req = pttReq;
+  since = pttTime;
+  if (req == CAT_PTT_NONE || pttDone || (req == CAT_PTT_TX && (inCallback || setAheadOfPtt()))) {
+    rxUnlock();
+    return;
+  }
+#if CAT_FEATURE_ASYNC
+  if (req == CAT_PTT_TX && ackState == CAT_ACK_PENDING) {   // a retune still running
+    rxUnlock();
+    return;
+  }
+#endif
+  pttDone = true;        // before the call - a servicePtt() from inside it has nothing to do
+  rxUnlock();
+  keyPtt(req, since);
+}
+
+unsigned long IC746::pttLatency() {
+  return pttLat;
+}
+
+unsigned long IC746::pttLatencyMax() {
+  return pttLatMax;
+}
+
+void IC746::resetPttLatency() {
+  pttLat = 0;
+  pttLatMax = 0;
+}
+#endif
+
+#if CAT_FEATURE_ASYNC
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// Deferred replies
+//
+// A set callback that starts a slow job (a retune that waits for a PLL to lock, a relay that
+// needs 50 ms) calls deferAck() and returns.  The sendAck() that follows does not send: the
+// ACK waits for completeAck(), or is turned into a NACK after CAT_ASYNC_TIMEOUT.
+//
+// Only one reply can be outstanding - replies go out in the order the commands came.  In the
+// meantime check() answers the polls at the head of the receive queue (from the shadow
+// registers they report the new state), and holds back the next command that changes the rig.
+// Keying waits for the job too.  Retunes from applyFreq() / flushFreq() cannot be deferred:
+// they have no command to answer.
+//
+// A job may also finish before its callback returns - completeAck() then only settles what the
+// command's own sendAck() sends, and the command is answered and counted as any other.
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+boolean IC746::deferAck() {
+  if (!ackDeferOk || ackState != CAT_ACK_NOW) return false;
+  ackState = CAT_ACK_DEFER;
+  return true;
+}
+
+void IC746::completeAck(boolean ok) {
+  if (ackState == CAT_ACK_DEFER) {     // still inside the callback - the command replies as usual
+    ackState = ok ? CAT_ACK_NOW : CAT_ACK_FAILED;
+    return;
+  }
+  if (ackState != CAT_ACK_PENDING) return;
+  ackState = CAT_ACK_NOW;
+  if (ok) {
+    sendAck();
+  } else {
+    sendNack();
+  }
+#if CAT_FEATURE_METRICS
+  stats.command(ackOp, micros() - ackTime);
+#endif
+}
+
+boolean IC746::ackPending() {
+  return ackState == CAT_ACK_PENDING;
+}
+
+// The command at the head of the receive queue only reads the rig
+boolean IC746::headIsPoll() {
+  byte slot = rxQHead & CAT_RX_QUEUE_MASK;
+
+  return catIsPoll(rxQueue[slot], rxQueueLen[slot]);
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// doSplit() - process the CAT_SPLIT Command
+// Call user supplied function to turn split on or off
+// With no sub-command it reads the split state, from the library's copy
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+void IC746::doSplit() {
+  if (cmdLength == CAT_RD_LEN_NOSUB) {
+    cmdBuf[CAT_IX_SUB_CMD] = shSplit ? CAT_SPLIT_ON : CAT_SPLIT_OFF;
+    sendResponse(cmdBuf, CAT_SZ_SPLIT);
+    return;
+  }
+  flushFreq();
+  switch (cmdBuf[CAT_IX_SUB_CMD]) {
+    case CAT_SPLIT_OFF:
+      shSplit = false;
+      handler->setSplit(false);
+      break;
+    case CAT_SPLIT_ON:
+    case CAT_SIMPLE_DUP:
+      shSplit = true;
+      handler->setSplit(true);
+    default:
+      break;
+  }
+  sendAck();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// doSetVfo() - process the CAT_SET_VFO Command, calls user supplied functions
+// SET_VFO with no sub-command selects VFO Tuning vice Memory Tuning (memory tuning is not implemented)
+// SET_VFO has four sub-commands:
+//    VFOA or VFOB - directs the rig to make the selected VFO the active VFO
+//    VFO_A_TO_B - directs the rig to copy the make both VFO frequencies the same as the Active VFO
+//    VFO_SWAP - directs the rig to exchange VFOA and VFOB
+// The library's copy follows: A=B copies the frequency and mode, swap exchanges them
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+void IC746::doSetVfo() {
+
+  flushFreq();    // a pending frequency belongs to the VFO that is active now
+
+  if (cmdLength == CAT_RD_LEN_NOSUB) {  // No sub-command - sets VFO Tuning vice memory tuning
+    sendAck();           // Memory tuning is not implemented so send ack to keep protocol happy
+    return;
+  }
+
+  switch (cmdBuf[CAT_IX_SUB_CMD]) {
+    case CAT_VFO_A:
+    case CAT_VFO_B:
+      if (cmdBuf[CAT_IX_SUB_CMD] != shVfo && !shadowOn) shStale |= 1 << shVfo;
+      shVfo = cmdBuf[CAT_IX_SUB_CMD];
+      if (!(shStale & (1 << shVfo))) trackBand(true);   // no band from a copy that may be old
+      handler->setVfo(cmdBuf[CAT_IX_SUB_CMD]);
+      break;
+    case CAT_VFO_A_TO_B:
+      syncActive();
+      shFreq[shVfo ^ 1] = shFreq[shVfo];
+      shMode[shVfo ^ 1] = shMode[shVfo];
+      shStale &= ~(1 << (shVfo ^ 1));
+      handler->vfoAtoB();
+      break;
+    case CAT_VFO_SWAP: {
+      syncActive();
+      CATFreq f = shFreq[CAT_VFO_A];
+      byte m = shMode[CAT_VFO_A];
+      shFreq[CAT_VFO_A] = shFreq[CAT_VFO_B];
+      shFreq[CAT_VFO_B] = f;
+      shMode[CAT_VFO_A] = shMode[CAT_VFO_B];
+      shMode[CAT_VFO_B] = m;
+      shStale = (shStale & (1 << (shVfo ^ 1))) ? 1 << shVfo : 0;   // the copies change places
+      if (!shStale) trackBand(true);
+      handler->swapVfo();
+      break;
+    }
+  }
+  sendAck();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// doSetFreq() - proces CAT_SET_FREQ command
+// Call the user supplied function to set the righ frequency
+//
+// With coalescing on the command is acknowledged at once but the user function is only called
+// by applyFreq(), at most once per coalescing interval and with the latest frequency requested.
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+void IC746::doSetFreq() {
+  CATFreq f;
+
+  if (!BCDtoFreq(f)) {      // Convert the frequency BCD to CATFreq
+    sendNack();
+    return;
+  }
+  tuneActive(f);
+}
+
+// Set the active VFO and acknowledge - set frequency, and 25 00 for the selected VFO
+void IC746::tuneActive(CATFreq f) {
+  shFreq[shVfo] = f;
+  trackBand(true);
+#if CAT_FEATURE_COALESCE
+  if (fcInterval) {
+    fcPending = true;
+    applyFreq(false);
+    sendAck();
+    return;
+  }
+#endif
+  handler->setFreq(shFreq[shVfo]);  // and call the user function
+  sendAck();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// Set frequency coalescing
+//
+// Dragging the tuning control of a logging program sends a stream of set frequency commands, and
+// each call of the user function may mean a full synthesizer reprogram.  With coalescing on, only
+// the most recent frequency is passed on, at most once per interval (ms).  A pending frequency is
+// applied straight away before anything that depends on it - PTT, mode, VFO and split changes.
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+#if CAT_FEATURE_COALESCE
+void IC746::setFreqCoalescing(unsigned int interval) {
+  flushFreq();
+  fcInterval = interval;
+}
+#endif
+
+// Apply a pending frequency now, whatever the interval
+void IC746::flushFreq() {
+  applyFreq(true);
+}
+
+void IC746::applyFreq(boolean force) {
+#if CAT_FEATURE_COALESCE
+  if (!fcPending) return;
+  if (!force && millis() - fcLast < fcInterval) return;
+
+  fcPending = false;
+  fcLast = millis();
+#if CAT_FEATURE_ASYNC
+  boolean deferOk = ackDeferOk;
+  ackDeferOk = false;                  // no command to answer - the retune must finish here
+  handler->setFreq(shFreq[shVfo]);
+  ackDeferOk = deferOk;
+#else
+  handler->setFreq(shFreq[shVfo]);
+#endif
+#else
+  (void)force;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// doReadFreq() - process the CAT_READ_FREQ command
+// Call the user supplied function to read set the rig frequency, or answer from the shadow registers
+// Frequecies are sent and received in BCD - call the support functions to do the conversion
+// The encoded response is kept, a repeat poll for an unchanged frequency is a copy of that frame
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+void IC746::doReadFreq() {
+  CATFreq f;
+
+  if (shadowOn) {
+    f = shFreq[shVfo];        // a coalesced frequency is already here
+  } else {
+    flushFreq();              // the rig is asked - it must have been given the frequency
+    if (!handler->getFreq(f)) return;
+  }
+
+#if CAT_FEATURE_RESPONSE_CACHE
+  if (!freqFrameValid || f != freqFrameValue) {   // new frequency - encode the response once
+    FreqtoBCD(f);             // convert to BCD and stuff it in the response buffer
+    buildFrame(freqFrame, CAT_SZ_FREQ);
+    freqFrameValue = f;
+    freqFrameValid = true;
+    rcMisses++;
+  } else {
+    rcHits++;
+  }
+  sendFrame(freqFrame, CAT_SZ_FREQ + CAT_FRAME_OVERHEAD);
+#else
+  FreqtoBCD(f);
+  sendResponse(cmdBuf, CAT_SZ_FREQ);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// doSetMode() - process the CAT_SET_MODE command
+// Call the user function to put the rig into the requested mode. 
+// The rig must handle all of the possible modes
+//   CAT_MODE_LSB
+//   CAT_MODE_USB
+//   CAT_MODE_AM:
+//   CAT_MODE_CW - (LSB)
+//   CAT_MODE_RTTY - (LSB)
+//   CAT_MODE_FM
+//   CAT_MODE_CW_R - (Reverse - USB)
+//   CAT_MODE_RTTY_R - (Reverse - LSB)
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+void IC746::doSetMode() {
+  modeActive(cmdBuf[CAT_IX_SUB_CMD]);
+}
+
+// Set the mode of the active VFO and acknowledge - set mode, and 26 00 for the selected VFO
+void IC746::modeActive(byte m) {
+  flushFreq();
+  shMode[shVfo] = m;
+  trackBand(true);
+  handler->setMode(m);
+  sendAck();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// doReadMode() - process the CAT_READ_MODE command
+// Call the user function to query the rig's current mode, or answer from the shadow registers
+// The encoded response is kept, as for doReadFreq()
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+void IC746::doReadMode() {
+  byte m = shMode[shVfo];
+
+  if (shadowOn || handler->getMode(m)) {
+#if CAT_FEATURE_RESPONSE_CACHE
+    if (!modeFrameValid || m != modeFrameValue) {   // new mode - encode the response once
+      cmdBuf[CAT_IX_MODE] = m;
+      cmdBuf[CAT_IX_MODE+1] = CAT_MODE_FILTER1;  // protocol filter - return reasonable value
+      buildFrame(modeFrame, CAT_SZ_MODE);
+      modeFrameValue = m;
+      modeFrameValid = true;
+      rcMisses++;
+    } else {
+      rcHits++;
+    }
+    sendFrame(modeFrame, CAT_SZ_MODE + CAT_FRAME_OVERHEAD);
+#else
+    cmdBuf[CAT_IX_MODE] = m;
+    cmdBuf[CAT_IX_MODE+1] = CAT_MODE_FILTER1;
+    sendResponse(cmdBuf, CAT_SZ_MODE);
+#endif
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// doMisc() - process the CAT_MISC command
+//
+// The MISC command has several unrelated sub-commands
+// The only one implemented here is the sub-command to read the IF Filter Setting
+// The code sends a hard-coded response since most homebrew rigs won't have such a setting
+// but programs like WSJTX and FLDIGI request it
+//
+// Commands that "set" values are replied to with an ACK message
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+void IC746::doMisc() {
+  switch (cmdBuf[CAT_IX_SUB_CMD]) {
+    case CAT_READ_IF_FILTER:
+      cmdBuf[CAT_IX_IF_FILTER] = 0;
+      sendResponse(cmdBuf, CAT_SZ_IF_FILTER);
+      break;
+
+#if CAT_FEATURE_MEMORY
+    case CAT_SET_MEM_CHAN:
+      if (memory) {
+        doMemContent();
+        break;
+      }
+      sendAck();
+      break;
+#endif
+
+#if CAT_FEATURE_BANDSTACK
+    case CAT_SET_BANDSTACK:
+      doBandStack();
+      break;
+#endif
+
+    // Not implemented
+    // Reply with ACK to keep the protocol happy
+#if !CAT_FEATURE_MEMORY
+    case CAT_SET_MEM_CHAN:
+#endif
+#if !CAT_FEATURE_BANDSTACK
+    case CAT_SET_BANDSTACK:
+#endif
+    case CAT_SET_MEM_KEYER:
+      sendAck();
+      break;
+  }
+}
+
+#if CAT_FEATURE_DUAL_VFO
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// doVfoFreq() / doVfoMode() - process the CAT_VFO_FREQ and CAT_VFO_MODE commands
+// Read or set the frequency or mode of the selected (00) or the unselected (01) VFO, so a split
+// controller need not select the TX VFO, poll or set it and select back - three commands for one.
+//   |FE|FE|56|E0|25|ss|ff|ff|ff|ff|ff|FD|
+//   |FE|FE|56|E0|26|ss|mm|dd|fl|FD|     mode, data mode, filter
+// The selected VFO is handled as set / read frequency and mode are.  The unselected one is read
+// from the library's copy; a set goes to setVfoFreq() / setVfoMode(), or if the handler does not
+// have them to setVfo(), setFreq() / setMode() and setVfo() back.  Data mode is always read as
+// off and filter 1, and is ignored in a set.
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+void IC746::doVfoFreq() {
+  byte sel = cmdBuf[CAT_IX_SUB_CMD];
+  byte vfo = shVfo ^ (sel & 1);
+  CATFreq f;
+
+  if (sel > CAT_VFO_UNSELECTED || (cmdLength != CAT_RD_LEN_SUB && cmdLength != CAT_RD_LEN_SUB + CAT_FREQ_BYTES)) {
+    sendNack();
+    return;
+  }
+
+  if (cmdLength == CAT_RD_LEN_SUB) {
+    if (vfo != shVfo) syncOther();
+    f = shFreq[vfo];
+    if (vfo == shVfo && !shadowOn) {
+      flushFreq();
+      if (!handler->getFreq(f)) return;
+    }
+    catFreqToBCD(f, &cmdBuf[CAT_IX_DATA], CAT_FREQ_BYTES);
+    sendResponse(cmdBuf, CAT_SZ_VFO_FREQ);
+    return;
+  }
+
+  if (!catFreqField(&cmdBuf[CAT_IX_DATA], f)) {
+    sendNack();
+    return;
+  }
+  if (vfo == shVfo) {
+    tuneActive(f);
+    return;
+  }
+  flushFreq();          // a pending frequency belongs to the active VFO
+  shFreq[vfo] = f;
+  if (!handler->setVfoFreq(vfo, f)) {
+#if CAT_FEATURE_ASYNC
+    ackDeferOk = false; // one change made of three calls - the reply cannot wait on the middle one
+#endif
+    handler->setVfo(vfo);
+    handler->setFreq(f);
+    handler->setVfo(shVfo);
+  }
+  sendAck();
+}
+
+void IC746::doVfoMode() {
+  byte sel = cmdBuf[CAT_IX_SUB_CMD];
+  byte vfo = shVfo ^ (sel & 1);
+  byte m;
+
+  if (sel > CAT_VFO_UNSELECTED) {
+    sendNack();
+    return;
+  }
+
+  if (cmdLength == CAT_RD_LEN_SUB) {
+    if (vfo != shVfo) syncOther();
+    m = shMode[vfo];
+    if (vfo == shVfo && !shadowOn && !handler->getMode(m)) return;
+    cmdBuf[CAT_IX_DATA] = m;
+    cmdBuf[CAT_IX_DATA + 1] = 0;                  // data mode off
+    cmdBuf[CAT_IX_DATA + 2] = CAT_MODE_FILTER1;
+    sendResponse(cmdBuf, CAT_SZ_VFO_MODE);
+    return;
+  }
+
+  m = cmdBuf[CAT_IX_DATA];
+  if (vfo == shVfo) {
+    modeActive(m);
+    return;
+  }
+  flushFreq();
+  shMode[vfo] = m;
+  if (!handler->setVfoMode(vfo, m)) {
+#if CAT_FEATURE_ASYNC
+    ackDeferOk = false;
+#endif
+    handler->setVfo(vfo);
+    handler->setMode(m);
+    handler->setVfo(shVfo);
+  }
+  sendAck();
+}
+#endif
+
+#if CAT_FEATURE_MEMORY
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// Memory channels
+//
+// The channels live in a CATMemory given to setMemory(); without one the memory commands are NACKed
+// as before, and 1A 00 is ACKed.  Channels are numbered 1 - CAT_MEM_CHANNELS over CI-V, two BCD
+// digit pairs, most significant first (00 12 is channel 12).
+//   |FE|FE|56|E0|08|FD|                 memory mode - there is none, ACKed to keep the protocol happy
+//   |FE|FE|56|E0|08|cc|cc|FD|           select channel cc cc for 09, 0A and 0B
+//   |FE|FE|56|E0|09|FD|                 write the active VFO - frequency, mode and split
+//   |FE|FE|56|E0|0A|FD|                 recall the selected channel to the active VFO
+//   |FE|FE|56|E0|0B|FD|                 clear the selected channel
+// A write is ACKed at once; the store is written later, from check().  A blank channel is NACKed
+// by 0A.
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+void IC746::setMemory(CATMemory &mem) {
+  memory = &mem;
+  memory->begin();
+}
+
+byte IC746::memoryChannel() {
+  return memChan + 1;
+}
+
+// Channel number from 2 BCD digit pairs, from 0 - -1 if there is no such channel
+int IC746::memNumber(const byte *bcd) {
+  byte hi = bcd[1] >> 4;
+  byte lo = bcd[1] & 0x0F;
+  byte n = hi * 10 + lo;
+
+  if (bcd[0] != 0 || hi > 9 || lo > 9 || n < 1 || n > CAT_MEM_CHANNELS) return -1;
+  return n - 1;
+}
+
+void IC746::doMemory() {
+  CATChannel c;
+  int n;
+
+  if (!memory) {
+    sendNack();
+    return;
+  }
+
+  switch (cmdBuf[CAT_IX_CMD]) {
+    case CAT_SEL_MEM:
+      if (cmdLength == CAT_RD_LEN_NOSUB) break;
+      n = cmdLength == CAT_SZ_SEL_MEM ? memNumber(&cmdBuf[CAT_IX_MEM_CHAN]) : -1;
+      if (n < 0) {
+        sendNack();
+        return;
+      }
+      memChan = n;
+      break;
+
+    case CAT_WRITE_MEM:
+      flushFreq();
+      syncActive();
+      c.freq = shFreq[shVfo];
+      c.mode = shMode[shVfo];
+      c.split = shSplit;
+      if (!memory->write(memChan, c)) {
+        sendNack();
+        return;
+      }
+      break;
+
+    case CAT_MEM_TO_VFO:
+      if (!memory->read(memChan, c)) {
+        sendNack();
+        return;
+      }
+      flushFreq();
+#if CAT_FEATURE_ASYNC
+      ackDeferOk = false;  // three calls for one change, as in doVfoFreq()
+#endif
+      shFreq[shVfo] = c.freq;
+      shMode[shVfo] = c.mode;
+      shSplit = c.split;
+      trackBand(true);
+      handler->setFreq(c.freq);
+      handler->setMode(c.mode);
+      handler->setSplit(c.split);
+      break;
+
+    case CAT_CLEAR_MEM:
+      memory->clear(memChan);
+      break;
+  }
+  sendAck();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// doMemContent() - process CAT_MISC sub-command CAT_SET_MEM_CHAN, any channel's contents
+//   |FE|FE|56|E0|1A|00|cc|cc|FD|                              read
+//   |FE|FE|E0|56|1A|00|cc|cc|ff|ff|ff|ff|ff|mm|fl|ss|FD|      ... the answer, ss is split 00 / 01
+//   |FE|FE|E0|56|1A|00|cc|cc|FF|FD|                           ... or for a blank channel
+// A write is the answer's layout sent to the rig, split may be left off; FF for the data clears
+// the channel.  The IC-746 also keeps tones and a name, which a homebrew rig does not have.
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+void IC746::doMemContent() {
+  int n = cmdLength >= CAT_SZ_MEM_READ ? memNumber(&cmdBuf[CAT_IX_DATA]) : -1;
+  byte *data = &cmdBuf[CAT_IX_MEM_DATA];
+  CATChannel c;
+
+  if (n < 0) {
+    sendNack();
+    return;
+  }
+
+  if (cmdLength == CAT_SZ_MEM_READ) {
+    if (!memory->read(n, c)) {
+      data[0] = 0xFF;
+      sendResponse(cmdBuf, CAT_SZ_MEM_BLANK);
+      return;
+    }
+    catFreqToBCD(c.freq, data, CAT_FREQ_BYTES);
+    data[CAT_FREQ_BYTES] = c.mode;
+    data[CAT_FREQ_BYTES + 1] = CAT_MODE_FILTER1;
+    data[CAT_FREQ_BYTES + 2] = c.split ? CAT_SPLIT_ON : CAT_SPLIT_OFF;
+    sendResponse(cmdBuf, CAT_SZ_MEM);
+    return;
+  }
+
+  if (cmdLength == CAT_SZ_MEM_BLANK && data[0] == 0xFF) {
+    memory->clear(n);
+    sendAck();
+    return;
+  }
+
+  if (cmdLength != CAT_SZ_MEM && cmdLength != CAT_SZ_MEM - 1) {
+    sendNack();
+    return;
+  }
+  if (!catFreqField(data, c.freq)) {
+    sendNack();
+    return;
+  }
+  c.mode = data[CAT_FREQ_BYTES];
+  c.split = cmdLength == CAT_SZ_MEM && data[CAT_FREQ_BYTES + 2] == CAT_SPLIT_ON;
+  if (memory->write(n, c)) {
+    sendAck();
+  } else {
+    sendNack();
+  }
+}
+#endif
+
+#if CAT_FEATURE_BANDSTACK
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// Bands - see CATBand.h
+//
+// The library knows the band of the active VFO at every change, a table lookup rather than a search,
+// and keeps CAT_BANDSTACK_DEPTH stacking registers per band: register 1 is where the VFO is, or was
+// when it left the band, 2 and 3 where it was before.  The IC-746 has no CI-V command to select a
+// band, so a controller changes band by writing the band's register 1 - one command for what took a
+// read of the register, a set frequency and a set mode.
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+byte IC746::band() {
+  return curBand;
+}
+
+boolean IC746::bandStack(byte band, byte reg, CATFreq &freq, byte &mode) {
+  if (band >= CAT_BANDS || reg >= CAT_BANDSTACK_DEPTH) return false;
+  freq = bandRegs[band][reg].freq;
+  mode = bandRegs[band][reg].mode;
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// doBandEdge() - process the CAT_READ_BAND_EDGE command, the edges of the band the rig is on
+//   |FE|FE|E0|56|02|ff|ff|ff|ff|ff|2D|ff|ff|ff|ff|ff|FD|   low edge - high edge
+// NACKed outside every band.  The edges never change, so each band's frame is encoded once and kept
+// while the rig stays on the band.
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+void IC746::doBandEdge() {
+  byte *data = &cmdBuf[CAT_IX_FREQ];
+  CATBandEdge e;
+  byte b;
+  CATFreq f;
+
+  if (shadowOn) {
+    f = shFreq[shVfo];
+  } else {
+    flushFreq();
+    if (!handler->getFreq(f)) return;
+  }
+  b = catBand(f);
+  if (b == CAT_BAND_NONE) {
+    sendNack();
+    return;
+  }
+
+#if CAT_FEATURE_RESPONSE_CACHE
+  if (b != edgeFrameBand) {
+    catBandEdge(b, e);
+    catFreqToBCD(e.low, data, CAT_FREQ_BYTES);
+    data[CAT_FREQ_BYTES] = 0x2D;
+    catFreqToBCD(e.high, &data[CAT_FREQ_BYTES + 1], CAT_FREQ_BYTES);
+    buildFrame(edgeFrame, CAT_SZ_BAND_EDGE);
+    edgeFrameBand = b;
+    rcMisses++;
+  } else {
+    rcHits++;
+  }
+  sendFrame(edgeFrame, CAT_SZ_BAND_EDGE + CAT_FRAME_OVERHEAD);
+#else
+  catBandEdge(b, e);
+  catFreqToBCD(e.low, data, CAT_FREQ_BYTES);
+  data[CAT_FREQ_BYTES] = 0x2D;
+  catFreqToBCD(e.high, &data[CAT_FREQ_BYTES + 1], CAT_FREQ_BYTES);
+  sendResponse(cmdBuf, CAT_SZ_BAND_EDGE);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// doBandStack() - process CAT_MISC sub-command CAT_SET_BANDSTACK, the band stacking registers
+//   |FE|FE|56|E0|1A|01|bb|rr|FD|                           read register rr (01 - 03) of band bb
+//   |FE|FE|E0|56|1A|01|bb|rr|ff|ff|ff|ff|ff|mm|fl|FD|      ... the answer
+// A write is the answer's layout sent to the rig.  Writing register 01 moves the active VFO there,
+// and with it to band bb; writing 02 or 03 only stores the register.  Band codes are the IC-746's,
+// 01 (160 m) - 11 (2 m).  A frequency outside band bb is NACKed.
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+void IC746::doBandStack() {
+  byte b = cmdLength >= CAT_SZ_BSR_READ ? catBandOfCode(cmdBuf[CAT_IX_BSR_BAND]) : CAT_BAND_NONE;
+  byte r = cmdBuf[CAT_IX_BSR_REG] - 1;   // 01 - 09, BCD and binary alike
+  byte *data = &cmdBuf[CAT_IX_BSR_DATA];
+  CATBandEdge e;
+  CATFreq f;
+
+  if (b == CAT_BAND_NONE || r >= CAT_BANDSTACK_DEPTH) {
+    sendNack();
+    return;
+  }
+
+  if (cmdLength == CAT_SZ_BSR_READ) {
+    syncActive();          // register 1 of the band the rig is on is the VFO itself
+    catFreqToBCD(bandRegs[b][r].freq, data, CAT_FREQ_BYTES);
+    data[CAT_FREQ_BYTES] = bandRegs[b][r].mode;
+    data[CAT_FREQ_BYTES + 1] = CAT_MODE_FILTER1;
+    sendResponse(cmdBuf, CAT_SZ_BSR);
+    return;
+  }
+
+  catBandEdge(b, e);
+  if (cmdLength != CAT_SZ_BSR || !catFreqField(data, f) || f < e.low || f > e.high) {
+    sendNack();
+    return;
+  }
+
+  if (r > 0) {
+    bandRegs[b][r].freq = f;
+    bandRegs[b][r].mode = data[CAT_FREQ_BYTES];
+    sendAck();
+    return;
+  }
+
+  flushFreq();
+#if CAT_FEATURE_ASYNC
+  ackDeferOk = false;  // two calls for one change, as in doVfoFreq()
+#endif
+  shFreq[shVfo] = f;
+  shMode[shVfo] = data[CAT_FREQ_BYTES];
+  trackBand(true);     // register 1 of band bb now holds the new frequency and mode
+  handler->setFreq(shFreq[shVfo]);
+  handler->setMode(shMode[shVfo]);
+  sendAck();
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// doReadId() - process the CAT_READ_ID command, send back the transceiver ID
+//      56 | E0 | 19 | 00       - read request
+//      E0 | 56 | 19 | 00 | 56 - response
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+void IC746::doReadId() {
+  cmdBuf[CAT_IX_SUB_CMD] = 0;
+  cmdBuf[CAT_IX_ID] = CAT_RIG_ADDR;
+  sendResponse(cmdBuf, CAT_SZ_ID);
+}
+
+#if CAT_FEATURE_METRICS
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// doMetrics() - process the vendor command CAT_METRICS_CMD (7E), not an ICOM command
+// Counters are sent as 3 byte BCD, least significant pair first like a frequency, and stop at 999999
+//      56 E0 7E 00 oo      -> E0 56 7E 00 oo cc cc cc ww ww ww   commands with opcode oo, worst latency us
+//      56 E0 7E 01         -> E0 56 7E 01 ee ee ee vv vv vv dd dd dd rr rr rr
+//                             framing errors, RX overruns, TX drops, rejected commands
+//      56 E0 7E 02 bb      -> E0 56 7E 02 bb cc cc cc            latency histogram bucket bb
+//      56 E0 7E 03         -> ACK, all metrics reset
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+#define CAT_METRICS_BCD     3
+#define CAT_METRICS_MAX     999999UL
+
+static void metricBCD(unsigned long v, byte *bcd) {
+  catFreqToBCD(v > CAT_METRICS_MAX ? CAT_METRICS_MAX : v, bcd, CAT_METRICS_BCD);
+}
+
+void IC746::doMetrics() {
+  byte sub = cmdBuf[CAT_IX_SUB_CMD];
+  byte arg = cmdLength > CAT_IX_DATA ? cmdBuf[CAT_IX_DATA] : 0;
+  byte *out = &cmdBuf[CAT_IX_DATA];
+
+  switch (sub) {
+    case 0x00:
+      out++;                                    // opcode stays where it is
+      metricBCD(arg < CAT_METRICS_OPCODES ? stats.byOpcode[arg] : stats.otherOpcodes, out);
+      metricBCD(arg < CAT_METRICS_OPCODES ? stats.worst[arg] : 0, out + CAT_METRICS_BCD);
+      sendResponse(cmdBuf, CAT_IX_DATA + 1 + 2 * CAT_METRICS_BCD);
+      break;
+
+    case 0x01:
+      metricBCD(stats.rxErrors, out);
+      metricBCD(stats.rxOverruns, out + CAT_METRICS_BCD);
+      metricBCD(stats.txDrops, out + 2 * CAT_METRICS_BCD);
+      metricBCD(stats.rejects, out + 3 * CAT_METRICS_BCD);
+      sendResponse(cmdBuf, CAT_IX_DATA + 4 * CAT_METRICS_BCD);
+      break;
+
+    case 0x02:
+      if (arg >= CAT_METRICS_BUCKETS) {
+        sendNack();
+        break;
+      }
+      metricBCD(stats.latency[arg], out + 1);
+      sendResponse(cmdBuf, CAT_IX_DATA + 1 + CAT_METRICS_BCD);
+      break;
+
+    case 0x03:
+      stats.reset();
+      sendAck();
+      break;
+
+    default:
+      sendNack();
+      break;
+  }
+}
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+//                       UNIMPLEMENTED COMMAND STUBS
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// doUnimplemented() - reasonable processing for features that are not fully implemented
+//
+// Unimplimented command handling
+//
+// These following commands are used to both set and read various parameters in the IC-746 that are not
+// typically implemented in a homebrew transceiver.
+// Commands requesting the state of various parameters require one or two data bytes returned.
+// We return zero in all cases which typically means the requsted feature is OFF - eg AGC, NB, VOX, etc.
+// Command that "set" various parameters only require an ACK reply
+// A "read" request has no data byte and is one byte shorter than a set request.  The read length and
+// the size of the zero filled response come from the command table.
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+#if CAT_FEATURE_STUBS
+void IC746::doStub() {
+  if (isRead()) {                          // Read request
+    for (int i = cmd.rdLen; i < cmd.rspLen; i++) {
+      cmdBuf[i] = 0;                       // return 0 for all read requests
+    }
+    sendResponse(cmdBuf, cmd.rspLen);
+  } else {                   // Set parameter request
+    sendAck();               // Send an acknowledgement to keep the protocol happy
+  }
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+//  check() - process commands from CAT controller, should be called from the sketch main loop
+//
+//  Every complete command that is waiting is answered, up to the caller's budget:
+//    maxFrames - stop after this many commands (0 = no limit)
+//    maxMicros - stop once this much time has been spent (0 = no limit).  A command is never
+//                abandoned half way, so one handler may overrun the budget.
+//  Returns the number of complete commands still waiting - 0 means the engine is idle, more than
+//  0 means call again as soon as the sketch can spare the time.
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+int IC746::check(int maxFrames, unsigned long maxMicros) {
+  unsigned long start = 0;
+  int done = 0;
+
+  // do nothing if it was disabled by software
+  if (!enabled) return 0;
+
+  if (maxMicros) start = micros();
+
+  // Keep queued responses moving
+  drainTx();
+
+  watchRx();
+#if CAT_FEATURE_AUTOBAUD
+  doAutoBaud();
+#endif
+
+#if CAT_FEATURE_ASYNC
+  if (ackState == CAT_ACK_PENDING && millis() - ackSince >= CAT_ASYNC_TIMEOUT) completeAck(false);
+#endif
+
+#if CAT_FEATURE_PTT_PRIORITY
+  // PTT first, even when the responses are backed up
+  if (!externalRx) pollRx();
+  servicePtt();
+#endif
+
+  for (;;) {
+    // Back-pressure - leave new commands in the transport until there is room to answer them
+    if (txFree() < CAT_TX_RESERVE) break;
+
+    // Receive a CAT Command
+    if (!externalRx) pollRx();
+#if CAT_FEATURE_PTT_PRIORITY
+    servicePtt();        // ahead of the commands queued before it
+#endif
+#if CAT_FEATURE_ASYNC
+    // a deferred reply is outstanding - answer polls, the next set waits for it
+    if (ackState == CAT_ACK_PENDING && rxQHead != rxQTail && !headIsPoll()) break;
+#endif
+    if (!readCmd()) break;
+
+#if CAT_FEATURE_ASYNC
+#if CAT_FEATURE_METRICS
+    cmdCounted = false;
+#endif
+    ackDeferOk = true;
+#endif
+#if CAT_FEATURE_PTT_PRIORITY
+    inCallback = true;
+    processCmd();
+    inCallback = false;
+#else
+    processCmd();
+#endif
+#if CAT_FEATURE_ASYNC
+    ackDeferOk = false;
+    if (ackState == CAT_ACK_DEFER || ackState == CAT_ACK_FAILED) {
+      ackState = CAT_ACK_NOW;    // deferred, but the command was not ACKed
+    }
+#endif
+#if CAT_FEATURE_METRICS
+#if CAT_FEATURE_ASYNC
+    if (!cmdCounted)             // a command that deferred its reply is counted by completeAck()
+#endif
+    stats.command(cmdLength > CAT_IX_CMD ? cmdBuf[CAT_IX_CMD] : 0xFF, micros() - cmdTime);
+#endif
+    done++;
+
+    if (maxFrames && done >= maxFrames) break;
+    if (maxMicros && micros() - start >= maxMicros) break;
+  }
+
+  // Coalesced frequency change that is now due
+#if CAT_FEATURE_PTT_PRIORITY
+  inCallback = true;
+  applyFreq(false);
+  inCallback = false;
+  servicePtt();          // keying held back by the retune
+#else
+  applyFreq(false);
+#endif
+
+  // Unsolicited frequency / mode updates
+  doTransceive();
+
+#if CAT_FEATURE_MEMORY
+  // Memory channels that are due, a byte at a time as the EEPROM is ready
+  if (memory) memory->service();
+#endif
+
+  return (byte)(rxQTail - rxQHead);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// The command table
+//
+// One entry per opcode, so dispatch is a single index.  Entries with no processor are NACKed, as are
+// commands whose length is outside the entry's range - a processor never sees a command too short
+// to hold its sub-command or data.  The table lives in flash and is checked at compile time.
+//
+// With CAT_FEATURE_STUBS off (IC746Config.h) the commands that are only answered to keep the
+// protocol happy are left out, and NACKed too.
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+#define CAT_NONE(op)                           {op, 0, 0, 0, 0, NULL}
+#define CAT_CMD(op, min, max, rd, rsp, fn)     {op, min, max, rd, rsp, &IC746::fn}
+#if CAT_FEATURE_STUBS
+#define CAT_STUB(op, min, max, rd, rsp)        CAT_CMD(op, min, max, rd, rsp, doStub)
+#else
+#define CAT_STUB(op, min, max, rd, rsp)        CAT_NONE(op)
+#endif
+
+struct CATDispatch {
+  static constexpr CATCommand table[CAT_CMD_TABLE_LENGTH] PROGMEM = {
+    //       opcode              min max read response
+    CAT_NONE(CAT_SET_TCV_FREQ),
+    CAT_NONE(CAT_SET_TCV_MODE),
+#if CAT_FEATURE_BANDSTACK
+    CAT_CMD (CAT_READ_BAND_EDGE,  3,  3,  3, CAT_SZ_BAND_EDGE, doBandEdge),
+#else
+    CAT_NONE(CAT_READ_BAND_EDGE),
+#endif
+    CAT_CMD (CAT_READ_FREQ,       3,  3,  3, CAT_SZ_FREQ,      doReadFreq),
+    CAT_CMD (CAT_READ_MODE,       3,  3,  3, CAT_SZ_MODE,      doReadMode),
+    CAT_CMD (CAT_SET_FREQ,        CAT_SZ_SET_FREQ, CAT_SZ_SET_FREQ, 0, 0, doSetFreq),
+    CAT_CMD (CAT_SET_MODE,        4,  5,  0, 0,                doSetMode),
+    CAT_CMD (CAT_SET_VFO,         3,  4,  0, 0,                doSetVfo),
+#if CAT_FEATURE_MEMORY
+    CAT_CMD (CAT_SEL_MEM,         3,  5,  0, 0,                doMemory),
+    CAT_CMD (CAT_WRITE_MEM,       3,  3,  0, 0,                doMemory),
+    CAT_CMD (CAT_MEM_TO_VFO,      3,  3,  0, 0,                doMemory),
+    CAT_CMD (CAT_CLEAR_MEM,       3,  3,  0, 0,                doMemory),
+#else
+    CAT_NONE(CAT_SEL_MEM),
+    CAT_NONE(CAT_WRITE_MEM),
+    CAT_NONE(CAT_MEM_TO_VFO),
+    CAT_NONE(CAT_CLEAR_MEM),
+#endif
+    CAT_STUB(CAT_READ_OFFSET,     3,  7,  4, CAT_SZ_UNIMP_2B),
+    CAT_NONE(CAT_SET_OFFSET),
+    CAT_NONE(CAT_SCAN),
+    CAT_CMD (CAT_SPLIT,           3,  4,  3, CAT_SZ_SPLIT,     doSplit),
+    CAT_STUB(CAT_SET_RD_STEP,     3,  4,  3, CAT_SZ_TUNE_STEP),
+    CAT_STUB(CAT_SET_RD_ATT,      3,  5,  4, CAT_SZ_UNIMP_1B),
+    CAT_STUB(CAT_SET_RD_ANT,      3,  5,  3, CAT_SZ_ANT_SEL),
+    CAT_NONE(CAT_SET_UT102),
+    CAT_STUB(CAT_SET_RD_PARAMS1,  3,  6,  4, CAT_SZ_UNIMP_2B),
+    CAT_CMD (CAT_READ_SMETER,     4,  4,  4, CAT_SZ_SMETER,    doSmeter),
+    CAT_STUB(CAT_SET_RD_PARAMS2,  3,  5,  4, CAT_SZ_UNIMP_1B),
+    CAT_NONE(0x17),
+    CAT_NONE(0x18),
+    CAT_CMD (CAT_READ_ID,         3,  4,  4, CAT_SZ_ID,        doReadId),
+    CAT_CMD (CAT_MISC,            4, CAT_CMD_BUF_LENGTH, 4, CAT_SZ_IF_FILTER, doMisc),
+    CAT_NONE(CAT_SET_TONE),
+    CAT_CMD (CAT_PTT,             4,  5,  4, CAT_SZ_PTT,       doPtt),
+#if CAT_FEATURE_DUAL_VFO
+    CAT_NONE(0x1D),
+    CAT_NONE(0x1E),
+    CAT_NONE(0x1F),
+    CAT_NONE(0x20),
+    CAT_NONE(0x21),
+    CAT_NONE(0x22),
+    CAT_NONE(0x23),
+    CAT_NONE(0x24),
+    CAT_CMD (CAT_VFO_FREQ,        4,  9,  4, CAT_SZ_VFO_FREQ,  doVfoFreq),
+    CAT_CMD (CAT_VFO_MODE,        4,  7,  4, CAT_SZ_VFO_MODE,  doVfoMode),
+#endif
+  };
+
+  // every entry is at the index of its opcode
+  static constexpr boolean ordered(int i) {
+    return i == CAT_CMD_TABLE_LENGTH || (table[i].cmd == i && ordered(i + 1));
+  }
+};
+
+constexpr CATCommand CATDispatch::table[CAT_CMD_TABLE_LENGTH];
+
+static_assert(CATDispatch::ordered(0), "CAT command table out of order");
+#if CAT_FEATURE_METRICS
+static_assert(CAT_METRICS_OPCODES == CAT_CMD_TABLE_LENGTH, "CAT metrics do not count every command of the table");
+#endif
+
+#if CAT_USER_COMMANDS
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+// addCATCommand() - add a command processor, or replace a built in one
+// The function is called with the command as received (addresses, command, sub-command, data) and
+// must answer it with sendResponse(), sendAck() or sendNack().  Commands outside minLen .. maxLen
+// are NACKed without calling it.
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+boolean IC746::addCATCommand(byte op, byte minLen, byte maxLen, FuncPtrCommand process) {
+  for (int i = 0; i < userCmdCount; i++) {
+    if (userCmds[i].cmd == op) {        // replace an earlier registration
+      userCmds[i].minLen = minLen;
+      userCmds[i].maxLen = maxLen;
+      userCmds[i].process = process;
+      return true;
+    }
+  }
+  if (userCmdCount >= CAT_USER_COMMANDS) return false;
+#if CAT_FEATURE_PTT_PRIORITY
+  if (op == CAT_PTT) pttLane = false;   // the sketch's own PTT command - no priority lane
+#endif
+  userCmds[userCmdCount].cmd = op;
+  userCmds[userCmdCount].minLen = minLen;
+  userCmds[userCmdCount].maxLen = maxLen;
+  userCmds[userCmdCount].process = process;
+  userCmdCount++;
+  return true;
+}
+#endif
+
+// isRead() - true if the command being processed is the read form
+boolean IC746::isRead() {
+  return cmdLength == cmd.rdLen;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+//  processCmd() - dispatch the command in cmdBuf to its processor
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+void IC746::processCmd() {
+  byte op = cmdBuf[CAT_IX_CMD];   // command opcode is at CAT_IX_CMD location in command buffer
+
+  if (cmdLength <= CAT_IX_CMD) {  // no opcode
+    CAT_COUNT(rejects, 1);
+    sendNack();
+    return;
+  }
+
+#if CAT_FEATURE_METRICS && CAT_METRICS_CMD
+  if (op == CAT_METRICS_CMD && cmdLength >= 4 && cmdLength <= 5) {
+    doMetrics();
+    return;
+  }
+#endif
+
+#if CAT_USER_COMMANDS
+  // sketch supplied commands first, they may replace built in ones
+  for (int i = 0; i < userCmdCount; i++) {
+    if (userCmds[i].cmd == op) {
+      if (cmdLength < userCmds[i].minLen || cmdLength > userCmds[i].maxLen) {
+        sendNack();
+      } else {
+        userCmds[i].process(*this, cmdBuf, cmdLength);
+      }
+      return;
+    }
+  }
+#endif
+
+  if (op < CAT_CMD_TABLE_LENGTH) {
+    memcpy_P(&cmd, &CATDispatch::table[op], sizeof(cmd));
+    if (cmd.process && cmdLength >= cmd.minLen && cmdLength <= cmd.maxLen) {
+      (this->*cmd.process)();
+      return;
+    }
+  }
+
+  // For all other commands respond with an NACK
+#if CAT_FEATURE_TRACE
+  byte rejected[2] = {op, byte(cmdLength)};
+  CAT_TRACE(CAT_TRC_REJECT, rejected, sizeof(rejected));
+#endif
+  CAT_COUNT(rejects, 1);
+  sendNack();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//                        UTILITY FUNCTIONS
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// BCD FrequencyConversion Routines
+// Convert BCD frequency to/from command buffer to/from CATFreq
+// Format (beginning at first data byte in buffer is
+//  Byte 0 10Hz   | 1Hz
+//  Byte 1 1KHz   | 100Hz
+//  Byte 2 100KHz | 10KHz
+//  Byte 3 10MHz  | 1MHz
+//  Byte 4 1GHz   | 100MHz
+// Example: 7,123,456 is encoded 56 | 34 | 12 | 07 | 00
+//
+// The conversions themselves are in CATBcd.cpp and do not divide
+//
+boolean IC746::BCDtoFreq(CATFreq &freq) {
+  return catFreqField(&cmdBuf[CAT_IX_FREQ], freq);
+}
+
+void IC746::FreqtoBCD(CATFreq freq) {
+  catFreqToBCD(freq, &cmdBuf[CAT_IX_FREQ], CAT_FREQ_BYTES);
+}
+
+void IC746::SmetertoBCD(byte s) {
+  byte ones, tens, hund;
+
+  ones =     byte(s % 10);
+  tens =     byte((s / byte(10)) % 10);
+  cmdBuf[CAT_IX_SMETER+1] = byte((tens << 4)) | ones;
+
+  hund =      byte((s / byte(100)) % 10);
+  cmdBuf[CAT_IX_SMETER] = hund;
+
+}
@@ -1,207 +1,714 @@
-/*************************************************************************
-   IC746 CAT Library, by KK4DAS, Dean Souleles
-   V1.3 1/24/2023
-      - Added support for frequencies 100MHz and above.
-      - Added support for setting and getting all IC-746 defined MODES
-   
-   V1.2 
-      - Fixes bug that caused WSJTX not to connect.  Sends NACK on all unsupported
-      - commands. (Requires lastes hamlib build with WSJTX)
-   
-   V1.1 2/3/2021 
-      - various fixes, now works properly with OmniRig and flrig
-      - smeter now returns proper BCD code - calibrated to emulate ICOM responses
-      
-   V1.0 1/24/2021
-      - Initial build
-
-   Inspired by: FT857D CAT Library, by Pavel Milanes, CO7WT, pavelmc@gmail.com
-
-   The goal of this lib is to emulate an ICOM 746 CAT functionality
-   to work with all ham radio software that include CAT control
-
-   This program is free software: you can redistribute it and/or modify
-   it under the terms of the GNU General Public License as published by
-   the Free Software Foundation, either version 3 of the License, or
-   (at your option) any later version.
-
-   This program is distributed in the hope that it will be useful,
-   but WITHOUT ANY WARRANTY; without even the implied warranty of
-   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-   GNU General Public License for more details.
-
-   You should have received a copy of the GNU General Public License
-   along with this program.  If not, see <http://www.gnu.org/licenses/>.
-
- * **************************************************************************/
-
-#ifndef IC746_h
-#define IC746_h
-
-#include <Arduino.h>
-
-#define CAT_VER "1.1"
-/*
-   CAT Command definitions from IC746 Manual
-*/
-
-// Protocol
-#define CAT_PREAMBLE        0xFE  // sent twice at start of command
-#define CAT_EOM             0xFD  // end of message
-#define CAT_ACK             0xFB  // OK
-#define CAT_NACK            0xFA  // No good
-#define CAT_RIG_ADDR        0x56  // Rig ID for IC746
-#define CAT_CTRL_ADDR       0xE0  // Controller ID
-
-
-// Commands
-#define CAT_SET_TCV_FREQ    0x00  // Not implemented
-#define CAT_SET_TCV_MODE    0x01  // Not implemented
-#define CAT_READ_BAND_EDGE  0x02  // Not implemented
-#define CAT_READ_FREQ       0x03
-#define CAT_READ_MODE       0x04
-#define CAT_SET_FREQ        0x05
-#define CAT_SET_MODE        0x06
-#define CAT_SET_VFO         0x07
-#define CAT_SEL_MEM         0x08  // Not implemented
-#define CAT_WRITE_MEM       0x09  // Not implemented
-#define CAT_MEM_TO_VFO      0x0A  // Not implemented
-#define CAT_CLEAR_MEM       0x0B  // Not implemented
-#define CAT_READ_OFFSET     0x0C  // Not implemented
-#define CAT_SET_OFFSET      0x0D  // Not implemented
-#define CAT_SCAN            0x0E  // Not implemented
-#define CAT_SPLIT           0x0F
-#define CAT_SET_RD_STEP     0x10  // Not implemented
-#define CAT_SET_RD_ATT      0x11  // Not implemented
-#define CAT_SET_RD_ANT      0x12  // Not implemented
-#define CAT_SET_UT102       0x13  // Not implemented
-#define CAT_SET_RD_PARAMS1  0x14  // Not implemented
-#define CAT_READ_SMETER     0x15  // Only impemented read S-Meter
-#define CAT_SET_RD_PARAMS2  0x16  // Not implemented (various settings)
-#define CAT_READ_ID         0x19  
-#define CAT_MISC            0x1A  // Only implemented sub-command 3 Read IF filter 
-#define CAT_SET_TONE        0x1B  // Not implemented (VHF/UHF)
-#define CAT_PTT             0x1C
-
-/*
-   CAT Sub COmmands
-*/
-// Mode Subcommand
-#define CAT_MODE_LSB        0x00
-#define CAT_MODE_USB        0x01
-#define CAT_MODE_AM         0x02 
-#define CAT_MODE_CW         0x03 // LSB CW
-#define CAT_MODE_RTTY       0x04 // LSB RTTY
-#define CAT_MODE_FM         0x05 
-#define CAT_MODE_CW_R       0x07 // Reverse CW - USB
-#define CAT_MODE_RTTY_R     0x08 // Reverse RTTY - USB
-
-#define CAT_MODE_FILTER1    0x01 // Required for "read mode"
-
-// VFO Subcommand
-#define CAT_VFO_A           0x00
-#define CAT_VFO_B           0x01
-#define CAT_VFO_A_TO_B      0xA0
-#define CAT_VFO_SWAP        0xB0
-
-// Split Subcommand
-#define CAT_SPLIT_OFF       0x00
-#define CAT_SPLIT_ON        0x01
-#define CAT_SIMPLE_DUP      0x10 // Not implemented
-#define CAT_MINUS_DUP       0x11 // Not implemented
-#define CAT_PLUS_DUP        0x12 // Not implemented
-
-// S-Meter / Squelch Subcommand
-#define CAT_READ_SUB_SQL    0x01 // Not implemented (squelch)
-#define CAT_READ_SUB_SMETER 0x02
-
-// PTT Subcommand
-#define CAT_PTT_RX          0x00
-#define CAT_PTT_TX          0x01
-
-// 1A - MISC Subcommands
-#define CAT_SET_MEM_CHAN    0x00  // Not implemented
-#define CAT_SET_BANDSTACK   0x01  // Not implemented
-#define CAT_SET_MEM_KEYER   0x02  // Not implemented
-#define CAT_READ_IF_FILTER  0x03  // Hard coded response to keep WSJTX and other CAT controllers happy
-
-// Command Receive States
-#define CAT_RCV_WAITING     0  // waiting for 1st preamble byte
-#define CAT_RCV_INIT        1  // waiting for 2nd preamble byte
-#define CAT_RCV_RECEIVING   2  // waiting for command bytes
-
-// Command buffer (without preamble and EOM)
-// |FE|FE|56|E0|cmd|sub-cmd|data|FD|  // Preamble (FE) and EOM (FD) are discarded leaving
-// 2 addr bytes , 1 command, 1 sub-command, up to 12 data, (longest is unimplemented edge frequency)
-#define CAT_CMD_BUF_LENGTH  16
-
-
-
-
-
-// defining the funtion type by params
-typedef void (*FuncPtrVoid)(void);
-typedef long (*FuncPtrVoidLong)(void);
-typedef byte (*FuncPtrVoidByte)(void);
-typedef void (*FuncPtrBoolean)(boolean);
-typedef boolean (*FuncPtrVoidBoolean)(void);
-typedef void (*FuncPtrByte)(byte);
-typedef void (*FuncPtrLong)(long);
-
-/*
-   The class...
-*/
-class IC746 {
-  public:
-    // we have two kind of constructors here
-    void begin(); // default for the radio 9600 @ 8N2
-    void begin(long baudrate, int mode); // custom baudrate and mode
-    void check(); // periodic check for serial commands
-
-    // the functions that links the lib with user supplied functions
-    void addCATPtt(void (*)(boolean));
-    void addCATsplit(void (*)(boolean));
-    void addCATAtoB(void (*)(void));
-    void addCATSwapVfo(void (*)(void));
-    void addCATFSet(void (*)(long));
-    void addCATMSet(void (*)(byte));
-    void addCATVSet(void (*)(byte));
-    void addCATGetFreq(long (*)(void));
-    void addCATGetMode(byte (*)(void));
-    void addCATGetPtt(boolean (*)(void));
-    void addCATSMeter(byte (*)(void));
-
-    boolean enabled     = true;
-
-  private:
-    byte cmdBuf[CAT_CMD_BUF_LENGTH];
-    byte rcvState       = CAT_RCV_WAITING;
-    boolean cmdRcvd     = false;
-    int bytesRcvd       = 0;
-    int cmdLength       = 0;
-    long freq           = 0;
-    void setFreq(void);
-    void send(byte *, int);
-    void sendResponse(byte *buf, int len);
-    void sendAck(void);
-    void sendNack(void);
-    boolean readCmd(void);
-    long BCDtoFreq(void);
-    void FreqtoBCD(long);
-    void SmetertoBCD(byte s);
-    void doSmeter();
-    void doPtt();
-    void doSplit();
-    void doSetVfo();
-    void doSetFreq();
-    void doReadFreq();
-    void doSetMode();
-    void doReadMode();
-    void doMisc();
-    void doUnimplemented_1b();
-    void doUnimplemented_2b();
-    void doTuneStep();
-    void doAntSel();
-};
-
-#endif
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   V1.4 (in development)
+      - Pluggable transport (CATTransport), the engine can run on a Linux host over a PTY
+      - Non-blocking transmit ring buffer, drained from check()
+      - Receiver can run byte at a time from an interrupt, complete frames are queued for check()
+      - check() answers every waiting command, within an optional frame / time budget
+      - Division-free BCD frequency codec (CATBcd), full 10 digit range
+      - Optional shadow registers answer polls from RAM without calling the sketch
+      - Encoded frequency / mode responses are cached, with hit / miss counters
+      - Transceive mode - local frequency / mode changes are broadcast (commands 00 / 01)
+      - Optional set frequency coalescing for tuning storms from logging programs
+      - Callbacks are per instance; IC746Handler interface for rigs as objects
+      - Table driven command dispatch, command lengths checked, sketches can add commands
+      - Features can be compiled out (IC746Config.h), constant tables in PROGMEM
+      - Binary trace ring (CATTrace) replaces the String debug output
+      - Optional metrics - command counts, latency histogram, errors, vendor CI-V readout
+      - Link profiles (CI-V bus, USB, hamlib) for echo, framing error NACKs, address check, TX gap
+      - Automatic baud rate (CAT_BAUD_AUTO), found from the garbled preamble, re-found on errors
+      - Receiver resyncs on a new preamble, drops stalled and jammed (FC) frames, overflow fixed
+      - PTT priority lane - PTT commands act ahead of queued work, unkey from inside callbacks
+      - Deferred replies - a slow set completes later, polls are answered in the meantime
+      - The library keeps both VFOs, mode per VFO and split; split can be read (0F); the
+        unselected VFO is read and set in one command (25 / 26)
+      - Memory channels (08 - 0B, 1A 00) in EEPROM (CATMemory) - wear levelled, writes coalesced
+        and made a byte at a time from check()
+      - Band edge (02) and band stacking registers (1A 01) from a band table (CATBand) with O(1)
+        lookup; a band stacking register write changes band in one command
+      - Frequencies are CATFreq, unsigned 64 bits (32 with CAT_FREQ_BITS 32), through the handler,
+        the VFOs, memory channels, band stacking registers and band edges - the whole 10 digits,
+        up to 9.999 GHz; a set above what a CATFreq holds is NACKed
+
+   V1.3 1/24/2023
+      - Added support for frequencies 100MHz and above.
+      - Added support for setting and getting all IC-746 defined MODES
+   
+   V1.2 
+      - Fixes bug that caused WSJTX not to connect.  Sends NACK on all unsupported
+      - commands. (Requires lastes hamlib build with WSJTX)
+   
+   V1.1 2/3/2021 
+      - various fixes, now works properly with OmniRig and flrig
+      - smeter now returns proper BCD code - calibrated to emulate ICOM responses
+      
+   V1.0 1/24/2021
+      - Initial build
+
+   Inspired by: FT857D CAT Library, by Pavel Milanes, CO7WT, pavelmc@gmail.com
+
+   The goal of this lib is to emulate an ICOM 746 CAT functionality
+   to work with all ham radio software that include CAT control
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ * **************************************************************************/
+
+#ifndef IC746_h
+#define IC746_h
+
+#include <Arduino.h>
+#include "IC746Config.h"
+#include "CATTransport.h"
+#include "CATBcd.h"
+#include "CATTrace.h"
+#include "CATMetrics.h"
+#include "CATMemory.h"
+#include "CATBand.h"
+
+#define CAT_VER "1.1"
+/*
+   CAT Command definitions from IC746 Manual
+*/
+
+// Protocol
+#define CAT_PREAMBLE        0xFE  // sent twice at start of command
+#define CAT_EOM             0xFD  // end of message
+#define CAT_ACK             0xFB  // OK
+#define CAT_NACK            0xFA  // No good
+#define CAT_JAM             0xFC  // collision on the bus - sent by whoever saw it, the frame is void
+#define CAT_RIG_ADDR        0x56  // Rig ID for IC746
+#define CAT_CTRL_ADDR       0xE0  // Controller ID
+#define CAT_BCAST_ADDR      0x00  // Broadcast - transceive frames go to all controllers
+
+
+// Commands
+#define CAT_SET_TCV_FREQ    0x00  // Sent by the rig in transceive mode only
+#define CAT_SET_TCV_MODE    0x01  // Sent by the rig in transceive mode only
+#define CAT_READ_BAND_EDGE  0x02  // Band edges need CAT_FEATURE_BANDSTACK
+#define CAT_READ_FREQ       0x03
+#define CAT_READ_MODE       0x04
+#define CAT_SET_FREQ        0x05
+#define CAT_SET_MODE        0x06
+#define CAT_SET_VFO         0x07
+#define CAT_SEL_MEM         0x08  // Memory channels need CAT_FEATURE_MEMORY and setMemory()
+#define CAT_WRITE_MEM       0x09
+#define CAT_MEM_TO_VFO      0x0A
+#define CAT_CLEAR_MEM       0x0B
+#define CAT_READ_OFFSET     0x0C  // Not implemented
+#define CAT_SET_OFFSET      0x0D  // Not implemented
+#define CAT_SCAN            0x0E  // Not implemented
+#define CAT_SPLIT           0x0F
+#define CAT_SET_RD_STEP     0x10  // Not implemented
+#define CAT_SET_RD_ATT      0x11  // Not implemented
+#define CAT_SET_RD_ANT      0x12  // Not implemented
+#define CAT_SET_UT102       0x13  // Not implemented
+#define CAT_SET_RD_PARAMS1  0x14  // Not implemented
+#define CAT_READ_SMETER     0x15  // Only impemented read S-Meter
+#define CAT_SET_RD_PARAMS2  0x16  // Not implemented (various settings)
+#define CAT_READ_ID         0x19  
+#define CAT_MISC            0x1A  // Only implemented sub-command 3 Read IF filter 
+#define CAT_SET_TONE        0x1B  // Not implemented (VHF/UHF)
+#define CAT_PTT             0x1C
+#define CAT_VFO_FREQ        0x25  // Frequency of the selected / unselected VFO (IC-7300 and later)
+#define CAT_VFO_MODE        0x26  // Mode of the selected / unselected VFO (IC-7300 and later)
+
+#if CAT_FEATURE_DUAL_VFO            // command table, indexed by opcode
+#define CAT_CMD_TABLE_LENGTH (CAT_VFO_MODE + 1)
+#else
+#define CAT_CMD_TABLE_LENGTH (CAT_PTT + 1)
+#endif
+
+/*
+   CAT Sub COmmands
+*/
+// Mode Subcommand
+#define CAT_MODE_LSB        0x00
+#define CAT_MODE_USB        0x01
+#define CAT_MODE_AM         0x02 
+#define CAT_MODE_CW         0x03 // LSB CW
+#define CAT_MODE_RTTY       0x04 // LSB RTTY
+#define CAT_MODE_FM         0x05 
+#define CAT_MODE_CW_R       0x07 // Reverse CW - USB
+#define CAT_MODE_RTTY_R     0x08 // Reverse RTTY - USB
+
+#define CAT_MODE_FILTER1    0x01 // Required for "read mode"
+
+// VFO Subcommand
+#define CAT_VFO_A           0x00
+#define CAT_VFO_B           0x01
+#define CAT_VFO_A_TO_B      0xA0
+#define CAT_VFO_SWAP        0xB0
+
+// Selected / Unselected VFO Subcommand (25 / 26)
+#define CAT_VFO_SELECTED    0x00
+#define CAT_VFO_UNSELECTED  0x01
+
+// Split Subcommand
+#define CAT_SPLIT_OFF       0x00
+#define CAT_SPLIT_ON        0x01
+#define CAT_SIMPLE_DUP      0x10 // Not implemented
+#define CAT_MINUS_DUP       0x11 // Not implemented
+#define CAT_PLUS_DUP        0x12 // Not implemented
+
+// S-Meter / Squelch Subcommand
+#define CAT_READ_SUB_SQL    0x01 // Not implemented (squelch)
+#define CAT_READ_SUB_SMETER 0x02
+
+// PTT Subcommand
+#define CAT_PTT_RX          0x00
+#define CAT_PTT_TX          0x01
+#define CAT_PTT_NONE        0xFF // no PTT command waiting in the priority lane
+
+// Deferred reply states
+#define CAT_ACK_NOW         0    // replies sent as they come
+#define CAT_ACK_DEFER       1    // deferAck() called, the command's sendAck() starts the wait
+#define CAT_ACK_PENDING     2    // waiting for completeAck()
+#define CAT_ACK_FAILED      3    // completeAck(false) before the callback returned, sendAck() NACKs
+
+// 1A - MISC Subcommands
+#define CAT_SET_MEM_CHAN    0x00  // Memory channel contents, read and write
+#define CAT_SET_BANDSTACK   0x01  // Band stacking registers, read and write
+#define CAT_SET_MEM_KEYER   0x02  // Not implemented
+#define CAT_READ_IF_FILTER  0x03  // Hard coded response to keep WSJTX and other CAT controllers happy
+
+// Command Receive States
+#define CAT_RCV_WAITING     0  // waiting for 1st preamble byte
+#define CAT_RCV_INIT        1  // waiting for 2nd preamble byte
+#define CAT_RCV_RECEIVING   2  // waiting for command bytes
+
+// Command buffer (without preamble and EOM)
+// |FE|FE|56|E0|cmd|sub-cmd|data|FD|  // Preamble (FE) and EOM (FD) are discarded leaving
+// 2 addr bytes , 1 command, 1 sub-command, up to 12 data, (longest is the band edge response)
+#define CAT_CMD_BUF_LENGTH  16
+
+// Receive queue of complete commands, CAT_RX_QUEUE_LENGTH is set in IC746Config.h
+#define CAT_RX_QUEUE_MASK   (CAT_RX_QUEUE_LENGTH - 1)
+
+// Compiler barrier between filling a queue slot and publishing it
+#define CAT_BARRIER()       __asm__ __volatile__("" ::: "memory")
+
+// Transmit ring buffer - size must be a power of 2
+// Responses are queued here and trickled out to the transport from check()
+// without ever waiting on the UART.  CAT_TX_BUF_LENGTH is set in IC746Config.h
+#define CAT_TX_BUF_MASK     (CAT_TX_BUF_LENGTH - 1)
+#define CAT_FRAME_OVERHEAD  3   // 2 preamble, 1 EOM
+
+// Room needed before a new command is read: the echo plus the longest response
+#define CAT_TX_RESERVE      (2 * (CAT_CMD_BUF_LENGTH + CAT_FRAME_OVERHEAD))
+#if CAT_TX_BUF_LENGTH < CAT_TX_RESERVE
+#error "CAT_TX_BUF_LENGTH too small to hold an echo and a response"
+#endif
+
+// Complete frames kept by the response cache
+#define CAT_FRAME_FREQ      11  // FE FE E0 56 03 ff ff ff ff ff FD
+#define CAT_FRAME_MODE      8   // FE FE E0 56 04 mm ff FD
+#define CAT_FRAME_BAND_EDGE 17  // FE FE E0 56 02 ff ff ff ff ff 2D ff ff ff ff ff FD
+
+// Default minimum time between transceive broadcasts (ms)
+#define CAT_TCV_INTERVAL    100
+
+
+
+
+
+// defining the funtion type by params
+typedef void (*FuncPtrVoid)(void);
+typedef long (*FuncPtrVoidLong)(void);
+typedef byte (*FuncPtrVoidByte)(void);
+typedef void (*FuncPtrBoolean)(boolean);
+typedef boolean (*FuncPtrVoidBoolean)(void);
+typedef void (*FuncPtrByte)(byte);
+typedef void (*FuncPtrLong)(long);
+
+class IC746;
+typedef void (*FuncPtrCommand)(IC746 &radio, byte *cmd, int len);
+
+/*
+   Command table entry.  Lengths count the bytes between the preamble and EOM (addresses,
+   command, sub-command, data); commands outside minLen .. maxLen are NACKed before the
+   processor runs.  A command rdLen bytes long is a read request, rspLen is the length of
+   its response.
+*/
+struct CATCommand {
+  byte cmd;
+  byte minLen;
+  byte maxLen;
+  byte rdLen;
+  byte rspLen;
+  void (IC746::*process)(void);
+};
+
+/*
+   Link profile - what the other end of the line expects, chosen at begin()
+
+   CAT_LINK_CIV     a shared CI-V bus (CT-17 and clones).  Every command is echoed, framing
+                    errors are NACKed, commands for other addresses are ignored and the rig waits
+                    CAT_LINK_CIV_GAP microseconds of quiet line before it talks.  The default.
+   CAT_LINK_USB     a point to point USB or serial link, like an Icom with "CI-V USB echo back"
+                    off.  No echo - half the bytes on the wire - and framing errors are dropped
+                    quietly, any address is answered.
+   CAT_LINK_HAMLIB  hamlib and the programs built on it.  Echo as on the bus, but no NACK for a
+                    framing error - hamlib would take it for the answer to its next command - and
+                    any address is answered, whatever CI-V address the user has set up.
+*/
+#define CAT_LINK_CIV        0
+#define CAT_LINK_USB        1
+#define CAT_LINK_HAMLIB     2
+
+// begin() baud rate - follow the controller's, see IC746.cpp
+#define CAT_BAUD_AUTO       0L
+
+struct CATLink {
+  boolean echo;             // echo every command back
+  boolean nackFraming;      // NACK a broken preamble or an overlong frame
+  boolean checkAddress;     // ignore commands not addressed to CAT_RIG_ADDR
+  unsigned int gap;         // us of quiet receive line before transmitting, 0 - none
+};
+
+// A command added by the sketch, see addCATCommand()
+struct CATUserCommand {
+  byte cmd;
+  byte minLen;
+  byte maxLen;
+  FuncPtrCommand process;
+};
+
+/*
+   The rig, as seen by the library
+
+   Derive from IC746Handler and override what your rig supports, then pass it to setHandler().
+   Each IC746 has its own handler, so one sketch or host program can emulate several rigs on
+   several ports - the handler object is where a rig keeps its own state.
+   The "get" functions return false when the value is not available.  Frequencies are CATFreq
+   (CATBcd.h), unsigned 32 bits - the addCATxxx() functions keep the V1.3 long, which holds
+   2.147 GHz; a rig going higher uses a handler.
+*/
+class IC746Handler {
+  public:
+    virtual void setPtt(boolean) {}
+    virtual void setSplit(boolean) {}
+    virtual void vfoAtoB() {}
+    virtual void swapVfo() {}
+    virtual void setFreq(CATFreq) {}
+    virtual void setMode(byte) {}
+    virtual void setVfo(byte) {}
+    // the VFO that is not selected (CAT_VFO_A or CAT_VFO_B) - return false and the library
+    // selects it, calls setFreq() / setMode() and selects the other one again
+    virtual boolean setVfoFreq(byte, CATFreq) { return false; }
+    virtual boolean setVfoMode(byte, byte) { return false; }
+    virtual boolean getFreq(CATFreq &) { return false; }
+    virtual boolean getMode(byte &) { return false; }
+    virtual boolean getPtt(boolean &) { return false; }
+    virtual boolean getSmeter(byte &) { return false; }   // 0-15, S0-S9, +10 ... +60
+#if CAT_FEATURE_BANDSTACK
+    // the active VFO is moving to another band (CATBand.h), or out of all of them (CAT_BAND_NONE) -
+    // called before the new frequency is set, so filters and relays can switch first
+    virtual void setBand(byte) {}
+#endif
+};
+
+/*
+   The handler behind the addCATxxx() functions - forwards to the user's plain functions
+*/
+class CATCallbacks : public IC746Handler {
+  public:
+    FuncPtrBoolean catSplit           = NULL;
+    FuncPtrBoolean catSetPtt          = NULL;
+    FuncPtrVoidBoolean catGetPtt      = NULL;
+    FuncPtrVoidLong catGetFreq        = NULL;
+    FuncPtrLong catSetFreq            = NULL;
+    FuncPtrVoidByte catGetMode        = NULL;
+    FuncPtrByte catSetMode            = NULL;
+    FuncPtrVoidByte catGetSmeter      = NULL;
+    FuncPtrByte catSetVFO             = NULL;
+    FuncPtrVoid catAtoB               = NULL;
+    FuncPtrVoid catSwapVfo            = NULL;
+
+    void setPtt(boolean tx);
+    void setSplit(boolean on);
+    void vfoAtoB();
+    void swapVfo();
+    void setFreq(CATFreq freq);
+    void setMode(byte mode);
+    void setVfo(byte vfo);
+    boolean getFreq(CATFreq &freq);
+    boolean getMode(byte &mode);
+    boolean getPtt(boolean &tx);
+    boolean getSmeter(byte &s);
+};
+
+/*
+   The class...
+*/
+class IC746 {
+  public:
+    IC746();
+
+    // we have two kind of constructors here
+    void begin(); // default for the radio 9600 @ 8N2
+    void begin(long baudrate, int mode, byte link = CAT_LINK_CIV); // custom baudrate and mode, link profile
+    void begin(CATTransport &port, byte link = CAT_LINK_CIV); // user supplied transport, already configured
+    void begin(CATTransport &port, long baudrate, int mode, byte link = CAT_LINK_CIV); // user supplied transport, custom baudrate and mode
+    void setLink(const CATLink &custom); // a link other than the profiles, after begin()
+#if CAT_FEATURE_AUTOBAUD
+    long baudRate();                     // the rate the port is on, with CAT_BAUD_AUTO
+    boolean baudLocked();                // ... and a good command has been received at it
+#endif
+    int check(int maxFrames = 0, unsigned long maxMicros = 0); // periodic check for serial commands, returns commands still waiting
+    void flush(); // wait until all queued responses have been handed to the transport
+
+    // receiving
+    void receive(byte b);           // feed one received byte, safe to call from an RX interrupt
+    void pollRx();                  // read whatever the transport has into the receiver
+    void useExternalRx(boolean on); // true - the sketch feeds the receiver, check() does not read the transport
+    unsigned int rxDropped();       // complete commands discarded because the queue was full
+
+    // transmit queue status
+    int txPending();             // bytes queued, not yet written to the transport
+    int txFree();                // bytes of room left in the queue
+    unsigned int txDropped();    // frames discarded because the queue was full
+
+    // the functions that links the lib with user supplied functions
+    void addCATPtt(void (*)(boolean));
+    void addCATsplit(void (*)(boolean));
+    void addCATAtoB(void (*)(void));
+    void addCATSwapVfo(void (*)(void));
+    void addCATFSet(void (*)(long));
+    void addCATMSet(void (*)(byte));
+    void addCATVSet(void (*)(byte));
+    void addCATGetFreq(long (*)(void));
+    void addCATGetMode(byte (*)(void));
+    void addCATGetPtt(boolean (*)(void));
+    void addCATSMeter(byte (*)(void));
+
+    // or a handler object, replaces the functions above
+    void setHandler(IC746Handler &h);
+
+#if CAT_USER_COMMANDS
+    // extra commands, or replacements for built in ones - false if the table is full
+    boolean addCATCommand(byte cmd, byte minLen, byte maxLen, FuncPtrCommand process);
+#endif
+
+    // replies, for the functions added with addCATCommand() - buf holds the command as received
+    void sendResponse(byte *buf, int len);
+    void sendAck(void);
+    void sendNack(void);
+
+#if CAT_FEATURE_SHADOW
+    // shadow registers - the sketch pushes rig state, polls are answered from RAM
+    void useShadow(boolean on);
+    void updateFreq(CATFreq freq);          // active VFO
+    void updateFreq(byte vfo, CATFreq freq); // CAT_VFO_A or CAT_VFO_B
+    void updateVfo(byte vfo);
+    void updateMode(byte mode);             // active VFO
+    void updateMode(byte vfo, byte mode);
+    void updateSplit(boolean on);
+    void updatePtt(boolean tx);
+    void updateSmeter(byte s);              // 0-15, same scale as the S meter callback
+#endif
+
+#if CAT_FEATURE_TRANSCEIVE
+    // transceive - broadcast local frequency / mode changes pushed with updateFreq() / updateMode()
+    void setTransceive(boolean on, unsigned int minInterval = CAT_TCV_INTERVAL);
+#endif
+
+#if CAT_FEATURE_COALESCE
+    // set frequency coalescing - pass on only the latest frequency, at most once per interval (ms, 0 = off)
+    void setFreqCoalescing(unsigned int interval);
+#endif
+    void flushFreq();                       // apply a pending frequency now
+
+    // the library's copy of the VFOs, kept by CAT commands and the updateXxx() functions
+    CATFreq vfoFreq(byte vfo);              // CAT_VFO_A or CAT_VFO_B
+    byte vfoMode(byte vfo);
+    byte activeVfo();
+    boolean splitOn();
+    byte txVfo();                           // the VFO to transmit on - the other one in split
+
+#if CAT_FEATURE_MEMORY
+    // memory channels - commands 08 - 0B and 1A 00 keep them in the store, see CATMemory.h
+    void setMemory(CATMemory &mem);         // calls mem.begin(), check() then writes the channels
+    byte memoryChannel();                   // the channel selected with 08, 1 - CAT_MEM_CHANNELS
+#endif
+
+#if CAT_FEATURE_BANDSTACK
+    // bands - the band stacking registers follow the active VFO, see CATBand.h
+    byte band();                            // of the active VFO, CAT_BAND_NONE outside every band
+    boolean bandStack(byte band, byte reg, CATFreq &freq, byte &mode);   // reg 0 is the latest
+#endif
+
+#if CAT_FEATURE_PTT_PRIORITY
+    // PTT priority lane - a PTT set command is acted on before the commands queued ahead of it
+    void servicePtt();                      // act on a waiting PTT command now, may be called from a callback
+    unsigned long pttLatency();             // us from the EOM of the last PTT command to setPtt()
+    unsigned long pttLatencyMax();          // the longest since the last reset
+    void resetPttLatency();
+#endif
+
+#if CAT_FEATURE_ASYNC
+    // deferred replies - a set callback that starts a slow job calls deferAck() and returns,
+    // the sketch calls completeAck() when the job is done
+    boolean deferAck();                     // false outside a set callback - finish the job before returning
+    void completeAck(boolean ok = true);    // ACK, or NACK when the job failed
+    boolean ackPending();                   // deferred and not yet completed
+#endif
+
+#if CAT_FEATURE_TRACE
+    // binary trace - see CATTrace.h for the record format
+    int traceRead(byte *buf, int max);      // move whole records out, returns bytes copied
+    void trace(byte code, const byte *data, byte len);   // the sketch's own events, code >= CAT_TRC_USER
+    unsigned int traceLost();               // records overwritten before they were read
+    void traceClear();
+#endif
+
+#if CAT_FEATURE_METRICS
+    // command counters, latency histogram and error counters - see CATMetrics.h
+    const CATMetrics &metrics();
+    void resetMetrics();
+#endif
+
+#if CAT_FEATURE_RESPONSE_CACHE
+    // response cache statistics
+    unsigned long cacheHits();
+    unsigned long cacheMisses();
+    void resetCacheStats();
+#endif
+
+    boolean enabled     = true;
+
+  private:
+    CATDefaultTransport serialPort;      // default transport - the board's "Serial"
+    CATTransport *transport;             // transport in use
+    CATCallbacks callbacks;              // handler for the addCATxxx() functions
+    IC746Handler *handler;               // handler in use
+    byte cmdBuf[CAT_CMD_BUF_LENGTH];
+
+    // receiver - written by receive(), possibly in interrupt context
+    byte rxFrame[CAT_CMD_BUF_LENGTH];
+    byte rxQueue[CAT_RX_QUEUE_LENGTH][CAT_CMD_BUF_LENGTH];
+    byte rxQueueLen[CAT_RX_QUEUE_LENGTH];
+    volatile byte rxQHead = 0;       // advanced by readCmd() only
+    volatile byte rxQTail = 0;       // advanced by receive() only
+    volatile byte rxNacks = 0;       // framing errors seen by receive()
+    byte rxNacksSent      = 0;       // ... and answered by readCmd()
+    volatile unsigned int rxOverruns = 0;
+    volatile byte rxResyncs = 0;     // frames abandoned without a NACK - stalled, cut short or jammed
+    boolean externalRx    = false;
+    CATLink link = {true, true, true, CAT_LINK_CIV_GAP};   // CAT_LINK_CIV until begin()
+    volatile unsigned long rxLast = 0;   // micros() of the last byte received, kept when link.gap is set
+    volatile byte rxBytes = 0;       // bytes seen by receive() ...
+    byte rxBytesSeen      = 0;       // ... and by watchRx()
+    unsigned long rxQuiet = 0;       // millis() of the last sign of traffic
+    volatile boolean rxStale = false;    // the frame coming in has stalled - set by watchRx()
+    void watchRx(void);
+    boolean rxBusy(void);
+    void rxLock(void);
+    void rxUnlock(void);
+
+#if CAT_FEATURE_PTT_PRIORITY
+    // PTT priority lane - receive() puts PTT set commands in it as it queues them, servicePtt() acts
+    // on the one there; written from the RX interrupt with useExternalRx(), read under rxLock()
+    volatile byte pttReq  = CAT_PTT_NONE;    // the state asked for, CAT_PTT_NONE when the lane is free
+    volatile byte pttSeq  = 0;       // its place in the receive queue
+    volatile unsigned long pttTime = 0;  // micros() at its EOM
+    volatile boolean pttDone = false;    // acted on - doPtt() only acknowledges it
+    boolean pttLane       = true;    // off when the sketch has replaced CAT_PTT
+    boolean inCallback    = false;   // check() is inside a command or a retune
+    byte cmdSeq           = 0;       // place in the receive queue of the command in cmdBuf
+    unsigned long pttLat  = 0;
+    unsigned long pttLatMax = 0;
+    boolean setAheadOfPtt(void);
+    void keyPtt(boolean tx, unsigned long since);
+#endif
+
+#if CAT_FEATURE_ASYNC
+    // deferred replies - deferAck() marks the command, its sendAck() starts the wait
+    byte ackState         = 0;       // CAT_ACK_NOW, CAT_ACK_DEFER, CAT_ACK_PENDING or CAT_ACK_FAILED
+    boolean ackDeferOk    = false;   // a command's callback is running, not a retune
+    unsigned long ackSince = 0;      // millis() when the wait started
+    byte ackOp            = 0;       // the command waiting
+#if CAT_FEATURE_METRICS
+    unsigned long ackTime = 0;       // ... and micros() at its EOM
+    boolean cmdCounted    = false;   // the command in cmdBuf deferred its reply, completeAck() counts it
+#endif
+    boolean headIsPoll(void);
+#endif
+
+#if CAT_FEATURE_MEMORY
+    // memory channels
+    CATMemory *memory     = NULL;
+    byte memChan          = 0;       // selected channel, from 0
+#endif
+
+#if CAT_FEATURE_BANDSTACK
+    // band stacking registers, [0] the latest - it follows the active VFO while on the band
+    struct BandReg {
+      CATFreq freq;
+      byte mode;
+    };
+    BandReg bandRegs[CAT_BANDS][CAT_BANDSTACK_DEPTH];
+    byte curBand          = CAT_BAND_NONE;
+#if CAT_FEATURE_RESPONSE_CACHE
+    byte edgeFrame[CAT_FRAME_BAND_EDGE];
+    byte edgeFrameBand    = CAT_BAND_NONE;
+#endif
+#endif
+
+#if CAT_FEATURE_AUTOBAUD
+    // automatic baud rate
+    boolean abOn            = false;
+    boolean abLocked        = false;
+    byte abRate             = 0;     // index in the rate table
+    int abMode              = 0;
+    byte abErrors           = 0;     // since the last good command
+    boolean abSettled       = false; // the line has been quiet since the rate was set
+    volatile byte abFrames  = 0;     // counted by receive() ...
+    volatile byte abNoise   = 0;     // bytes outside a frame
+    volatile byte abSample  = 0;     // the first byte after a quiet line
+    volatile boolean abSampled = true;
+    byte abFramesSeen       = 0;     // ... and by doAutoBaud()
+    byte abNoiseSeen        = 0;
+    byte abNacksSeen        = 0;
+    void doAutoBaud(void);
+    void setBaud(byte index);
+    void traceBaud(void);
+    boolean guessBaud(byte b);
+#endif
+    byte rcvState       = CAT_RCV_WAITING;   // receive()'s - touched elsewhere only under rxLock()
+    int bytesRcvd       = 0;
+    int cmdLength       = 0;
+
+    // shadow registers - also the engine's own record of what was set over CAT
+#if CAT_FEATURE_SHADOW
+    boolean shadowOn    = false;
+#else
+    static const boolean shadowOn = false;
+#endif
+    byte shVfo          = CAT_VFO_A;
+    CATFreq shFreq[2]   = {0, 0};     // indexed by CAT_VFO_A / CAT_VFO_B
+    byte shMode[2]      = {CAT_MODE_USB, CAT_MODE_USB};
+    boolean shSplit     = false;
+    boolean shPtt       = false;
+    byte shSmeter       = 0;
+    byte shStale        = 0;          // VFOs (bit 1 << vfo) left by a select without the shadow
+                                      // registers - their copy may be behind the rig
+
+#if CAT_FEATURE_RESPONSE_CACHE
+    // response cache - complete frames for the hot polls, keyed by the value they encode
+    byte freqFrame[CAT_FRAME_FREQ];
+    CATFreq freqFrameValue  = 0;
+    boolean freqFrameValid  = false;
+    byte modeFrame[CAT_FRAME_MODE];
+    byte modeFrameValue     = 0;
+    boolean modeFrameValid  = false;
+    unsigned long rcHits    = 0;
+    unsigned long rcMisses  = 0;
+#endif
+
+#if CAT_FEATURE_TRANSCEIVE
+    // transceive
+    boolean tcvOn           = false;
+    boolean tcvFreqPending  = false;
+    boolean tcvModePending  = false;
+    unsigned int tcvInterval = CAT_TCV_INTERVAL;
+    unsigned long tcvLast   = 0;
+#endif
+    void doTransceive(void);
+
+#if CAT_FEATURE_COALESCE
+    // set frequency coalescing
+    unsigned int fcInterval = 0;
+    boolean fcPending       = false;
+    unsigned long fcLast    = 0;
+#endif
+    void applyFreq(boolean force);
+
+#if CAT_FEATURE_TRACE
+    CATTrace tracer;
+#endif
+#if CAT_FEATURE_TRACE || CAT_FEATURE_METRICS
+    unsigned int rxOverrunsSeen = 0;
+    byte rxResyncsSeen          = 0;
+    byte rxNacksSeen            = 0;     // framing errors traced and counted - also those not NACKed
+#endif
+
+#if CAT_FEATURE_METRICS
+    CATMetrics stats;
+    unsigned long rxQueueTime[CAT_RX_QUEUE_LENGTH];   // micros() at each command's EOM
+    unsigned long cmdTime;                            // ... of the command being processed
+    void doMetrics();
+#endif
+
+    byte txBuf[CAT_TX_BUF_LENGTH];
+    unsigned int txHead   = 0;     // next byte to write to the transport
+    unsigned int txTail   = 0;     // next free slot
+    unsigned int txDrops  = 0;
+    void txPut(byte b);
+    void txWrite(const byte *buf, int len);
+    void drainTx(void);
+    boolean queue(const byte *buf, int len);
+    boolean send(byte *, int);
+    boolean sendFrame(const byte *frame, int len);
+    void buildFrame(byte *frame, int len);
+    boolean readCmd(void);
+    void processCmd(void);
+
+    // command dispatch
+    friend struct CATDispatch;
+    CATCommand cmd;                     // table entry of the command being processed
+#if CAT_USER_COMMANDS
+    CATUserCommand userCmds[CAT_USER_COMMANDS];
+    byte userCmdCount = 0;
+#endif
+    boolean isRead(void);
+    boolean BCDtoFreq(CATFreq &freq);
+    void FreqtoBCD(CATFreq);
+    void SmetertoBCD(byte s);
+    void doSmeter();
+    void doPtt();
+    void doSplit();
+    void doSetVfo();
+    void doSetFreq();
+    void doReadFreq();
+    void doSetMode();
+    void doReadMode();
+    void tuneActive(CATFreq f);
+    void modeActive(byte m);
+    void syncActive();
+#if CAT_FEATURE_DUAL_VFO
+    void syncOther();
+#endif
+    void trackBand(boolean notify);
+#if CAT_FEATURE_DUAL_VFO
+    void doVfoFreq();
+    void doVfoMode();
+#endif
+#if CAT_FEATURE_MEMORY
+    int memNumber(const byte *bcd);
+    void doMemory();
+    void doMemContent();
+#endif
+#if CAT_FEATURE_BANDSTACK
+    void doBandEdge();
+    void doBandStack();
+#endif
+    void doMisc();
+    void doReadId();
+#if CAT_FEATURE_STUBS
+    void doStub();
+#endif
+};
+
+#endif
@@ -0,0 +1,205 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   IC746Config - compile time configuration
+
+   Every option can be changed here, or from the build flags without touching
+   the library (-DCAT_FEATURE_STUBS=0 in platformio.ini build_flags, or
+   compiler.cpp.extra_flags with arduino-cli).  Note that a #define in the
+   sketch does NOT reach the library - the IDE compiles it separately.
+
+   A feature that is turned off is not compiled at all: its functions are not
+   declared, so a sketch that calls one fails to compile rather than failing on
+   the air.  extras/host/size_report.sh prints the flash and RAM used by each
+   feature.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ * **************************************************************************/
+
+#ifndef IC746Config_h
+#define IC746Config_h
+
+/*
+   Command groups and features - 1 compiled in, 0 left out
+*/
+
+// Answers to the IC-746 commands a homebrew rig does not have (tuning step, attenuator,
+// antenna, the 14 / 16 settings, offset).  Left out, they are NACKed like any unknown command.
+#ifndef CAT_FEATURE_STUBS
+#define CAT_FEATURE_STUBS       1
+#endif
+
+// Frequency and mode of the selected / unselected VFO in one command (25 / 26, as on the IC-7300)
+#ifndef CAT_FEATURE_DUAL_VFO
+#define CAT_FEATURE_DUAL_VFO    1
+#endif
+
+// Shadow registers - useShadow() and the updateXxx() functions
+#ifndef CAT_FEATURE_SHADOW
+#define CAT_FEATURE_SHADOW      1
+#endif
+
+// Transceive broadcasts - setTransceive(), needs the shadow registers
+#ifndef CAT_FEATURE_TRANSCEIVE
+#define CAT_FEATURE_TRANSCEIVE  1
+#endif
+
+// Set frequency coalescing - setFreqCoalescing()
+#ifndef CAT_FEATURE_COALESCE
+#define CAT_FEATURE_COALESCE    1
+#endif
+
+// PTT priority lane - PTT set commands are acted on ahead of the receive queue, servicePtt()
+#ifndef CAT_FEATURE_PTT_PRIORITY
+#define CAT_FEATURE_PTT_PRIORITY 1
+#endif
+
+// Deferred replies - a set callback can call deferAck() and finish the job later, completeAck()
+#ifndef CAT_FEATURE_ASYNC
+#define CAT_FEATURE_ASYNC       1
+#endif
+
+// Memory channels (08 - 0B, 1A 00) kept in EEPROM by a CATMemory - setMemory(), see CATMemory.h
+#ifndef CAT_FEATURE_MEMORY
+#define CAT_FEATURE_MEMORY      1
+#endif
+
+// Band edge (02) and band stacking registers (1A 01), the band of the active VFO - band(), see CATBand.h
+#ifndef CAT_FEATURE_BANDSTACK
+#define CAT_FEATURE_BANDSTACK   1
+#endif
+
+// Encoded frequency / mode responses kept for repeat polls - cacheHits() and friends
+#ifndef CAT_FEATURE_RESPONSE_CACHE
+#define CAT_FEATURE_RESPONSE_CACHE 1
+#endif
+
+// Commands a sketch can add with addCATCommand(), 0 leaves addCATCommand() out
+#ifndef CAT_USER_COMMANDS
+#define CAT_USER_COMMANDS       2
+#endif
+
+// Binary trace of frames and errors, read out with traceRead() - see CATTrace.h
+#ifndef CAT_FEATURE_TRACE
+#define CAT_FEATURE_TRACE       0
+#endif
+
+// Command counters, latency histogram and error counters - see CATMetrics.h
+#ifndef CAT_FEATURE_METRICS
+#define CAT_FEATURE_METRICS     0
+#endif
+
+// Vendor CI-V command that reads the metrics, 0 for none
+#ifndef CAT_METRICS_CMD
+#define CAT_METRICS_CMD         0x7E
+#endif
+
+// Automatic baud rate - begin() with CAT_BAUD_AUTO follows the controller's rate
+#ifndef CAT_FEATURE_AUTOBAUD
+#define CAT_FEATURE_AUTOBAUD    1
+#endif
+
+// Bad bytes and framing errors, with no good command in between, that send the receiver
+// looking for a new rate
+#ifndef CAT_AUTOBAUD_ERRORS
+#define CAT_AUTOBAUD_ERRORS     8
+#endif
+
+// Quiet time on the receive line, us, before the rig answers with the CAT_LINK_CIV profile.
+// Raise it (2000 - 5000) when other rigs or controllers share the bus and collide with the answers.
+#ifndef CAT_LINK_CIV_GAP
+#define CAT_LINK_CIV_GAP        0
+#endif
+
+// Longest gap between the bytes of a frame, ms - a frame that stalls longer is dropped,
+// rather than run into the next one.  The default covers a byte time at 1200 baud with room
+// to spare; 0 waits for the EOM forever, as V1.3 did.  Checked by check(), so a slow main
+// loop stretches it.
+#ifndef CAT_RX_BYTE_TIMEOUT
+#define CAT_RX_BYTE_TIMEOUT     20
+#endif
+
+// Longest a deferred reply may take, ms - a set command not completed by then is NACKed.
+// Keep it under the controller's own timeout (hamlib waits about a second).
+#ifndef CAT_ASYNC_TIMEOUT
+#define CAT_ASYNC_TIMEOUT       500
+#endif
+
+// Time a written memory channel waits in RAM before it goes to the EEPROM, ms - more writes to
+// it in that time cost nothing.  A channel is lost if the power goes first, unless the sketch
+// calls flush().
+#ifndef CAT_MEM_WRITE_DELAY
+#define CAT_MEM_WRITE_DELAY     2000
+#endif
+
+// Width of a frequency (CATFreq), 64 or 32 bits.  64 carries the whole 10 digit frequency field,
+// up to 9.999 GHz; 32 stops at 4.294 GHz and saves RAM - 4 bytes a band stacking register - and
+// flash.  A set command for a frequency that does not fit is NACKed.
+#ifndef CAT_FREQ_BITS
+#define CAT_FREQ_BITS           64
+#endif
+
+/*
+   Buffer sizes
+*/
+
+// Receive queue of complete commands - size must be a power of 2, at most 128
+#ifndef CAT_RX_QUEUE_LENGTH
+#define CAT_RX_QUEUE_LENGTH     4
+#endif
+
+// Transmit ring buffer - size must be a power of 2
+#ifndef CAT_TX_BUF_LENGTH
+#define CAT_TX_BUF_LENGTH       64
+#endif
+
+// Memory channels, 1 - 99.  The store needs more than this many records (CATMemory.h), 10 bytes each
+#ifndef CAT_MEM_CHANNELS
+#define CAT_MEM_CHANNELS        20
+#endif
+
+// Written memory channels that can wait at once - with all in use, the one that has waited
+// longest is written there and then
+#ifndef CAT_MEM_PENDING
+#define CAT_MEM_PENDING         4
+#endif
+
+// Band stacking registers per band, 1 - 9 - the IC-746 has 3.  9 bytes of RAM each (5 with
+// CAT_FREQ_BITS 32), 11 bands.
+#ifndef CAT_BANDSTACK_DEPTH
+#define CAT_BANDSTACK_DEPTH     3
+#endif
+
+// Trace ring - size must be a power of 2
+#ifndef CAT_TRACE_BUF_LENGTH
+#define CAT_TRACE_BUF_LENGTH    128
+#endif
+
+#if CAT_FEATURE_TRANSCEIVE && !CAT_FEATURE_SHADOW
+#error "CAT_FEATURE_TRANSCEIVE needs CAT_FEATURE_SHADOW"
+#endif
+
+#if CAT_FREQ_BITS != 64 && CAT_FREQ_BITS != 32
+#error "CAT_FREQ_BITS must be 64 or 32"
+#endif
+
+#if CAT_MEM_CHANNELS < 1 || CAT_MEM_CHANNELS > 99
+#error "CAT_MEM_CHANNELS must be 1 - 99"
+#endif
+
+#if CAT_BANDSTACK_DEPTH < 1 || CAT_BANDSTACK_DEPTH > 9
+#error "CAT_BANDSTACK_DEPTH must be 1 - 9"
+#endif
+
+#endif
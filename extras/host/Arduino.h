@@ -0,0 +1,94 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   Host build support - the minimal subset of the Arduino core used by the library
+
+   This header stands in for <Arduino.h> when the library is compiled as part of a
+   Linux / POSIX program (see extras/host/README.md).  It is never seen by the
+   Arduino IDE, which does not compile anything under "extras".
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ * **************************************************************************/
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+// Serial modes, values as in the AVR core
+#define SERIAL_8N1  0x06
+#define SERIAL_8N2  0x0E
+#define SERIAL_8E1  0x26
+#define SERIAL_8O1  0x36
+
+// Program memory is ordinary memory on the host
+#define PROGMEM
+#define memcpy_P(dst, src, n)   memcpy((dst), (src), (n))
+#define pgm_read_byte(p)        (*(const uint8_t *)(p))
+
+// Timing - wall clock since program start
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+
+// Host only - replace the wall clock by a simulator's, microseconds; NULL restores it
+void hostSetClock(unsigned long long (*clock)(void));
+
+// Interrupts - nothing to mask on the host, civ_sim -x calls receive() between the engine's steps
+#define noInterrupts()  do { } while (0)
+#define interrupts()    do { } while (0)
+
+/*
+   There is no UART on the host - "Serial" exists so that the default transport links,
+   it never has data to read and discards everything written to it.
+*/
+class HardwareSerial {
+  public:
+    void begin(unsigned long, int) {}
+    void end() {}
+    int available() { return 0; }
+    int read() { return -1; }
+    size_t write(uint8_t) { return 1; }
+    size_t write(const uint8_t *, size_t n) { return n; }
+    int availableForWrite() { return 64; }
+};
+
+#ifdef CAT_HOST_NATIVE_USB
+/*
+   -DCAT_HOST_NATIVE_USB - "Serial" as on the ATmega32U4 (Leonardo, Micro): the USB port,
+   a Stream of another class than the UARTs, which are Serial1 ...
+*/
+class Serial_ {
+  public:
+    void begin(unsigned long, uint8_t) {}
+    void end() {}
+    int available() { return 0; }
+    int read() { return -1; }
+    size_t write(uint8_t) { return 1; }
+    size_t write(const uint8_t *, size_t n) { return n; }
+    int availableForWrite() { return 64; }
+};
+
+extern Serial_ Serial;
+extern HardwareSerial Serial1;
+#else
+extern HardwareSerial Serial;
+#endif
+
+#endif
@@ -0,0 +1,63 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   Host build support - POSIX implementation of the Arduino core subset
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***************************************************************************/
+
+#include <time.h>
+#include "Arduino.h"
+
+#ifdef CAT_HOST_NATIVE_USB
+Serial_ Serial;
+HardwareSerial Serial1;
+#else
+HardwareSerial Serial;
+#endif
+
+static unsigned long long clockMicros() {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000ULL + (unsigned long long)ts.tv_nsec / 1000ULL;
+}
+
+// Program start stands in for the board reset
+static const unsigned long long start = clockMicros();
+
+static unsigned long long (*virtualClock)(void) = NULL;
+
+void hostSetClock(unsigned long long (*clock)(void)) {
+  virtualClock = clock;
+}
+
+static unsigned long long nowMicros() {
+  return virtualClock ? virtualClock() : clockMicros() - start;
+}
+
+unsigned long millis() {
+  return (unsigned long)(nowMicros() / 1000ULL);
+}
+
+unsigned long micros() {
+  return (unsigned long)nowMicros();
+}
+
+void delay(unsigned long ms) {
+  struct timespec ts;
+  ts.tv_sec = ms / 1000;
+  ts.tv_nsec = (ms % 1000) * 1000000L;
+  nanosleep(&ts, NULL);
+}
@@ -0,0 +1,94 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   CATMemStorage - the memory channel store of the host tools
+
+   An EEPROM in RAM, optionally loaded from and saved to a file, that counts
+   the writes to every byte - the wear an AVR EEPROM would see, rated for
+   100,000 writes a byte.  A byte write can be given the EEPROM's write time:
+   ready() is false until it has passed on the host clock, which civ_sim runs
+   in virtual time.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ * **************************************************************************/
+
+#ifndef CATMemStorage_h
+#define CATMemStorage_h
+
+#include <stdio.h>
+#include <vector>
+
+#include "CATStorage.h"
+
+#define CAT_MEM_STORAGE_SIZE  1024     // the ATmega328's EEPROM
+
+class CATMemStorage : public CATStorage {
+  public:
+    unsigned long writes = 0;          // bytes written
+    boolean dirty = false;             // written since the last save()
+
+    CATMemStorage(unsigned int size = CAT_MEM_STORAGE_SIZE, unsigned long writeMicros = 0)
+      : bytes(size, 0xFF), wear(size, 0), writeTime(writeMicros) {}
+
+    unsigned int size() { return (unsigned int)bytes.size(); }
+
+    byte read(unsigned int addr) { return addr < bytes.size() ? bytes[addr] : 0xFF; }
+
+    void write(unsigned int addr, byte b) {
+      if (addr >= bytes.size()) return;
+      bytes[addr] = b;
+      wear[addr]++;
+      writes++;
+      dirty = true;
+      doneAt = micros() + writeTime;
+    }
+
+    boolean ready() { return (long)(micros() - doneAt) >= 0; }
+
+    // micros() until the byte being written is done
+    unsigned long busyFor() { return ready() ? 0 : doneAt - micros(); }
+
+    // writes to the most written byte
+    unsigned long maxWear() {
+      unsigned long m = 0;
+      for (unsigned long w : wear) if (w > m) m = w;
+      return m;
+    }
+
+    // a missing file is an erased EEPROM
+    boolean load(const char *path) {
+      FILE *f = fopen(path, "rb");
+      if (!f) return false;
+      size_t n = fread(bytes.data(), 1, bytes.size(), f);
+      fclose(f);
+      return n > 0;
+    }
+
+    boolean save(const char *path) {
+      FILE *f = fopen(path, "wb");
+      if (!f) return false;
+      boolean ok = fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+      ok = fclose(f) == 0 && ok;
+      if (ok) dirty = false;
+      return ok;
+    }
+
+  private:
+    std::vector<byte> bytes;
+    std::vector<unsigned long> wear;
+    unsigned long writeTime;
+    unsigned long doneAt = 0;
+};
+
+#endif
@@ -0,0 +1,215 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   CAT Transport over a POSIX pseudo-terminal (Linux host)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***************************************************************************/
+
+#ifndef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 600
+#endif
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "CATPtyTransport.h"
+
+CATPtyTransport::CATPtyTransport() {
+  master = -1;
+  slave = -1;
+  name[0] = 0;
+  link[0] = 0;
+  rxHead = 0;
+  rxCount = 0;
+}
+
+CATPtyTransport::~CATPtyTransport() {
+  close();
+}
+
+//
+// open() - create the pseudo-terminal pair, raw 8 bit, non-blocking master
+//
+boolean CATPtyTransport::open(const char *linkPath) {
+  struct termios tio;
+  char *pts;
+
+  master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0) return false;
+
+  if (grantpt(master) != 0 || unlockpt(master) != 0 || (pts = ptsname(master)) == NULL) {
+    close();
+    return false;
+  }
+  snprintf(name, sizeof(name), "%s", pts);
+
+  slave = ::open(name, O_RDWR | O_NOCTTY);
+  if (slave < 0) {
+    close();
+    return false;
+  }
+
+  // raw mode - no echo, no line editing, no CR/LF translation
+  if (tcgetattr(slave, &tio) == 0) {
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+  }
+
+  fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+  if (linkPath) {
+    unlink(linkPath);
+    if (symlink(name, linkPath) != 0) {
+      close();
+      return false;
+    }
+    snprintf(link, sizeof(link), "%s", linkPath);
+  }
+  return true;
+}
+
+void CATPtyTransport::close() {
+  if (link[0]) {
+    unlink(link);
+    link[0] = 0;
+  }
+  if (slave >= 0) {
+    ::close(slave);
+    slave = -1;
+  }
+  if (master >= 0) {
+    ::close(master);
+    master = -1;
+  }
+}
+
+const char *CATPtyTransport::slaveName() {
+  return name;
+}
+
+//
+// wait() - sleep until the client sends something, keeps the host loop from spinning
+//
+boolean CATPtyTransport::wait(int timeoutMs) {
+  struct pollfd pfd;
+
+  if (rxCount > 0) return true;
+
+  pfd.fd = master;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  return poll(&pfd, 1, timeoutMs) > 0 && (pfd.revents & POLLIN);
+}
+
+boolean CATPtyTransport::wait(CATPtyTransport *ports[], int n, int timeoutMs) {
+  struct pollfd pfd[CAT_PTY_MAX_WAIT];
+
+  if (n > CAT_PTY_MAX_WAIT) n = CAT_PTY_MAX_WAIT;
+  for (int i = 0; i < n; i++) {
+    if (ports[i]->rxCount > 0) return true;
+    pfd[i].fd = ports[i]->master;
+    pfd[i].events = POLLIN;
+    pfd[i].revents = 0;
+  }
+  return poll(pfd, n, timeoutMs) > 0;
+}
+
+// The baud rate and framing are whatever the client set on the slave side
+void CATPtyTransport::begin(long baudrate, int mode) {
+  (void)baudrate;
+  (void)mode;
+}
+
+//
+// fill() - top up the receive buffer without blocking
+//
+void CATPtyTransport::fill() {
+  ssize_t n;
+
+  if (rxCount > 0 || master < 0) return;
+
+  n = ::read(master, rxBuf, CAT_PTY_RX_BUF_LENGTH);
+  if (n > 0) {
+    rxHead = 0;
+    rxCount = (int)n;
+  }
+}
+
+int CATPtyTransport::available() {
+  fill();
+  return rxCount;
+}
+
+int CATPtyTransport::read() {
+  fill();
+  if (rxCount == 0) return -1;
+  rxCount--;
+  return rxBuf[rxHead++];
+}
+
+//
+// writeBytes() - the whole run in one write(), looping only on a partial write.  A full pty
+// gets a short grace period, after that the rest is dropped (nobody is reading the slave side)
+//
+void CATPtyTransport::writeBytes(const byte *buf, int len) {
+  struct pollfd pfd;
+  ssize_t n;
+
+  if (master < 0) return;
+  while (len > 0) {
+    n = ::write(master, buf, len);
+    if (n > 0) {
+      buf += n;
+      len -= (int)n;
+      continue;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && errno != EAGAIN) return;
+    pfd.fd = master;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, 10) <= 0) return;
+  }
+}
+
+void CATPtyTransport::write(byte b) {
+  writeBytes(&b, 1);
+}
+
+//
+// availableForWrite() - the kernel does not report free space on a pty, so report a chunk
+// whenever it is writable at all
+//
+int CATPtyTransport::availableForWrite() {
+  struct pollfd pfd;
+
+  if (master < 0) return 0;
+
+  pfd.fd = master;
+  pfd.events = POLLOUT;
+  pfd.revents = 0;
+  if (poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLOUT)) {
+    return CAT_PTY_TX_CHUNK;
+  }
+  return 0;
+}
@@ -0,0 +1,66 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   CAT Transport over a POSIX pseudo-terminal (Linux host)
+
+   The transport creates a pseudo-terminal pair and keeps the master side.  CAT
+   software (hamlib rigctl, WSJTX, flrig) opens the slave side - /dev/pts/N or a
+   symlink to it - exactly as it would open the serial port of a real rig.  The
+   baud rate chosen by the client is accepted but has no effect, so the protocol
+   engine runs as fast as the host can move bytes.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ * **************************************************************************/
+
+#ifndef CATPtyTransport_h
+#define CATPtyTransport_h
+
+#include <Arduino.h>
+#include "CATTransport.h"
+
+#define CAT_PTY_RX_BUF_LENGTH 256
+#define CAT_PTY_TX_CHUNK      256   // bytes accepted per availableForWrite() when the pty has room
+#define CAT_PTY_MAX_WAIT      16    // ptys one wait() can watch
+
+class CATPtyTransport : public CATTransport {
+  public:
+    CATPtyTransport();
+    ~CATPtyTransport();
+
+    boolean open(const char *linkPath = NULL);  // create the pty, optionally symlink the slave to linkPath
+    void close(void);
+    const char *slaveName(void);                // path the CAT software should open
+    boolean wait(int timeoutMs);                // block until input is ready or timeout, true if input ready
+    static boolean wait(CATPtyTransport *ports[], int n, int timeoutMs);   // the same for several ptys
+
+    // CATTransport
+    void begin(long baudrate, int mode);
+    int available();
+    int read();
+    void write(byte b);
+    void writeBytes(const byte *buf, int len);
+    int availableForWrite();
+
+  private:
+    int master;
+    int slave;                                  // held open so the master survives client disconnects
+    char name[64];
+    char link[256];
+    byte rxBuf[CAT_PTY_RX_BUF_LENGTH];
+    int rxHead;
+    int rxCount;
+    void fill(void);
+};
+
+#endif
@@ -0,0 +1,150 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   CAT Recorder - capture the CI-V bytes of a transport to a file
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***************************************************************************/
+
+#include <string.h>
+#include "CATRecorder.h"
+
+CATRecorder::CATRecorder(CATTransport &transport) : inner(transport) {
+  file = NULL;
+  dir = 0;
+  len = 0;
+  start = lastByte = lastRecord = 0;
+}
+
+CATRecorder::~CATRecorder() {
+  close();
+}
+
+boolean CATRecorder::open(const char *path, const char *info) {
+  size_t n = strlen(info);
+
+  close();
+  if (!(file = fopen(path, "wb"))) return false;
+  if (n > 255) n = 255;
+  fwrite(CAT_REC_MAGIC, 1, 4, file);
+  fputc(CAT_REC_VERSION, file);
+  fputc((int)n, file);
+  fwrite(info, 1, n, file);
+  lastRecord = micros();
+  return true;
+}
+
+//
+// flush() - write the record being gathered
+//
+void CATRecorder::flush() {
+  unsigned long dt = start - lastRecord;
+
+  if (!file || !len) return;
+  fputc(dir, file);
+  do {                                      // LEB128
+    byte b = dt & 0x7F;
+    dt >>= 7;
+    fputc(dt ? b | 0x80 : b, file);
+  } while (dt);
+  fputc(len, file);
+  fwrite(data, 1, len, file);
+  fflush(file);
+  lastRecord = start;
+  len = 0;
+  dir = 0;
+}
+
+void CATRecorder::close() {
+  if (!file) return;
+  flush();
+  fclose(file);
+  file = NULL;
+}
+
+void CATRecorder::log(byte d, byte b) {
+  unsigned long now = micros();
+
+  if (!file) return;
+  if (len && (d != dir || now - lastByte > CAT_REC_GAP_US || len == CAT_REC_MAX_DATA)) flush();
+  if (!len) {
+    dir = d;
+    start = now;
+  }
+  data[len++] = b;
+  lastByte = now;
+}
+
+void CATRecorder::begin(long baudrate, int mode) {
+  inner.begin(baudrate, mode);
+}
+
+int CATRecorder::available() {
+  return inner.available();
+}
+
+int CATRecorder::read() {
+  int b = inner.read();
+  if (b >= 0) log(CAT_TRC_RX, byte(b));
+  return b;
+}
+
+void CATRecorder::write(byte b) {
+  log(CAT_TRC_TX, b);
+  inner.write(b);
+}
+
+void CATRecorder::writeBytes(const byte *buf, int len) {
+  for (int i = 0; i < len; i++) log(CAT_TRC_TX, buf[i]);
+  inner.writeBytes(buf, len);
+}
+
+int CATRecorder::availableForWrite() {
+  return inner.availableForWrite();
+}
+
+//
+// Reading a capture back
+//
+boolean catReadCaptureHeader(FILE *f, char *info, int max) {
+  byte hdr[6];
+  int n;
+
+  if (fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr)) return false;
+  if (memcmp(hdr, CAT_REC_MAGIC, 4) != 0 || hdr[4] != CAT_REC_VERSION) return false;
+  n = hdr[5];
+  for (int i = 0; i < n; i++) {
+    int c = fgetc(f);
+    if (c == EOF) return false;
+    if (i < max - 1) info[i] = char(c);
+  }
+  info[n < max - 1 ? n : max - 1] = 0;
+  return true;
+}
+
+boolean catReadRecord(FILE *f, CATRecord &r) {
+  int c, shift = 0;
+
+  if ((c = fgetc(f)) == EOF) return false;
+  r.dir = byte(c);
+  r.dt = 0;
+  do {
+    if ((c = fgetc(f)) == EOF || shift > 28) return false;
+    r.dt |= (unsigned long)(c & 0x7F) << shift;
+    shift += 7;
+  } while (c & 0x80);
+  if ((c = fgetc(f)) == EOF) return false;
+  r.len = c;
+  return fread(r.data, 1, r.len, f) == (size_t)r.len;
+}
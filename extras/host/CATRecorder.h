@@ -0,0 +1,95 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   CAT Recorder - capture the CI-V bytes of a transport to a file
+
+   Sits between the engine and its transport and passes everything through,
+   writing each byte read or written to a capture file with its time.  The
+   capture is replayed against the engine by civ_replay, which checks that the
+   responses still match the recorded ones.
+
+   Capture format:
+     header     "CIVC", version (1), info length n, n bytes of info text
+                (ic746_pty puts its rig options there, civ_replay applies them)
+     records    back to back until the end of the file:
+       byte 0     direction - CAT_TRC_RX (to the rig) or CAT_TRC_TX (from the rig)
+       byte 1..   time since the previous record in microseconds, unsigned
+                  LEB128 (7 bits a byte, low bits first, top bit set on all but the last)
+       next       data length n (1 - 255)
+       next       n data bytes
+
+   Bytes are gathered into one record until the direction changes, the line
+   is quiet for more than CAT_REC_GAP_US or the record is full, so a frame
+   usually takes a single record with four or five bytes of overhead.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ * **************************************************************************/
+
+#ifndef CATRecorder_h
+#define CATRecorder_h
+
+#include <stdio.h>
+
+#include <Arduino.h>
+#include "CATTransport.h"
+#include "CATTrace.h"
+
+#define CAT_REC_MAGIC       "CIVC"
+#define CAT_REC_VERSION     1
+#define CAT_REC_GAP_US      1000    // quiet time that closes a record
+#define CAT_REC_MAX_DATA    255
+
+class CATRecorder : public CATTransport {
+  public:
+    CATRecorder(CATTransport &transport);
+    ~CATRecorder();
+
+    boolean open(const char *path, const char *info = "");   // create the capture file, write the header
+    void flush(void);                                        // write out the record being gathered
+    void close(void);
+
+    // CATTransport
+    void begin(long baudrate, int mode);
+    int available();
+    int read();
+    void write(byte b);
+    void writeBytes(const byte *buf, int len);
+    int availableForWrite();
+
+  private:
+    CATTransport &inner;
+    FILE *file;
+    byte dir;                       // direction of the record being gathered, 0 if none
+    byte data[CAT_REC_MAX_DATA];
+    int len;
+    unsigned long start;            // micros() of its first byte
+    unsigned long lastByte;         // micros() of its last byte
+    unsigned long lastRecord;       // start of the previous record
+    void log(byte d, byte b);
+};
+
+//
+// Reading a capture back, for the host tools
+//
+struct CATRecord {
+  byte dir;
+  unsigned long dt;                 // microseconds since the previous record
+  int len;
+  byte data[CAT_REC_MAX_DATA];
+};
+
+boolean catReadCaptureHeader(FILE *f, char *info, int max);   // false if not a capture
+boolean catReadRecord(FILE *f, CATRecord &r);                 // false at the end of the file
+
+#endif
@@ -0,0 +1,66 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   CATSize - the smallest sketch that uses every callback, for size_report.sh
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***************************************************************************/
+
+#include <IC746.h>
+
+IC746 radio = IC746();
+
+volatile long frequency = 7074000L;
+volatile byte mode = CAT_MODE_USB;
+volatile byte vfo = CAT_VFO_A;
+volatile boolean tx = false;
+volatile boolean split = false;
+
+void catSetPtt(boolean t) { tx = t; }
+boolean catGetPtt() { return tx; }
+void catSetSplit(boolean s) { split = s; }
+void catSwapVfo() { vfo ^= 1; }
+void catVfoAtoB() { }
+void catSetFreq(long f) { frequency = f; }
+long catGetFreq() { return frequency; }
+void catSetMode(byte m) { mode = m; }
+byte catGetMode() { return mode; }
+void catSetVFO(byte v) { vfo = v; }
+byte catGetSMeter() { return 5; }
+
+void setup() {
+  radio.addCATPtt(catSetPtt);
+  radio.addCATGetPtt(catGetPtt);
+  radio.addCATAtoB(catVfoAtoB);
+  radio.addCATSwapVfo(catSwapVfo);
+  radio.addCATsplit(catSetSplit);
+  radio.addCATFSet(catSetFreq);
+  radio.addCATMSet(catSetMode);
+  radio.addCATVSet(catSetVFO);
+  radio.addCATGetFreq(catGetFreq);
+  radio.addCATGetMode(catGetMode);
+  radio.addCATSMeter(catGetSMeter);
+  radio.begin(19200, SERIAL_8N1);
+}
+
+void loop() {
+  radio.check();
+}
+
+#ifdef CAT_SIZE_HOST
+int main() {
+  setup();
+  for (;;) loop();
+}
+#endif
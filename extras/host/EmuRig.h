@@ -0,0 +1,202 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   EmuRig - the in-memory rig of the host tools
+
+   Two VFOs, mode, split, PTT and a sweeping S-meter behind an IC746 engine.
+   ic746_pty puts it on a pseudo-terminal, civ_replay replays captures against
+   it - both must see the same rig for a capture to replay byte for byte.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ * **************************************************************************/
+
+#ifndef EmuRig_h
+#define EmuRig_h
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "IC746.h"
+
+// Link profile by name, as the host tools take it on the command line - -1 if unknown
+static inline int linkProfile(const char *name) {
+  if (strcmp(name, "civ") == 0) return CAT_LINK_CIV;
+  if (strcmp(name, "usb") == 0) return CAT_LINK_USB;
+  if (strcmp(name, "hamlib") == 0) return CAT_LINK_HAMLIB;
+  return -1;
+}
+
+class EmuRig : public IC746Handler {
+  public:
+    IC746 radio;
+    int id = 1;
+    boolean verbose = true;      // print every change on stdout
+
+    CATFreq freqA = 7074000UL;
+    CATFreq freqB = 14074000UL;
+    byte activeVFO = CAT_VFO_A;
+    byte mode = CAT_MODE_USB;        // of the active VFO
+    byte modeOther = CAT_MODE_USB;   // ... and of the other one
+    boolean split = false;
+    boolean ptt = false;
+    byte smeter = 0;
+
+    void setPtt(boolean tx) {
+      ptt = tx;
+      note("PTT %s", tx ? "TX" : "RX");
+    }
+
+    boolean getPtt(boolean &tx) {
+      tx = ptt;
+      return true;
+    }
+
+    void setSplit(boolean on) {
+      split = on;
+      note("Split %s", on ? "on" : "off");
+    }
+
+    void swapVfo() {
+      CATFreq f = freqA;
+      byte m = mode;
+      freqA = freqB;
+      freqB = f;
+      mode = modeOther;
+      modeOther = m;
+      note("Swap VFO");
+    }
+
+    void vfoAtoB() {
+      if (activeVFO == CAT_VFO_A) {
+        freqB = freqA;
+      } else {
+        freqA = freqB;
+      }
+      modeOther = mode;
+      note("VFO A=B");
+    }
+
+    void setFreq(CATFreq f) {
+      if (activeVFO == CAT_VFO_A) {
+        freqA = f;
+      } else {
+        freqB = f;
+      }
+      note("Freq %llu", (unsigned long long)f);
+    }
+
+    boolean getFreq(CATFreq &f) {
+      f = activeVFO == CAT_VFO_A ? freqA : freqB;
+      return true;
+    }
+
+    void setMode(byte m) {
+      mode = m;
+      note("Mode %02X", m);
+    }
+
+    boolean getMode(byte &m) {
+      m = mode;
+      return true;
+    }
+
+#if CAT_FEATURE_BANDSTACK
+    void setBand(byte b) {
+      static const char *const names[CAT_BANDS] = {"160", "80", "40", "30", "20", "17", "15", "12", "10", "6", "2"};
+
+      if (b == CAT_BAND_NONE) {
+        note("Out of band");
+      } else {
+        note("Band %s m", names[b]);
+      }
+    }
+#endif
+
+    void setVfo(byte v) {
+      if (v != activeVFO) {
+        byte m = mode;
+        mode = modeOther;
+        modeOther = m;
+      }
+      activeVFO = v;
+      note("VFO %c", v == CAT_VFO_A ? 'A' : 'B');
+    }
+
+    // the VFO that is not selected, without selecting it
+    boolean setVfoFreq(byte v, CATFreq f) {
+      if (v == CAT_VFO_A) {
+        freqA = f;
+      } else {
+        freqB = f;
+      }
+      note("VFO %c freq %llu", v == CAT_VFO_A ? 'A' : 'B', (unsigned long long)f);
+      return true;
+    }
+
+    boolean setVfoMode(byte v, byte m) {
+      modeOther = m;
+      note("VFO %c mode %02X", v == CAT_VFO_A ? 'A' : 'B', m);
+      return true;
+    }
+
+    boolean getSmeter(byte &s) {
+      smeter = (smeter + 1) & 0x0F;    // sweep S0 .. +60
+      s = smeter;
+      return true;
+    }
+
+    // the library set up as the ic746_pty options ask, before begin()
+    void setup(boolean shadow, boolean transceive, unsigned int coalesce) {
+      radio.setHandler(*this);
+      radio.updateFreq(CAT_VFO_A, freqA);
+      radio.updateFreq(CAT_VFO_B, freqB);
+      radio.updateVfo(activeVFO);
+      radio.updateMode(activeVFO, mode);
+      radio.updateMode(activeVFO ^ 1, modeOther);
+      radio.useShadow(shadow);
+      radio.setTransceive(transceive);
+      radio.setFreqCoalescing(coalesce);
+    }
+
+    // local changes, pushed to the library as a real rig would
+    void panelFreq(CATFreq f) {
+      if (activeVFO == CAT_VFO_A) {
+        freqA = f;
+      } else {
+        freqB = f;
+      }
+      radio.updateFreq(f);
+      note("Panel freq %llu", (unsigned long long)f);
+    }
+
+    void panelMode(byte m) {
+      mode = m;
+      radio.updateMode(m);
+      note("Panel mode %02X", m);
+    }
+
+  private:
+    void note(const char *fmt, ...) {
+      va_list ap;
+      if (!verbose) return;
+      printf("%d: ", id);
+      va_start(ap, fmt);
+      vprintf(fmt, ap);
+      va_end(ap);
+      printf("\n");
+    }
+};
+
+#endif
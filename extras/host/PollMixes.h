@@ -0,0 +1,104 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   PollMixes - the commands common CAT programs poll an IC-746 with
+
+   Each mix is the commands one program was seen polling with on an idle
+   IC-746 connection, in its order; set frequency / mode are what a band change
+   or a WSJT-X split cycle adds.  Used by cat_bench and civ_sim.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ * **************************************************************************/
+
+#ifndef PollMixes_h
+#define PollMixes_h
+
+#include <stdio.h>
+#include <vector>
+
+#include "IC746.h"
+
+#define POLL_FRAME_LENGTH  16
+
+//
+// A command, without preamble and EOM: rig, controller, opcode, data
+//
+struct Frame {
+  byte len;
+  byte data[POLL_FRAME_LENGTH];
+};
+
+struct Mix {
+  const char *name;
+  std::vector<Frame> frames;
+};
+
+#define POLL_FRAME(...) Frame{sizeof((byte[]){__VA_ARGS__}), {__VA_ARGS__}}
+#define POLL_RIG CAT_RIG_ADDR, CAT_CTRL_ADDR
+
+static const Frame readFreq     = POLL_FRAME(POLL_RIG, 0x03);
+static const Frame readMode     = POLL_FRAME(POLL_RIG, 0x04);
+static const Frame readPtt      = POLL_FRAME(POLL_RIG, 0x1C, 0x00);
+static const Frame readSmeter   = POLL_FRAME(POLL_RIG, 0x15, 0x02);
+static const Frame readPower    = POLL_FRAME(POLL_RIG, 0x14, 0x0A);
+static const Frame readId       = POLL_FRAME(POLL_RIG, 0x19, 0x00);
+static const Frame setFreq      = POLL_FRAME(POLL_RIG, 0x05, 0x00, 0x40, 0x07, 0x14, 0x00);
+static const Frame setMode      = POLL_FRAME(POLL_RIG, 0x06, 0x01, 0x01);
+static const Frame setVfoA      = POLL_FRAME(POLL_RIG, 0x07, 0x00);
+static const Frame setVfoB      = POLL_FRAME(POLL_RIG, 0x07, 0x01);
+static const Frame pttOn        = POLL_FRAME(POLL_RIG, 0x1C, 0x00, 0x01);
+static const Frame pttOff       = POLL_FRAME(POLL_RIG, 0x1C, 0x00, 0x00);
+static const Frame readSplit    = POLL_FRAME(POLL_RIG, 0x0F);
+static const Frame setTxFreq    = POLL_FRAME(POLL_RIG, 0x25, 0x01, 0x00, 0x50, 0x07, 0x14, 0x00);
+static const Frame readTxFreq   = POLL_FRAME(POLL_RIG, 0x25, 0x01);
+static const Frame readTxMode   = POLL_FRAME(POLL_RIG, 0x26, 0x01);
+static const Frame selMem1      = POLL_FRAME(POLL_RIG, 0x08, 0x00, 0x01);
+static const Frame writeMem     = POLL_FRAME(POLL_RIG, 0x09);
+static const Frame setMem2      = POLL_FRAME(POLL_RIG, 0x1A, 0x00, 0x00, 0x02,
+                                             0x00, 0x50, 0x07, 0x14, 0x00, 0x01, 0x01, 0x00);
+static const Frame readMem2     = POLL_FRAME(POLL_RIG, 0x1A, 0x00, 0x00, 0x02);
+static const Frame readEdge     = POLL_FRAME(POLL_RIG, 0x02);
+static const Frame setFreq40    = POLL_FRAME(POLL_RIG, 0x05, 0x00, 0x40, 0x07, 0x07, 0x00);
+static const Frame setModeLsb   = POLL_FRAME(POLL_RIG, 0x06, 0x00, 0x01);
+static const Frame setStack20   = POLL_FRAME(POLL_RIG, 0x1A, 0x01, 0x05, 0x01,
+                                             0x00, 0x40, 0x07, 0x14, 0x00, 0x01, 0x01);
+static const Frame setStack40   = POLL_FRAME(POLL_RIG, 0x1A, 0x01, 0x03, 0x01,
+                                             0x00, 0x40, 0x07, 0x07, 0x00, 0x00, 0x01);
+
+static inline std::vector<Mix> pollMixes() {
+  return {
+    {"hamlib", {readFreq, readMode, readPtt, readSmeter}},                    // rigctld, icom backend
+    {"wsjtx", {readFreq, readMode, readPtt, readFreq, readMode,               // through hamlib, one T/R cycle
+               setVfoB, setFreq, setVfoA, setFreq, setMode, pttOn, readPtt, pttOff}},
+    {"omnirig", {readFreq, readMode, readPtt, readFreq, readMode}},
+    {"flrig", {readFreq, readMode, readSmeter, readPower, readPtt, readId}},
+    {"tune", {setFreq, readFreq, setFreq, readFreq}},                         // a logger following the VFO
+    {"split", {readFreq, readMode, readSplit, setVfoB, readFreq, readMode,     // split polled through VFO B
+               setVfoA, readPtt, setVfoB, setFreq, setVfoA}},                 // ... and its TX frequency set
+    {"split25", {readFreq, readMode, readSplit, readTxFreq, readTxMode,        // the same with 25 / 26
+                 readPtt, setTxFreq}},
+    {"memory", {setFreq, readFreq, selMem1, writeMem, setMem2, readMem2}},    // a logger storing each QSO
+    {"band", {setFreq40, setModeLsb, readEdge, readFreq, readMode,             // band buttons - 40 m, 20 m
+              setFreq, setMode, readEdge, readFreq, readMode}},
+    {"bandstack", {setStack40, readEdge, readFreq, readMode,                   // the same, a 1A 01 write a band
+                   setStack20, readEdge, readFreq, readMode}},
+  };
+}
+
+// Opcode and data in hex, "1C 00 01"
+static inline void frameName(const Frame &f, char *s) {
+  for (int i = 2; i < f.len; i++) s += sprintf(s, i > 2 ? " %02X" : "%02X", f.data[i]);
+}
+
+#endif
@@ -0,0 +1,196 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   bcd_bench - BCD frequency codec benchmark
+
+   Times the division-free codec in CATBcd.cpp against the original V1.3
+   FreqtoBCD() / BCDtoFreq() code, and checks that both produce the same bytes.
+
+     bcd_bench [-n conversions] [-x]
+
+     -n  conversions per timing run (default 10000000)
+     -x  before timing, round-trip every frequency from 0 to 9,999,999,999 Hz
+         through the new codec and compare with the original over the long range
+         (takes a few minutes)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC
+#endif
+
+#include "CATBcd.h"
+
+//
+// V1.3 codec, verbatim apart from working on a caller supplied buffer
+//
+static long legacyBCDtoFreq(const byte *bcd) {
+  long freq;
+
+  freq = bcd[0] & 0xf;
+  freq += 10L * (bcd[0] >> 4);
+  freq += 100L * (bcd[1] & 0xf);
+  freq += 1000L * (bcd[1] >> 4);
+  freq += 10000L * (bcd[2] & 0xf);
+  freq += 100000L * (bcd[2] >> 4);
+  freq += 1000000L * (bcd[3] & 0xf);
+  freq += 10000000L * (bcd[3] >> 4);
+  freq += 100000000L * (bcd[4] & 0xf);
+  freq += 1000000000L * (bcd[4] >> 4);
+  return freq;
+}
+
+static void legacyFreqtoBCD(long freq, byte *bcd) {
+  byte ones, tens, hund, thou, ten_thou, hund_thou, mil, ten_mil, hund_mil, thou_mil;
+
+  ones =     byte(freq % 10);
+  tens =     byte((freq / 10L) % 10);
+  bcd[0] = byte((tens << 4)) | ones;
+  hund =      byte((freq / 100L) % 10);
+  thou =      byte((freq / 1000L) % 10);
+  bcd[1] = byte((thou << 4)) | hund;
+  ten_thou =  byte((freq / 10000L) % 10);
+  hund_thou = byte((freq / 100000L) % 10);
+  bcd[2] = byte((hund_thou << 4)) | ten_thou;
+  mil =       byte((freq / 1000000L) % 10);
+  ten_mil =   byte(freq  / 10000000L) % 10;
+  bcd[3] = byte((ten_mil << 4)) | mil;
+  hund_mil = byte((freq / 100000000L) % 10);
+  thou_mil = byte(freq  / 1000000000L % 10);
+  bcd[4] = byte((thou_mil << 4)) | hund_mil;
+}
+
+static double nowSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static unsigned long long cycles() {
+#ifdef HAVE_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+// The poll mix - a spread of HF/VHF frequencies, as a client would read them
+#define MIX_SIZE 1024
+static long mix[MIX_SIZE];
+static byte mixBcd[MIX_SIZE][CAT_FREQ_BYTES];
+static volatile unsigned long sink;   // keeps the optimizer from discarding results
+
+static void report(const char *name, long n, double secs, unsigned long long cyc) {
+  printf("%-22s %8.2f ns/conv  %8.2f Mconv/s", name, secs * 1e9 / n, n / secs / 1e6);
+#ifdef HAVE_TSC
+  printf("  %7.1f cycles/conv", (double)cyc / n);
+#else
+  (void)cyc;
+#endif
+  printf("\n");
+}
+
+static void benchEncode(const char *name, boolean legacy, long n) {
+  byte bcd[CAT_FREQ_BYTES];
+  double t0 = nowSeconds();
+  unsigned long long c0 = cycles();
+
+  for (long i = 0; i < n; i++) {
+    if (legacy) {
+      legacyFreqtoBCD(mix[i & (MIX_SIZE - 1)], bcd);
+    } else {
+      catFreqToBCD((unsigned long)mix[i & (MIX_SIZE - 1)], bcd, CAT_FREQ_BYTES);
+    }
+    sink += bcd[0];
+  }
+  report(name, n, nowSeconds() - t0, cycles() - c0);
+}
+
+static void benchDecode(const char *name, boolean legacy, long n) {
+  double t0 = nowSeconds();
+  unsigned long long c0 = cycles();
+
+  for (long i = 0; i < n; i++) {
+    if (legacy) {
+      sink += legacyBCDtoFreq(mixBcd[i & (MIX_SIZE - 1)]);
+    } else {
+      sink += (unsigned long)catBCDToFreq(mixBcd[i & (MIX_SIZE - 1)], CAT_FREQ_BYTES);
+    }
+  }
+  report(name, n, nowSeconds() - t0, cycles() - c0);
+}
+
+//
+// Round trip 0 .. 9,999,999,999 and compare with the original wherever a long can hold it
+//
+static boolean exhaustive() {
+  byte bcd[CAT_FREQ_BYTES], ref[CAT_FREQ_BYTES];
+  unsigned long long f;
+
+  for (f = 0; f <= 9999999999ULL; f++) {
+    catFreqToBCD(f, bcd, CAT_FREQ_BYTES);
+    if (catBCDToFreq(bcd, CAT_FREQ_BYTES) != f) {
+      printf("round trip failed at %llu\n", f);
+      return false;
+    }
+    if (f <= 2147483647ULL) {
+      legacyFreqtoBCD(long(f), ref);
+      if (memcmp(bcd, ref, CAT_FREQ_BYTES) != 0 || legacyBCDtoFreq(bcd) != long(f)) {
+        printf("differs from V1.3 codec at %llu\n", f);
+        return false;
+      }
+    }
+    if (f % 1000000000ULL == 0 && f) {
+      fprintf(stderr, "  %llu GHz checked\n", f / 1000000000ULL);
+    }
+  }
+  printf("round trip 0 .. 9999999999 ok\n");
+  return true;
+}
+
+int main(int argc, char **argv) {
+  long n = 10000000L;
+  boolean full = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      n = atol(argv[++i]);
+    } else if (strcmp(argv[i], "-x") == 0) {
+      full = true;
+    } else {
+      fprintf(stderr, "usage: %s [-n conversions] [-x]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  srand(746);
+  for (int i = 0; i < MIX_SIZE; i++) {
+    mix[i] = 1800000L + (long)(((unsigned long)rand() * 2654435761UL) % 146000000UL);
+    catFreqToBCD((unsigned long)mix[i], mixBcd[i], CAT_FREQ_BYTES);
+  }
+
+  if (full && !exhaustive()) return 1;
+
+  benchEncode("FreqtoBCD  V1.3", true, n);
+  benchEncode("catFreqToBCD", false, n);
+  benchDecode("BCDtoFreq  V1.3", true, n);
+  benchDecode("catBCDToFreq", false, n);
+  return 0;
+}
@@ -0,0 +1,290 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   cat_bench - protocol engine benchmark
+
+   Drives an IC746 engine and the emulated rig (EmuRig.h) through an in-memory
+   transport, one command at a time as a CAT program does, and times the whole
+   path - receiver, dispatch, handler, response queue - with the poll mixes of
+   common CAT programs and, optionally, the commands of a recorded session.
+
+     cat_bench [-n frames] [-s] [-r capture] [-j]
+
+     -n  frames per timing run (default 1000000)
+     -s  answer polls from the shadow registers instead of the handler
+     -r  add a mix made of the commands of a capture taken with ic746_pty -R
+     -j  print the results as JSON, for keeping release to release
+
+   For each mix: frames per second, ns per frame and heap allocations per frame
+   (every operator new / malloc made while the mix runs - the engine should make
+   none).  Then ns per frame for each distinct command of the mixes, timed on
+   its own.  The rig has memory channels in an EEPROM in RAM that writes at
+   once, so the memory mix times the engine's side of storing a channel.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***************************************************************************/
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <new>
+#include <vector>
+
+#include "IC746.h"
+#include "CATRecorder.h"
+#include "CATMemStorage.h"
+#include "EmuRig.h"
+#include "PollMixes.h"
+
+
+//
+// Allocation counting - malloc() is wrapped, operator new goes through it
+//
+static unsigned long allocs = 0;
+static boolean countMalloc = false;
+
+extern "C" void *malloc(size_t n) {
+  static void *(*real)(size_t) = (void *(*)(size_t))dlsym(RTLD_NEXT, "malloc");
+  if (countMalloc) allocs++;
+  return real(n);
+}
+
+void *operator new(size_t n) {
+  void *p;
+  if (!(p = malloc(n ? n : 1))) throw std::bad_alloc();
+  return p;
+}
+
+void *operator new[](size_t n) {
+  return operator new(n);
+}
+
+void operator delete(void *p) noexcept {
+  free(p);
+}
+
+void operator delete[](void *p) noexcept {
+  free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+  free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+  free(p);
+}
+
+//
+// BenchTransport - one command in, the response thrown away
+//
+class BenchTransport : public CATTransport {
+  public:
+    byte rx[POLL_FRAME_LENGTH + 3];
+    int rxHead = 0;
+    int rxCount = 0;
+    unsigned long txBytes = 0;
+
+    void begin(long baudrate, int mode) { (void)baudrate; (void)mode; }
+    int available() { return rxCount - rxHead; }
+    int read() { return rxHead < rxCount ? rx[rxHead++] : -1; }
+    void write(byte b) { (void)b; txBytes++; }
+    int availableForWrite() { return CAT_TX_BUF_LENGTH; }
+
+    void push(const Frame &f) {
+      rx[0] = rx[1] = CAT_PREAMBLE;
+      memcpy(&rx[2], f.data, f.len);
+      rx[f.len + 2] = CAT_EOM;
+      rxHead = 0;
+      rxCount = f.len + 3;
+    }
+};
+
+static EmuRig rig;
+static BenchTransport wire;
+#if CAT_FEATURE_MEMORY
+static CATMemStorage eeprom;
+static CATMemory memory(eeprom);
+#endif
+
+static unsigned long long nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+struct Result {
+  double ns;                  // per frame
+  double allocs;              // per frame
+};
+
+//
+// run() - n frames of the mix, each sent once the engine has answered the one before
+//
+static Result run(const std::vector<Frame> &frames, long n) {
+  Result r;
+  unsigned long a0;
+  unsigned long long t0;
+  size_t i = 0;
+
+  a0 = allocs;
+  countMalloc = true;
+  t0 = nowNs();
+  for (long k = 0; k < n; k++) {
+    wire.push(frames[i]);
+    if (++i == frames.size()) i = 0;
+    while (rig.radio.check() || rig.radio.txPending()) {}
+  }
+  r.ns = double(nowNs() - t0) / n;
+  countMalloc = false;
+  r.allocs = double(allocs - a0) / n;
+  return r;
+}
+
+static boolean sameFrame(const Frame &a, const Frame &b) {
+  return a.len == b.len && memcmp(a.data, b.data, a.len) == 0;
+}
+
+// The commands of a capture, as a mix
+static boolean loadCapture(const char *path, Mix &mix) {
+  char info[256];
+  CATRecord r;
+  Frame f;
+  FILE *in;
+
+  if (!(in = fopen(path, "rb"))) return false;
+  if (!catReadCaptureHeader(in, info, sizeof(info))) {
+    fclose(in);
+    return false;
+  }
+  f.len = 0;
+  while (catReadRecord(in, r)) {
+    if (r.dir != CAT_TRC_RX) continue;
+    for (int i = 0; i < r.len; i++) {
+      byte b = r.data[i];
+      if (b == CAT_PREAMBLE) {
+        f.len = 0;
+      } else if (b == CAT_EOM) {
+        if (f.len >= 3) mix.frames.push_back(f);
+        f.len = 0;
+      } else if (f.len < POLL_FRAME_LENGTH) {
+        f.data[f.len++] = b;
+      }
+    }
+  }
+  fclose(in);
+  mix.name = "capture";
+  return !mix.frames.empty();
+}
+
+int main(int argc, char **argv) {
+  long n = 1000000;
+  boolean shadow = false;
+  boolean json = false;
+  std::vector<Mix> mixes = pollMixes();
+  std::vector<Frame> singles;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      n = atol(argv[++i]);
+      if (n < 1) n = 1;
+    } else if (strcmp(argv[i], "-s") == 0) {
+      shadow = true;
+    } else if (strcmp(argv[i], "-j") == 0) {
+      json = true;
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      Mix m;
+      if (!loadCapture(argv[++i], m)) {
+        fprintf(stderr, "%s: no commands in capture\n", argv[i]);
+        return 1;
+      }
+      mixes.push_back(m);
+    } else {
+      fprintf(stderr, "usage: %s [-n frames] [-s] [-r capture] [-j]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  rig.verbose = false;
+  rig.setup(shadow, false, 0);
+#if CAT_FEATURE_MEMORY
+  rig.radio.setMemory(memory);
+#endif
+  rig.radio.begin(wire);
+
+  // every distinct command of the mixes, to time on its own
+  for (const Mix &m : mixes) {
+    for (const Frame &f : m.frames) {
+      boolean seen = false;
+      for (const Frame &s : singles) seen |= sameFrame(s, f);
+      if (!seen) singles.push_back(f);
+    }
+  }
+
+  std::vector<Result> mixResults, singleResults;
+  for (const Mix &m : mixes) {
+    run(m.frames, n / 10 + 1);            // warm up
+    mixResults.push_back(run(m.frames, n));
+  }
+  for (const Frame &f : singles) {
+    std::vector<Frame> one(1, f);
+    run(one, n / 10 + 1);
+    singleResults.push_back(run(one, n));
+  }
+
+  if (json) {
+    printf("{\n  \"benchmark\": \"cat_bench\",\n  \"frames\": %ld,\n  \"shadow\": %s,\n", n, shadow ? "true" : "false");
+    // every CAT_FEATURE_ of IC746Config.h, in its order
+    printf("  \"features\": {\"stubs\": %d, \"dual_vfo\": %d, \"shadow\": %d, \"transceive\": %d, "
+           "\"coalesce\": %d, \"ptt_priority\": %d, \"async\": %d, \"memory\": %d, \"bandstack\": %d, "
+           "\"response_cache\": %d, \"trace\": %d, \"metrics\": %d, \"autobaud\": %d},\n",
+           CAT_FEATURE_STUBS, CAT_FEATURE_DUAL_VFO, CAT_FEATURE_SHADOW, CAT_FEATURE_TRANSCEIVE,
+           CAT_FEATURE_COALESCE, CAT_FEATURE_PTT_PRIORITY, CAT_FEATURE_ASYNC, CAT_FEATURE_MEMORY,
+           CAT_FEATURE_BANDSTACK, CAT_FEATURE_RESPONSE_CACHE, CAT_FEATURE_TRACE, CAT_FEATURE_METRICS,
+           CAT_FEATURE_AUTOBAUD);
+    printf("  \"mixes\": [\n");
+    for (size_t i = 0; i < mixes.size(); i++) {
+      printf("    {\"name\": \"%s\", \"frames_per_sec\": %.0f, \"ns_per_frame\": %.1f, \"allocs_per_frame\": %.3f}%s\n",
+             mixes[i].name, 1e9 / mixResults[i].ns, mixResults[i].ns, mixResults[i].allocs,
+             i + 1 < mixes.size() ? "," : "");
+    }
+    printf("  ],\n  \"commands\": [\n");
+    for (size_t i = 0; i < singles.size(); i++) {
+      char name[3 * POLL_FRAME_LENGTH];
+      frameName(singles[i], name);
+      printf("    {\"command\": \"%s\", \"length\": %d, \"ns_per_frame\": %.1f, \"allocs_per_frame\": %.3f}%s\n",
+             name, singles[i].len, singleResults[i].ns, singleResults[i].allocs,
+             i + 1 < singles.size() ? "," : "");
+    }
+    printf("  ]\n}\n");
+    return 0;
+  }
+
+  printf("%ld frames per run%s\n\n", n, shadow ? ", shadow registers" : "");
+  printf("%-10s %12s %10s %8s\n", "mix", "frames/s", "ns/frame", "allocs");
+  for (size_t i = 0; i < mixes.size(); i++) {
+    printf("%-10s %12.0f %10.1f %8.3f\n", mixes[i].name, 1e9 / mixResults[i].ns, mixResults[i].ns,
+           mixResults[i].allocs);
+  }
+  printf("\n%-20s %12s %10s %8s\n", "command", "frames/s", "ns/frame", "allocs");
+  for (size_t i = 0; i < singles.size(); i++) {
+    char name[3 * POLL_FRAME_LENGTH];
+    frameName(singles[i], name);
+    printf("%-20s %12.0f %10.1f %8.3f\n", name, 1e9 / singleResults[i].ns, singleResults[i].ns,
+           singleResults[i].allocs);
+  }
+  return 0;
+}
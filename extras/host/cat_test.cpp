@@ -0,0 +1,1679 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   cat_test - checks of the protocol engine on the host
+
+   Each test sends CI-V commands to a fresh engine and emulated rig (EmuRig.h)
+   through an in-memory transport and checks what the rig was told and what
+   was sent back.  The engine is built as for the sketch, so the types are the
+   ones an ATmega sees - a frequency is as wide here as there.  Build it with
+   -DCAT_FEATURE_METRICS=1 for the checks of the metrics, and again with
+   -DCAT_FREQ_BITS=32 for the checks of the narrow frequencies.
+
+     cat_test [-v]
+
+     -v  print every check, not only the ones that fail
+
+   Exits with 1 if any check fails.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***************************************************************************/
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "IC746.h"
+#include "CATMemStorage.h"
+#include "EmuRig.h"
+
+static boolean printAll = false;
+static int checks = 0;
+static int failed = 0;
+
+#define CHECK(c) check((c), #c, __LINE__)
+
+static void check(boolean ok, const char *what, int line) {
+  checks++;
+  if (!ok) failed++;
+  if (!ok || printAll) printf("  %s line %d: %s\n", ok ? "ok  " : "FAIL", line, what);
+}
+
+// The tests' own clock, us - a timeout takes exactly as long as a test says
+static unsigned long long testNow = 0;
+static unsigned long long testClock() { return testNow; }
+
+static void advanceMs(unsigned long ms) {
+  testNow += ms * 1000ULL;
+}
+
+// The test clock for the life of the object - make it before the rig, begin() reads the clock
+class TestTime {
+  public:
+    TestTime() { hostSetClock(testClock); }
+    ~TestTime() { hostSetClock(NULL); }
+};
+
+//
+// TestTransport - the commands pushed in, everything sent kept
+//
+class TestTransport : public CATTransport {
+  public:
+    std::vector<byte> rx;
+    size_t rxHead = 0;
+    std::vector<byte> tx;
+    int room = CAT_TX_BUF_LENGTH;    // bytes taken at a time - 0 for a line that has stopped
+    long baud = 0;                   // the rate of the last begin()
+    int runs = 0;                    // writeBytes() calls
+
+    void begin(long baudrate, int mode) { baud = baudrate; (void)mode; }
+    int available() { return int(rx.size() - rxHead); }
+    int read() { return rxHead < rx.size() ? rx[rxHead++] : -1; }
+    void write(byte b) { tx.push_back(b); }
+    void writeBytes(const byte *buf, int len) { tx.insert(tx.end(), buf, buf + len); runs++; }
+    int availableForWrite() { return room; }
+};
+
+// A frame, preamble to EOM, added to v
+static void addFrame(std::vector<byte> &v, byte to, byte from, std::initializer_list<byte> body) {
+  v.insert(v.end(), {CAT_PREAMBLE, CAT_PREAMBLE, to, from});
+  v.insert(v.end(), body);
+  v.push_back(CAT_EOM);
+}
+
+//
+// TestRig - the emulated rig on a test transport, USB link so there is no echo to skip
+//
+class TestRig : public EmuRig {
+  public:
+    TestTransport wire;
+    std::string calls;           // F for each setFreq(), M for each setMode(), T / R for each setPtt()
+
+    TestRig(boolean shadow = false) {
+      verbose = false;
+      setup(shadow, false, 0);
+      radio.begin(wire, CAT_LINK_USB);
+    }
+
+    void setPtt(boolean tx) {
+      calls += tx ? 'T' : 'R';
+      EmuRig::setPtt(tx);
+    }
+
+    void setFreq(CATFreq f) {
+      calls += 'F';
+      EmuRig::setFreq(f);
+    }
+
+    void setMode(byte m) {
+      calls += 'M';
+      EmuRig::setMode(m);
+    }
+
+    // a command from the controller, left waiting for check()
+    void queue(std::initializer_list<byte> body) {
+      wire.rx.push_back(CAT_PREAMBLE);
+      wire.rx.push_back(CAT_PREAMBLE);
+      wire.rx.push_back(CAT_RIG_ADDR);
+      wire.rx.push_back(CAT_CTRL_ADDR);
+      wire.rx.insert(wire.rx.end(), body);
+      wire.rx.push_back(CAT_EOM);
+    }
+
+    // bytes from the controller as they are, frame or not
+    void feed(std::initializer_list<byte> bytes) {
+      wire.rx.insert(wire.rx.end(), bytes);
+    }
+
+    // one command from the controller, answered
+    void command(std::initializer_list<byte> body) {
+      queue(body);
+      radio.check();
+    }
+
+    // the bytes sent since the last call are these
+    boolean took(const std::vector<byte> &want) {
+      boolean ok = wire.tx == want;
+      wire.tx.clear();
+      return ok;
+    }
+
+    // ... are n frames to the controller with this body - one if n is left out
+    boolean sent(std::initializer_list<byte> body, int n = 1) {
+      std::vector<byte> want;
+      for (int i = 0; i < n; i++) addFrame(want, CAT_CTRL_ADDR, CAT_RIG_ADDR, body);
+      return took(want);
+    }
+
+    // ... are n ACKs or NACKs, which go out with the addresses of the command, as V1.3 sent them
+    boolean replied(byte code, int n) {
+      std::vector<byte> want;
+      for (int i = 0; i < n; i++) addFrame(want, CAT_RIG_ADDR, CAT_CTRL_ADDR, {code});
+      return took(want);
+    }
+
+    // ... is one transceive broadcast with this body
+    boolean broadcast(std::initializer_list<byte> body) {
+      std::vector<byte> want;
+      addFrame(want, CAT_BCAST_ADDR, CAT_RIG_ADDR, body);
+      return took(want);
+    }
+
+    boolean acked(int n = 1) { return replied(CAT_ACK, n); }
+    boolean nacked() { return replied(CAT_NACK, 1); }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Frequencies - 2.147 GHz and up must not wrap, nor anything be clamped
+////////////////////////////////////////////////////////////////////////////////
+
+static_assert(sizeof(CATFreq) * 8 == CAT_FREQ_BITS && CATFreq(-1) > 0, "CATFreq is not unsigned CAT_FREQ_BITS");
+
+static void testFreqAboveLong() {
+  TestRig rig;
+
+  // 2.4 GHz, negative as an int32_t - the V1.3 long
+  rig.command({0x05, 0x00, 0x00, 0x00, 0x00, 0x24});
+  CHECK(rig.acked());
+  CHECK(rig.freqA == 2400000000UL);
+  CHECK(int32_t(rig.freqA) < 0);
+  CHECK(rig.radio.vfoFreq(CAT_VFO_A) == 2400000000UL);
+
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x00, 0x00, 0x00, 0x00, 0x24}));
+}
+
+#if CAT_FEATURE_DUAL_VFO
+static void testVfoFreqAboveLong() {
+  TestRig rig;
+
+  // 3.4 GHz into the unselected VFO, and read back
+  rig.command({0x25, 0x01, 0x00, 0x00, 0x00, 0x00, 0x34});
+  CHECK(rig.acked());
+  CHECK(rig.freqB == 3400000000UL);
+  rig.command({0x25, 0x01});
+  CHECK(rig.sent({0x25, 0x01, 0x00, 0x00, 0x00, 0x00, 0x34}));
+}
+#endif
+
+static void testShadowFreqAboveLong() {
+  TestRig rig(true);
+
+  rig.radio.updateFreq(CATFreq(INT32_MAX) + 1);
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x48, 0x36, 0x48, 0x47, 0x21}));
+}
+
+#if CAT_FREQ_BITS == 64
+static void testFreq10GHz() {
+  TestRig rig;
+
+  // 5.76 GHz and 9.999999999 GHz, the top of the 10 digit field, set and read back whole -
+  // 10.368 GHz would need the 6 byte field of newer rigs
+  rig.command({0x05, 0x00, 0x00, 0x00, 0x60, 0x57});
+  CHECK(rig.acked());
+  CHECK(rig.freqA == 5760000000ULL);
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x00, 0x00, 0x00, 0x60, 0x57}));
+
+  rig.command({0x05, 0x99, 0x99, 0x99, 0x99, 0x99});
+  CHECK(rig.acked());
+  CHECK(rig.freqA == 9999999999ULL);
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x99, 0x99, 0x99, 0x99, 0x99}));
+
+#if CAT_FEATURE_DUAL_VFO
+  rig.command({0x25, 0x01, 0x00, 0x00, 0x80, 0x36, 0x90});
+  CHECK(rig.acked());
+  CHECK(rig.freqB == 9036800000ULL);
+  rig.command({0x25, 0x01});
+  CHECK(rig.sent({0x25, 0x01, 0x00, 0x00, 0x80, 0x36, 0x90}));
+#endif
+
+#if CAT_FEATURE_BANDSTACK
+  // 4.308074 GHz is 14.074 MHz in the low 32 bits - not on 20 m
+  rig.command({0x05, 0x00, 0x40, 0x07, 0x08, 0x43});
+  CHECK(rig.acked());
+  CHECK(rig.radio.band() == CAT_BAND_NONE);
+  rig.command({0x02});
+  CHECK(rig.nacked());
+#endif
+}
+#else
+static void testFreqTooHigh() {
+  TestRig rig;
+
+  // 5.76 GHz does not fit 32 bits - NACKed, and the rig keeps its frequency
+  rig.command({0x05, 0x00, 0x00, 0x00, 0x60, 0x57});
+  CHECK(rig.nacked());
+  CHECK(rig.freqA == 7074000UL);
+  rig.command({0x25, 0x01, 0x00, 0x00, 0x00, 0x60, 0x57});
+  CHECK(rig.nacked());
+  CHECK(rig.freqB == 14074000UL);
+}
+#endif
+
+static void testFreqBadDigits() {
+  TestRig rig;
+
+  // a nibble above 9 in the GHz digit - refused rather than read as 15 GHz or clamped
+  rig.command({0x05, 0x00, 0x00, 0x00, 0x00, 0xF0});
+  CHECK(rig.nacked());
+  CHECK(rig.freqA == 7074000UL);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Receiver - a broken frame is dropped and the next one still answered
+////////////////////////////////////////////////////////////////////////////////
+
+static void testRxPreambleMidFrame() {
+  TestRig rig;
+
+  // a set frequency that loses its end, run into by a read - the read starts a new frame, and
+  // is not taken for data of the set
+  rig.feed({CAT_PREAMBLE, CAT_PREAMBLE, CAT_RIG_ADDR, CAT_CTRL_ADDR, 0x05, 0x00, 0x40});
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x07, 0x00}));
+  CHECK(rig.freqA == 7074000UL);
+#if CAT_FEATURE_METRICS
+  CHECK(rig.radio.metrics().rxErrors == 1);
+#endif
+}
+
+static void testRxJam() {
+  TestRig rig;
+
+  // a jam code voids the frame in progress - the rest of it is noise to a receiver waiting
+  // for a preamble
+  rig.feed({CAT_PREAMBLE, CAT_PREAMBLE, CAT_RIG_ADDR, CAT_CTRL_ADDR, 0x05, 0x00, 0x40, CAT_JAM,
+            0x07, 0x14, 0x00, CAT_EOM});
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x07, 0x00}));
+  CHECK(rig.freqA == 7074000UL);
+
+  // ... and between frames does nothing
+  rig.feed({CAT_JAM});
+  rig.command({0x05, 0x00, 0x40, 0x07, 0x14, 0x00});
+  CHECK(rig.acked());
+  CHECK(rig.freqA == 14074000UL);
+#if CAT_FEATURE_METRICS
+  CHECK(rig.radio.metrics().rxErrors == 1);
+#endif
+}
+
+#if CAT_RX_BYTE_TIMEOUT
+static void testRxStall() {
+  TestTime time;
+  TestRig rig;
+
+  // a frame that stops for longer than CAT_RX_BYTE_TIMEOUT is dropped; its tail, when it comes,
+  // is noise
+  rig.feed({CAT_PREAMBLE, CAT_PREAMBLE, CAT_RIG_ADDR, CAT_CTRL_ADDR, 0x05, 0x00, 0x40});
+  rig.radio.check();
+  rig.radio.check();
+  advanceMs(CAT_RX_BYTE_TIMEOUT);
+  rig.radio.check();
+  rig.feed({0x07, 0x14, 0x00, CAT_EOM});
+  rig.radio.check();
+  CHECK(rig.wire.tx.empty());
+  CHECK(rig.freqA == 7074000UL);
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x07, 0x00}));
+
+  // one that only slows down is kept
+  rig.feed({CAT_PREAMBLE, CAT_PREAMBLE, CAT_RIG_ADDR, CAT_CTRL_ADDR, 0x05, 0x00, 0x40});
+  rig.radio.check();
+  rig.radio.check();
+  advanceMs(CAT_RX_BYTE_TIMEOUT - 1);
+  rig.radio.check();
+  rig.feed({0x07, 0x14, 0x00, CAT_EOM});
+  rig.radio.check();
+  CHECK(rig.acked());
+  CHECK(rig.freqA == 14074000UL);
+}
+#endif
+
+static void testRxQueueFull() {
+  TestRig rig;
+
+  // with the receiver fed from an "interrupt" and no check() in between, the queue takes
+  // CAT_RX_QUEUE_LENGTH commands and drops the next one - not one more, not one less
+  rig.radio.useExternalRx(true);
+  for (int i = 0; i < CAT_RX_QUEUE_LENGTH + 1; i++) {
+    rig.queue({0x03});
+  }
+  while (rig.wire.available()) rig.radio.receive(byte(rig.wire.read()));
+  CHECK(rig.radio.rxDropped() == 1);
+  CHECK(rig.radio.check() == 0);
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x07, 0x00}, CAT_RX_QUEUE_LENGTH));
+#if CAT_FEATURE_METRICS
+  CHECK(rig.radio.metrics().rxOverruns == 1);
+#endif
+
+  // room again
+  rig.queue({0x03});
+  while (rig.wire.available()) rig.radio.receive(byte(rig.wire.read()));
+  rig.radio.check();
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x07, 0x00}));
+  CHECK(rig.radio.rxDropped() == 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Link profiles - echo, framing NACKs and addressing
+////////////////////////////////////////////////////////////////////////////////
+
+// A frame with one preamble byte, and one that overflows the command buffer - both framing errors
+static void badFrames(TestRig &rig) {
+  rig.feed({CAT_PREAMBLE, CAT_RIG_ADDR, CAT_CTRL_ADDR, 0x03, CAT_EOM});
+  rig.feed({CAT_PREAMBLE, CAT_PREAMBLE, CAT_RIG_ADDR, CAT_CTRL_ADDR});
+  rig.wire.rx.insert(rig.wire.rx.end(), CAT_CMD_BUF_LENGTH, 0x00);
+  rig.feed({CAT_EOM});
+  rig.radio.check();
+}
+
+static void testLinkCiv() {
+  TestRig rig;
+  std::vector<byte> want;
+
+  rig.radio.begin(rig.wire, CAT_LINK_CIV);
+
+  // every command echoed ahead of its answer
+  rig.command({0x03});
+  addFrame(want, CAT_RIG_ADDR, CAT_CTRL_ADDR, {0x03});
+  addFrame(want, CAT_CTRL_ADDR, CAT_RIG_ADDR, {0x03, 0x00, 0x40, 0x07, 0x07, 0x00});
+  CHECK(rig.took(want));
+
+  // what else the bus carries is dropped - the rig's own answer coming back, another rig's
+  // command, a broadcast
+  rig.wire.rx.insert(rig.wire.rx.end(), want.begin() + want.size() / 2, want.end());
+  addFrame(rig.wire.rx, 0x58, CAT_CTRL_ADDR, {0x03});
+  addFrame(rig.wire.rx, CAT_BCAST_ADDR, CAT_RIG_ADDR, {0x00, 0x00, 0x40, 0x07, 0x07, 0x00});
+  CHECK(rig.radio.check() == 0);
+  CHECK(rig.wire.tx.empty());
+
+  // framing errors are NACKed
+  badFrames(rig);
+  CHECK(rig.replied(CAT_NACK, 2));
+#if CAT_FEATURE_METRICS
+  CHECK(rig.radio.metrics().rxErrors == 2);
+  CHECK(rig.radio.metrics().rejects == 0);
+#endif
+}
+
+static void testLinkUsb() {
+  TestRig rig;
+
+  // no echo, nothing for framing errors, and any address answered
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x07, 0x00}));
+  badFrames(rig);
+  CHECK(rig.wire.tx.empty());
+  addFrame(rig.wire.rx, 0x58, CAT_CTRL_ADDR, {0x03});
+  rig.radio.check();
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x07, 0x00}));
+#if CAT_FEATURE_METRICS
+  CHECK(rig.radio.metrics().rxErrors == 2);
+#endif
+}
+
+static void testLinkHamlib() {
+  TestRig rig;
+  std::vector<byte> want;
+
+  rig.radio.begin(rig.wire, CAT_LINK_HAMLIB);
+
+  // the echo, but no NACK for a framing error - hamlib would take it for its next answer
+  badFrames(rig);
+  CHECK(rig.wire.tx.empty());
+  addFrame(rig.wire.rx, 0x58, CAT_CTRL_ADDR, {0x03});
+  rig.radio.check();
+  addFrame(want, 0x58, CAT_CTRL_ADDR, {0x03});
+  addFrame(want, CAT_CTRL_ADDR, CAT_RIG_ADDR, {0x03, 0x00, 0x40, 0x07, 0x07, 0x00});
+  CHECK(rig.took(want));
+#if CAT_FEATURE_METRICS
+  CHECK(rig.radio.metrics().rxErrors == 2);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Transmit queue - whole frames or nothing, around the end of the ring
+////////////////////////////////////////////////////////////////////////////////
+
+static void testTxRingFull() {
+  TestRig rig;
+  byte id[] = {CAT_RIG_ADDR, CAT_CTRL_ADDR, CAT_READ_ID, 0x00, CAT_RIG_ADDR};
+  const int idFrame = sizeof(id) + CAT_FRAME_OVERHEAD;
+  const int fit = CAT_TX_BUF_LENGTH / idFrame;
+  std::vector<byte> want;
+
+  // a stopped line - the frame that does not fit is dropped whole
+  rig.wire.room = 0;
+  for (int i = 0; i <= fit; i++) rig.radio.sendResponse(id, sizeof(id));
+  CHECK(rig.radio.txPending() == fit * idFrame);
+  CHECK(rig.radio.txDropped() == 1);
+#if CAT_FEATURE_METRICS
+  CHECK(rig.radio.metrics().txDrops == 1);
+#endif
+
+  // a command waits until there is room for its answer - read, for a PTT set among them, or left
+  // in the transport
+  rig.queue({0x03});
+#if CAT_FEATURE_PTT_PRIORITY
+  CHECK(rig.radio.check() == 1);
+#else
+  CHECK(rig.radio.check() == 0);
+  CHECK(rig.wire.rxHead == 0);
+#endif
+  CHECK(rig.wire.tx.empty());
+
+  // the line moves again - the frames that fitted, then the answer, which runs past the end of
+  // the ring
+  rig.wire.room = CAT_TX_BUF_LENGTH;
+  rig.radio.check();
+  for (int i = 0; i < fit; i++) addFrame(want, CAT_CTRL_ADDR, CAT_RIG_ADDR, {CAT_READ_ID, 0x00, CAT_RIG_ADDR});
+  addFrame(want, CAT_CTRL_ADDR, CAT_RIG_ADDR, {0x03, 0x00, 0x40, 0x07, 0x07, 0x00});
+  CHECK(fit * idFrame + 11 > CAT_TX_BUF_LENGTH);
+  CHECK(rig.took(want));
+  CHECK(rig.radio.txPending() == 0);
+
+  // and a full ring again, from there
+  rig.wire.room = 0;
+  for (int i = 0; i <= fit; i++) rig.radio.sendResponse(id, sizeof(id));
+  CHECK(rig.radio.txDropped() == 2);
+  rig.wire.room = CAT_TX_BUF_LENGTH;
+  rig.wire.runs = 0;
+  rig.radio.check();
+  CHECK(rig.wire.runs == 2);             // one run each side of the wrap point
+  want.clear();
+  for (int i = 0; i < fit; i++) addFrame(want, CAT_CTRL_ADDR, CAT_RIG_ADDR, {CAT_READ_ID, 0x00, CAT_RIG_ADDR});
+  CHECK(rig.took(want));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// check() budget - commands past it stay queued for the next call
+////////////////////////////////////////////////////////////////////////////////
+
+// A rig whose frequency read takes 1 ms, as over I2C
+class SlowReadRig : public TestRig {
+  public:
+    boolean getFreq(CATFreq &f) {
+      advanceMs(1);
+      return TestRig::getFreq(f);
+    }
+};
+
+static void testCheckBudget() {
+  TestTime time;
+  SlowReadRig rig;
+
+  // by commands
+  for (int i = 0; i < 3; i++) rig.queue({0x03});
+  CHECK(rig.radio.check(1) == 2);
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x07, 0x00}));
+  CHECK(rig.radio.check(1) == 1);
+  CHECK(rig.radio.check() == 0);
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x07, 0x00}, 2));
+
+  // by time - the command that crosses the limit is finished, the next one waits
+  for (int i = 0; i < 3; i++) rig.queue({0x03});
+  CHECK(rig.radio.check(0, 1500) == 1);
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x07, 0x00}, 2));
+  CHECK(rig.radio.check(0, 1500) == 0);
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x07, 0x00}));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Automatic baud rate - the garbage a UART at the wrong rate makes of the commands
+////////////////////////////////////////////////////////////////////////////////
+
+#if CAT_FEATURE_AUTOBAUD
+// The rig on CAT_BAUD_AUTO, after a quiet line - the next byte is the one the rate is guessed from
+static void autoBaud(TestRig &rig, byte profile) {
+  rig.radio.begin(rig.wire, CAT_BAUD_AUTO, 0, profile);
+  advanceMs(20);
+  rig.radio.check();
+}
+
+static void testAutoBaudGuess() {
+  TestTime time;
+  TestRig rig;
+
+  // FE from a controller at a third of our rate reads as E0 - straight to 38400
+  autoBaud(rig, CAT_LINK_USB);
+  CHECK(rig.wire.baud == 115200);
+  rig.feed({0xE0, 0x00, 0xE0, 0x00, 0x80});
+  rig.radio.check();
+  rig.radio.check();
+  CHECK(rig.radio.baudRate() == 38400);
+  CHECK(rig.wire.baud == 38400);
+  CHECK(!rig.radio.baudLocked());
+
+  // the first good command locks it
+  advanceMs(20);
+  rig.radio.check();
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x07, 0x00}));
+  rig.radio.check();
+  CHECK(rig.radio.baudLocked());
+}
+
+static void testAutoBaudRescan() {
+  TestTime time;
+  TestRig rig;
+
+  // noise that tells nothing of the rate - the next rate after CAT_AUTOBAUD_ERRORS bad bytes
+  autoBaud(rig, CAT_LINK_USB);
+  for (int i = 0; i < CAT_AUTOBAUD_ERRORS - 1; i++) rig.feed({0x12});
+  rig.radio.check();
+  rig.radio.check();
+  CHECK(rig.radio.baudRate() == 115200);
+  rig.feed({0x12});
+  rig.radio.check();
+  rig.radio.check();
+  CHECK(rig.radio.baudRate() == 57600);
+
+  // locked, and the controller changes its rate - broken preambles start the search again
+  advanceMs(20);
+  rig.radio.check();
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x07, 0x00}));
+  rig.radio.check();
+  CHECK(rig.radio.baudLocked());
+  for (int i = 0; i < CAT_AUTOBAUD_ERRORS; i++) rig.feed({CAT_PREAMBLE, 0x12});
+  rig.radio.check();
+  rig.radio.check();
+  CHECK(!rig.radio.baudLocked());
+  CHECK(rig.radio.baudRate() == 115200);
+}
+
+#if CAT_FEATURE_METRICS
+static void testAutoBaudCountsErrors() {
+  TestTime time;
+  TestRig rig;
+
+  // while searching, broken preambles are not NACKed - but they are framing errors all the same
+  autoBaud(rig, CAT_LINK_CIV);
+  rig.feed({CAT_PREAMBLE, 0x12, CAT_PREAMBLE, 0x12, CAT_PREAMBLE, 0x12});
+  rig.radio.check();
+  rig.radio.check();
+  CHECK(rig.wire.tx.empty());
+  CHECK(rig.radio.metrics().rxErrors == 3);
+}
+#endif
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Transceive broadcasts
+////////////////////////////////////////////////////////////////////////////////
+
+#if CAT_FEATURE_TRANSCEIVE
+static void testTcvRateLimit() {
+  TestTime time;
+  TestRig rig(true);
+  std::vector<byte> both;
+
+  // the state at once when turned on, then at most one broadcast an interval, with the latest
+  // value
+  rig.radio.setTransceive(true, 100);
+  rig.radio.check();
+  addFrame(both, CAT_BCAST_ADDR, CAT_RIG_ADDR, {0x00, 0x00, 0x40, 0x07, 0x07, 0x00});
+  addFrame(both, CAT_BCAST_ADDR, CAT_RIG_ADDR, {0x01, CAT_MODE_USB, CAT_MODE_FILTER1});
+  CHECK(rig.took(both));
+
+  rig.panelFreq(7075000UL);
+  advanceMs(50);
+  rig.radio.check();
+  rig.panelFreq(7076000UL);
+  rig.radio.check();
+  CHECK(rig.wire.tx.empty());
+  advanceMs(50);
+  rig.radio.check();
+  CHECK(rig.broadcast({0x00, 0x00, 0x60, 0x07, 0x07, 0x00}));
+  advanceMs(500);
+  rig.radio.check();
+  CHECK(rig.wire.tx.empty());        // nothing changed
+
+  // changes made over CAT are not broadcast - the controller made them
+  rig.command({0x05, 0x00, 0x40, 0x07, 0x14, 0x00});
+  CHECK(rig.acked());
+  advanceMs(500);
+  rig.radio.check();
+  CHECK(rig.wire.tx.empty());
+}
+
+static void testTcvQueueFull() {
+  const int tcvFrame = 11;           // FE FE 00 56 00 ff ff ff ff ff FD
+  TestTime time;
+  TestRig rig(true);
+
+  // the line stops and the transmit queue fills with broadcasts, one an interval
+  rig.wire.room = 0;
+  rig.radio.setTransceive(true, 100);
+  rig.radio.check();
+  for (CATFreq f = 7075000UL; rig.radio.txFree() >= tcvFrame; f += 1000) {
+    rig.panelFreq(f);
+    advanceMs(100);
+    rig.radio.check();
+  }
+
+  // a change now has no room - it waits rather than being dropped, and is not held back a whole
+  // interval once there is room
+  rig.panelFreq(7100000UL);
+  advanceMs(100);
+  rig.radio.check();
+  CHECK(rig.wire.tx.empty());
+  advanceMs(10);
+  rig.wire.room = CAT_TX_BUF_LENGTH;
+  rig.radio.check();
+  CHECK(rig.wire.tx.size() > tcvFrame);
+  std::vector<byte> last(rig.wire.tx.end() - (tcvFrame), rig.wire.tx.end());
+  rig.wire.tx = last;
+  CHECK(rig.broadcast({0x00, 0x00, 0x00, 0x10, 0x07, 0x00}));
+  CHECK(rig.radio.txDropped() == 0);
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// VFOs and split
+////////////////////////////////////////////////////////////////////////////////
+
+static void testSplitRead() {
+  TestRig rig;
+
+  rig.command({0x0F});
+  CHECK(rig.sent({0x0F, CAT_SPLIT_OFF}));
+  rig.command({0x0F, CAT_SPLIT_ON});
+  CHECK(rig.acked());
+  CHECK(rig.split);
+  rig.command({0x0F});
+  CHECK(rig.sent({0x0F, CAT_SPLIT_ON}));
+  rig.command({0x0F, CAT_SPLIT_OFF});
+  CHECK(rig.acked());
+  rig.command({0x0F});
+  CHECK(rig.sent({0x0F, CAT_SPLIT_OFF}));
+
+  // split turned on at the rig, pushed to the shadow registers
+  TestRig shadowed(true);
+  shadowed.radio.updateSplit(true);
+  shadowed.command({0x0F});
+  CHECK(shadowed.sent({0x0F, CAT_SPLIT_ON}));
+}
+
+#if CAT_FEATURE_DUAL_VFO
+// A rig without setVfoFreq() / setVfoMode() - the library selects the other VFO, sets it and
+// selects back.  A / B logged for each setVfo()
+class FallbackRig : public TestRig {
+  public:
+    void setVfo(byte v) {
+      calls += v == CAT_VFO_A ? 'A' : 'B';
+      TestRig::setVfo(v);
+    }
+
+    boolean setVfoFreq(byte, CATFreq) { return false; }
+    boolean setVfoMode(byte, byte) { return false; }
+};
+
+static void testVfoFallback() {
+  FallbackRig rig;
+
+  rig.command({0x25, 0x01, 0x00, 0x00, 0x20, 0x14, 0x00});
+  CHECK(rig.acked());
+  CHECK(rig.calls == "BFA");
+  CHECK(rig.freqB == 14200000UL && rig.freqA == 7074000UL);
+  CHECK(rig.activeVFO == CAT_VFO_A);
+
+  rig.calls.clear();
+  rig.command({0x26, 0x01, CAT_MODE_CW, 0x00, CAT_MODE_FILTER1});
+  CHECK(rig.acked());
+  CHECK(rig.calls == "BMA");
+  CHECK(rig.modeOther == CAT_MODE_CW && rig.mode == CAT_MODE_USB);
+
+  // the VFO left by a select is read back the same way, when it is asked for
+  rig.command({0x07, CAT_VFO_B});
+  CHECK(rig.acked());
+  rig.freqA = 7040000UL;
+  rig.calls.clear();
+  rig.command({0x25, 0x01});
+  CHECK(rig.sent({0x25, 0x01, 0x00, 0x00, 0x04, 0x07, 0x00}));
+  CHECK(rig.calls == "AB");
+  rig.command({0x25, 0x01});
+  CHECK(rig.sent({0x25, 0x01, 0x00, 0x00, 0x04, 0x07, 0x00}));
+  CHECK(rig.calls == "AB");
+}
+#else
+static void testVfoNone() {
+  TestRig rig;
+
+  // no 25 / 26 - NACKed, and the controller selects, polls and selects back instead
+  rig.command({0x25, 0x01});
+  CHECK(rig.nacked());
+  rig.command({0x26, 0x01, CAT_MODE_CW, 0x00, CAT_MODE_FILTER1});
+  CHECK(rig.nacked());
+  CHECK(rig.modeOther == CAT_MODE_USB);
+
+  rig.command({0x07, CAT_VFO_B});
+  CHECK(rig.acked());
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x14, 0x00}));
+  rig.command({0x07, CAT_VFO_A});
+  CHECK(rig.acked());
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x07, 0x00}));
+  CHECK(rig.calls.empty());
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Command table - lengths checked before dispatch, commands added by the sketch
+////////////////////////////////////////////////////////////////////////////////
+
+static void testTableLength() {
+  TestRig rig;
+
+  // one byte short of the minimum, one over the maximum - NACKed, the rig left alone
+  rig.command({0x05, 0x00, 0x40, 0x07, 0x14});
+  CHECK(rig.nacked());
+  rig.command({0x05, 0x00, 0x40, 0x07, 0x14, 0x00, 0x00});
+  CHECK(rig.nacked());
+  rig.command({0x06});
+  CHECK(rig.nacked());
+  rig.command({0x06, CAT_MODE_CW, CAT_MODE_FILTER1, 0x00});
+  CHECK(rig.nacked());
+  rig.command({0x03, 0x00});
+  CHECK(rig.nacked());
+  CHECK(rig.calls.empty());
+  CHECK(rig.freqA == 7074000UL && rig.mode == CAT_MODE_USB);
+#if CAT_FEATURE_METRICS
+  CHECK(rig.radio.metrics().rejects == 5);
+#endif
+
+  // the minimum and the maximum themselves are taken
+  rig.command({0x06, CAT_MODE_CW});
+  rig.command({0x06, CAT_MODE_LSB, CAT_MODE_FILTER1});
+  CHECK(rig.acked(2));
+  CHECK(rig.mode == CAT_MODE_LSB);
+}
+
+#if CAT_USER_COMMANDS
+static int userCalls = 0;
+static std::vector<byte> userCmd;
+
+static void userScan(IC746 &radio, byte *cmd, int len) {
+  userCalls++;
+  userCmd.assign(cmd, cmd + len);
+  radio.sendAck();
+}
+
+static void userReadFreq(IC746 &radio, byte *cmd, int len) {
+  static const byte f[] = {0x00, 0x00, 0x00, 0x01, 0x00};   // 1 MHz
+
+  userCalls++;
+  memcpy(cmd + len, f, sizeof(f));
+  radio.sendResponse(cmd, len + sizeof(f));
+}
+
+static void testAddCommand() {
+  TestRig rig;
+
+  userCalls = 0;
+  CHECK(rig.radio.addCATCommand(CAT_SCAN, 4, 4, userScan));
+  rig.command({0x0E, 0x01});
+  CHECK(rig.acked());
+  CHECK(userCalls == 1);
+  CHECK(userCmd == std::vector<byte>({CAT_RIG_ADDR, CAT_CTRL_ADDR, 0x0E, 0x01}));
+
+  // outside its range - NACKed without calling it
+  rig.command({0x0E});
+  CHECK(rig.nacked());
+  rig.command({0x0E, 0x01, 0x00});
+  CHECK(rig.nacked());
+  CHECK(userCalls == 1);
+
+  // a built in command replaced
+  CHECK(rig.radio.addCATCommand(CAT_READ_FREQ, 3, 3, userReadFreq));
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x00, 0x00, 0x00, 0x01, 0x00}));
+  CHECK(userCalls == 2);
+
+  // registered again - the entry is replaced, not added
+  CHECK(rig.radio.addCATCommand(CAT_SCAN, 3, 4, userScan));
+  rig.command({0x0E});
+  CHECK(rig.acked());
+  CHECK(userCalls == 3);
+#if CAT_USER_COMMANDS == 2
+  CHECK(!rig.radio.addCATCommand(CAT_SET_OFFSET, 3, 3, userScan));
+#endif
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Shadow registers - polls answered from the library's copy
+////////////////////////////////////////////////////////////////////////////////
+
+// A rig that counts the calls of its get functions
+class CountingRig : public TestRig {
+  public:
+    int gets = 0;
+
+    CountingRig(boolean shadow) : TestRig(shadow) {}
+
+    boolean getFreq(CATFreq &f) { gets++; return TestRig::getFreq(f); }
+    boolean getMode(byte &m) { gets++; return TestRig::getMode(m); }
+    boolean getPtt(boolean &tx) { gets++; return TestRig::getPtt(tx); }
+    boolean getSmeter(byte &s) { gets++; return TestRig::getSmeter(s); }
+};
+
+// Every poll a shadow register answers
+static void polls(TestRig &rig) {
+  rig.command({0x03});
+  rig.command({0x04});
+  rig.command({0x1C, 0x00});
+  rig.command({0x15, 0x02});
+#if CAT_FEATURE_DUAL_VFO
+  rig.command({0x25, 0x00});
+  rig.command({0x26, 0x00});
+#endif
+#if CAT_FEATURE_BANDSTACK
+  rig.command({0x02});
+#endif
+  rig.wire.tx.clear();
+}
+
+static void testShadowAnswers() {
+  CountingRig rig(true);
+
+  polls(rig);
+  CHECK(rig.gets == 0);
+
+  // the values pushed by the sketch, and those set by CAT, come back without a get
+  rig.radio.updateFreq(14074000UL);
+  rig.radio.updateMode(CAT_MODE_CW);
+  rig.radio.updatePtt(true);
+  rig.radio.updateSmeter(9);
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x14, 0x00}));
+  rig.command({0x04});
+  CHECK(rig.sent({0x04, CAT_MODE_CW, CAT_MODE_FILTER1}));
+  rig.command({0x1C, 0x00});
+  CHECK(rig.sent({0x1C, 0x00, 0x01}));
+  rig.command({0x15, 0x02});
+  CHECK(rig.sent({0x15, 0x02, 0x01, 0x20}));
+  rig.command({0x05, 0x00, 0x40, 0x07, 0x21, 0x00});
+  CHECK(rig.acked());
+  CHECK(rig.calls == "F");
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x21, 0x00}));
+  CHECK(rig.gets == 0);
+
+  // without the shadow registers each poll asks the rig
+  CountingRig direct(false);
+  polls(direct);
+  CHECK(direct.gets >= 4);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Response cache - a poll answers from the frame kept, until the value moves
+////////////////////////////////////////////////////////////////////////////////
+
+#if CAT_FEATURE_RESPONSE_CACHE
+static void testCacheHits() {
+  TestRig rig;
+
+  rig.command({0x03});
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x07, 0x00}, 2));
+  rig.command({0x04});
+  rig.command({0x04});
+  CHECK(rig.sent({0x04, CAT_MODE_USB, CAT_MODE_FILTER1}, 2));
+  CHECK(rig.radio.cacheMisses() == 2);
+  CHECK(rig.radio.cacheHits() == 2);
+  rig.radio.resetCacheStats();
+  CHECK(rig.radio.cacheHits() == 0 && rig.radio.cacheMisses() == 0);
+}
+
+// Each change is answered by the next poll, and costs it one miss
+static void testCacheAfterCommands() {
+  TestRig rig;
+
+  rig.command({0x03});
+  rig.command({0x04});
+  rig.wire.tx.clear();
+
+  // set frequency
+  rig.command({0x05, 0x00, 0x00, 0x10, 0x10, 0x00});
+  CHECK(rig.acked());
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x00, 0x00, 0x10, 0x10, 0x00}));
+  CHECK(rig.radio.cacheMisses() == 3);
+
+  // set mode
+  rig.command({0x06, CAT_MODE_CW});
+  CHECK(rig.acked());
+  rig.command({0x04});
+  CHECK(rig.sent({0x04, CAT_MODE_CW, CAT_MODE_FILTER1}));
+  CHECK(rig.radio.cacheMisses() == 4);
+
+  // select VFO B - its own frequency and mode
+  rig.command({0x07, CAT_VFO_B});
+  CHECK(rig.acked());
+  rig.command({0x03});
+  rig.command({0x04});
+  std::vector<byte> want;
+  addFrame(want, CAT_CTRL_ADDR, CAT_RIG_ADDR, {0x03, 0x00, 0x40, 0x07, 0x14, 0x00});
+  addFrame(want, CAT_CTRL_ADDR, CAT_RIG_ADDR, {0x04, CAT_MODE_USB, CAT_MODE_FILTER1});
+  CHECK(rig.took(want));
+  CHECK(rig.radio.cacheMisses() == 6);
+
+  // turned on the front panel, with nothing pushed to the library - the callback has it
+  rig.freqB = 21074000UL;
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x21, 0x00}));
+  CHECK(rig.radio.cacheMisses() == 7);
+  CHECK(rig.radio.cacheHits() == 0);
+}
+
+// With the shadow registers the updateXxx() calls move the answer
+static void testCacheAfterUpdates() {
+  TestRig rig(true);
+
+  rig.command({0x03});
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x07, 0x00}, 2));
+  CHECK(rig.radio.cacheHits() == 1);
+
+  rig.panelFreq(7040000UL);
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x00, 0x00, 0x04, 0x07, 0x00}));
+  rig.panelMode(CAT_MODE_LSB);
+  rig.command({0x04});
+  CHECK(rig.sent({0x04, CAT_MODE_LSB, CAT_MODE_FILTER1}));
+  rig.radio.updateVfo(CAT_VFO_B);
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x14, 0x00}));
+  rig.radio.updateFreq(CAT_VFO_B, 14200000UL);
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x00, 0x00, 0x20, 0x14, 0x00}));
+  CHECK(rig.radio.cacheMisses() == 5);
+  CHECK(rig.radio.cacheHits() == 1);
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Set frequency coalescing - the latest frequency, once an interval, and before anything that
+// depends on it
+////////////////////////////////////////////////////////////////////////////////
+
+#if CAT_FEATURE_COALESCE
+// A rig coalescing at 50 ms that has just retuned to 7.074 MHz, and holds 14.074 MHz back
+static void coalesced(TestRig &rig) {
+  advanceMs(1000);
+  rig.radio.setFreqCoalescing(50);
+  rig.command({0x05, 0x00, 0x40, 0x07, 0x07, 0x00});
+  rig.command({0x05, 0x00, 0x40, 0x07, 0x14, 0x00});
+  CHECK(rig.acked(2));
+  CHECK(rig.calls == "F");
+  CHECK(rig.freqA == 7074000UL);
+}
+
+static void testCoalesceInterval() {
+  TestTime time;
+  TestRig rig;
+
+  coalesced(rig);
+  rig.command({0x05, 0x00, 0x40, 0x07, 0x21, 0x00});
+  CHECK(rig.acked());
+  advanceMs(49);
+  rig.radio.check();
+  CHECK(rig.calls == "F");
+  advanceMs(1);
+  rig.radio.check();
+  CHECK(rig.calls == "FF");
+  CHECK(rig.freqA == 21074000UL);
+}
+
+static void testCoalesceBeforePtt() {
+  TestTime time;
+  TestRig rig;
+
+  coalesced(rig);
+  rig.command({0x1C, 0x00, 0x01});
+  CHECK(rig.acked());
+  CHECK(rig.calls == "FFT");
+  CHECK(rig.freqA == 14074000UL);
+}
+
+static void testCoalesceBeforeMode() {
+  TestTime time;
+  TestRig rig;
+
+  coalesced(rig);
+  rig.command({0x06, CAT_MODE_CW});
+  CHECK(rig.acked());
+  CHECK(rig.calls == "FFM");
+  CHECK(rig.freqA == 14074000UL);
+}
+
+static void testCoalesceBeforeRead() {
+  TestTime time;
+  TestRig rig;
+
+  // the rig is asked for its frequency - it has the one held back
+  coalesced(rig);
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x14, 0x00}));
+  CHECK(rig.calls == "FF");
+#if CAT_FEATURE_DUAL_VFO
+  rig.command({0x05, 0x00, 0x40, 0x07, 0x21, 0x00});
+  CHECK(rig.acked());
+  rig.command({0x25, 0x00});
+  CHECK(rig.sent({0x25, 0x00, 0x00, 0x40, 0x07, 0x21, 0x00}));
+  CHECK(rig.calls == "FFF");
+#endif
+}
+
+static void testCoalesceShadowRead() {
+  TestTime time;
+  TestRig rig(true);
+
+  // the shadow registers have it already - the poll costs no retune
+  coalesced(rig);
+  rig.command({0x03});
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x14, 0x00}));
+  CHECK(rig.calls == "F");
+  advanceMs(50);
+  rig.radio.check();
+  CHECK(rig.calls == "FF");
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// PTT priority lane
+////////////////////////////////////////////////////////////////////////////////
+
+#if CAT_FEATURE_PTT_PRIORITY
+static void testUnkeyTakesLane() {
+  TestRig rig;
+
+  // a key waiting behind a set frequency, then an unkey - the rig is never keyed
+  rig.queue({0x05, 0x00, 0x40, 0x07, 0x14, 0x00});
+  rig.queue({0x1C, 0x00, 0x01});
+  rig.queue({0x1C, 0x00, 0x00});
+  rig.radio.check();
+  CHECK(rig.acked(3));
+  CHECK(rig.calls == "RF");
+  CHECK(!rig.ptt);
+}
+
+static void testKeyBehindUnkey() {
+  TestRig rig;
+
+  rig.ptt = true;
+  rig.queue({0x1C, 0x00, 0x00});
+  rig.queue({0x1C, 0x00, 0x01});
+  rig.radio.check();
+  CHECK(rig.acked(2));
+  CHECK(rig.calls == "RT");
+  CHECK(rig.ptt);
+}
+
+static void testKeyReplacesKey() {
+  TestRig rig;
+
+  rig.queue({0x05, 0x00, 0x40, 0x07, 0x14, 0x00});
+  rig.queue({0x1C, 0x00, 0x01});
+  rig.queue({0x1C, 0x00, 0x01});
+  rig.radio.check();
+  CHECK(rig.acked(3));
+  CHECK(rig.calls == "FT");
+  CHECK(rig.freqA == 14074000UL);
+}
+
+static void testKeyRepeated() {
+  TestRig rig;
+
+  // a poll, then a key that is acted on ahead of it - and the same key again before the first
+  // has been answered: the rig is keyed once
+  rig.queue({0x03});
+  rig.queue({0x1C, 0x00, 0x01});
+  rig.radio.check(1);
+  CHECK(rig.calls == "T");
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x07, 0x00}));
+  rig.command({0x1C, 0x00, 0x01});
+  CHECK(rig.acked(2));
+  CHECK(rig.calls == "T");
+
+  // an unkey, and a key after it, are still acted on
+  rig.command({0x1C, 0x00, 0x00});
+  rig.command({0x1C, 0x00, 0x01});
+  CHECK(rig.acked(2));
+  CHECK(rig.calls == "TRT");
+}
+
+// A rig whose retune calls servicePtt() halfway, as the README has it - and may defer its ACK
+class RetuneRig : public TestRig {
+  public:
+    boolean defer = false;
+
+    void setFreq(CATFreq f) {
+      calls += '(';
+      radio.servicePtt();
+      TestRig::setFreq(f);
+#if CAT_FEATURE_ASYNC
+      if (defer) radio.deferAck();
+#endif
+      calls += ')';
+    }
+};
+
+static void testKeyBehindRetune() {
+  RetuneRig rig;
+
+  // the key is not acted on inside the retune ahead of it, but right after it - never on the
+  // old frequency
+  rig.queue({0x05, 0x00, 0x40, 0x07, 0x14, 0x00});
+  rig.queue({0x1C, 0x00, 0x01});
+  rig.radio.check();
+  CHECK(rig.acked(2));
+  CHECK(rig.calls == "(F)T");
+
+  // an unkey goes ahead of it
+  rig.queue({0x05, 0x00, 0x40, 0x07, 0x07, 0x00});
+  rig.queue({0x1C, 0x00, 0x00});
+  rig.radio.check();
+  CHECK(rig.acked(2));
+  CHECK(rig.calls == "(F)TR(F)");
+
+#if CAT_FEATURE_ASYNC
+  // a retune running in the background holds the key until it completes
+  rig.calls.clear();
+  rig.defer = true;
+  rig.queue({0x05, 0x00, 0x40, 0x07, 0x14, 0x00});
+  rig.queue({0x1C, 0x00, 0x01});
+  rig.radio.check();
+  rig.radio.check();
+  CHECK(rig.calls == "(F)");
+  CHECK(rig.wire.tx.empty());
+  rig.radio.completeAck();
+  rig.radio.check();
+  CHECK(rig.calls == "(F)T");
+  CHECK(rig.acked(2));
+#endif
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Memory channels
+////////////////////////////////////////////////////////////////////////////////
+
+#if CAT_FEATURE_MEMORY
+// An EEPROM taking 3.3 ms a byte that counts the reads made while it is still writing - on an
+// ATmega each of them would stand in eeprom_read_byte() until the write is done
+class SlowStorage : public CATMemStorage {
+  public:
+    unsigned long busyReads = 0;
+
+    SlowStorage() : CATMemStorage(CAT_MEM_STORAGE_SIZE, 3300) {}
+
+    byte read(unsigned int addr) {
+      if (!ready()) busyReads++;
+      return CATMemStorage::read(addr);
+    }
+};
+
+static void testMemReadWhileWriting() {
+  TestTime time;
+  SlowStorage eeprom;
+  CATMemory memory(eeprom, 0);
+  CATChannel c = {14074000UL, CAT_MODE_USB, false};
+  CATChannel back;
+
+  memory.begin();
+  memory.write(3, c);
+  while (memory.busy()) {
+    memory.service();
+    CHECK(memory.read(3, back) && back.freq == c.freq);
+    advanceMs(1);
+  }
+  CHECK(!eeprom.ready());      // the check byte is still going in
+  CHECK(memory.read(3, back) && back.freq == c.freq);
+  CHECK(eeprom.busyReads == 0);
+}
+
+#if CAT_FREQ_BITS == 64
+static void testMemFreqAbove32Bits() {
+  CATMemStorage eeprom;
+  CATMemory memory(eeprom, 0);
+  CATChannel c = {9999999999ULL, CAT_MODE_USB, true};
+  CATChannel back;
+
+  memory.begin();
+  CHECK(memory.write(5, c));
+  memory.flush();
+  memory.begin();              // from the EEPROM, not the record buffer
+  CHECK(memory.read(5, back) && back.freq == c.freq && back.mode == c.mode && back.split);
+  c.freq = CAT_MEM_FREQ_MAX + 1;
+  CHECK(!memory.write(5, c));
+}
+#endif
+
+static void testMemRecordCheck() {
+  CATMemStorage eeprom;
+  CATMemory memory(eeprom, 0);
+  CATChannel c = {7074000UL, CAT_MODE_LSB, false};
+  CATChannel back;
+
+  memory.begin();
+  memory.write(0, c);
+  memory.flush();
+
+  // +1 in one frequency byte and -1 in the next - the same sum, a different frequency
+  eeprom.write(CAT_MEM_IX_FREQ, eeprom.read(CAT_MEM_IX_FREQ) + 1);
+  eeprom.write(CAT_MEM_IX_FREQ + 1, eeprom.read(CAT_MEM_IX_FREQ + 1) - 1);
+  memory.begin();
+  CHECK(!memory.read(0, back));
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Band edges and band stacking registers
+////////////////////////////////////////////////////////////////////////////////
+
+#if CAT_FEATURE_BANDSTACK
+static void testBandEdge() {
+  TestRig rig;
+
+  rig.command({0x02});
+  CHECK(rig.sent({0x02, 0x00, 0x00, 0x00, 0x07, 0x00, 0x2D, 0x00, 0x00, 0x30, 0x07, 0x00}));
+  rig.command({0x05, 0x00, 0x40, 0x07, 0x14, 0x00});
+  CHECK(rig.acked());
+  rig.command({0x02});
+  CHECK(rig.sent({0x02, 0x00, 0x00, 0x00, 0x14, 0x00, 0x2D, 0x00, 0x00, 0x35, 0x14, 0x00}));
+
+  // tuned at the rig - the band is the one the rig reports
+  rig.freqA = 21074000UL;
+  rig.command({0x02});
+  CHECK(rig.sent({0x02, 0x00, 0x00, 0x00, 0x21, 0x00, 0x2D, 0x00, 0x00, 0x45, 0x21, 0x00}));
+
+  // outside every band
+  rig.command({0x05, 0x00, 0x00, 0x00, 0x08, 0x00});
+  CHECK(rig.acked());
+  rig.command({0x02});
+  CHECK(rig.nacked());
+}
+
+static void testBandStack() {
+  TestRig rig;
+
+  // register 1 of 40 m is the VFO, 2 and 3 the bottom of the band, as at power up
+  rig.command({0x1A, 0x01, 0x03, 0x01});
+  CHECK(rig.sent({0x1A, 0x01, 0x03, 0x01, 0x00, 0x40, 0x07, 0x07, 0x00, CAT_MODE_USB, CAT_MODE_FILTER1}));
+  rig.command({0x1A, 0x01, 0x03, 0x02});
+  CHECK(rig.sent({0x1A, 0x01, 0x03, 0x02, 0x00, 0x00, 0x00, 0x07, 0x00, CAT_MODE_LSB, CAT_MODE_FILTER1}));
+
+  // writing register 1 of 20 m changes band - frequency and mode in one command
+  rig.command({0x1A, 0x01, 0x05, 0x01, 0x00, 0x40, 0x07, 0x14, 0x00, CAT_MODE_CW, CAT_MODE_FILTER1});
+  CHECK(rig.acked());
+  CHECK(rig.calls == "FM");
+  CHECK(rig.freqA == 14074000UL && rig.mode == CAT_MODE_CW);
+  CHECK(rig.radio.band() == CAT_BAND_20M);
+
+  // 40 m keeps where the rig left it, and register 1 of 20 m follows the VFO
+  rig.command({0x1A, 0x01, 0x03, 0x01});
+  CHECK(rig.sent({0x1A, 0x01, 0x03, 0x01, 0x00, 0x40, 0x07, 0x07, 0x00, CAT_MODE_USB, CAT_MODE_FILTER1}));
+  rig.command({0x05, 0x00, 0x00, 0x20, 0x14, 0x00});
+  CHECK(rig.acked());
+  rig.command({0x1A, 0x01, 0x05, 0x01});
+  CHECK(rig.sent({0x1A, 0x01, 0x05, 0x01, 0x00, 0x00, 0x20, 0x14, 0x00, CAT_MODE_CW, CAT_MODE_FILTER1}));
+
+  // back on 40 m its registers move down - 7.074 USB is now register 2, the bottom of the band 3
+  rig.command({0x05, 0x00, 0x00, 0x04, 0x07, 0x00});
+  CHECK(rig.acked());
+  rig.command({0x1A, 0x01, 0x03, 0x01});
+  CHECK(rig.sent({0x1A, 0x01, 0x03, 0x01, 0x00, 0x00, 0x04, 0x07, 0x00, CAT_MODE_CW, CAT_MODE_FILTER1}));
+  rig.command({0x1A, 0x01, 0x03, 0x02});
+  CHECK(rig.sent({0x1A, 0x01, 0x03, 0x02, 0x00, 0x40, 0x07, 0x07, 0x00, CAT_MODE_USB, CAT_MODE_FILTER1}));
+  rig.command({0x1A, 0x01, 0x03, 0x03});
+  CHECK(rig.sent({0x1A, 0x01, 0x03, 0x03, 0x00, 0x00, 0x00, 0x07, 0x00, CAT_MODE_LSB, CAT_MODE_FILTER1}));
+
+  // writing register 2 only stores it
+  rig.calls.clear();
+  rig.command({0x1A, 0x01, 0x03, 0x02, 0x00, 0x50, 0x07, 0x07, 0x00, CAT_MODE_LSB, CAT_MODE_FILTER1});
+  CHECK(rig.acked());
+  CHECK(rig.calls.empty() && rig.freqA == 7040000UL);
+  rig.command({0x1A, 0x01, 0x03, 0x02});
+  CHECK(rig.sent({0x1A, 0x01, 0x03, 0x02, 0x00, 0x50, 0x07, 0x07, 0x00, CAT_MODE_LSB, CAT_MODE_FILTER1}));
+
+  // a frequency outside the band, a register past the depth, a band code with no band
+  rig.command({0x1A, 0x01, 0x03, 0x01, 0x00, 0x40, 0x07, 0x14, 0x00, CAT_MODE_USB, CAT_MODE_FILTER1});
+  CHECK(rig.nacked());
+#if CAT_BANDSTACK_DEPTH == 3
+  rig.command({0x1A, 0x01, 0x03, 0x04});
+  CHECK(rig.nacked());
+#endif
+  rig.command({0x1A, 0x01, 0x12, 0x01});
+  CHECK(rig.nacked());
+  CHECK(rig.calls.empty());
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Trace ring - the oldest records make room, whole records are read out
+////////////////////////////////////////////////////////////////////////////////
+
+static void testTraceOverwrite() {
+  TestTime time;
+  CATTrace trace;
+  byte d[10] = {0};
+  byte out[CAT_TRACE_BUF_LENGTH];
+  const int rec = CAT_TRACE_HDR + sizeof(d);
+  const int fit = (CAT_TRACE_BUF_LENGTH - CAT_TRACE_HDR - 4) / rec;   // behind the TIME record
+
+  for (int i = 0; i < fit + 2; i++) {
+    if (i == fit) CHECK(trace.lost() == 0);
+    d[0] = i;
+    trace.record(CAT_TRC_USER, d, sizeof(d));
+    testNow += 10 << CAT_TRACE_TICK_SHIFT;
+  }
+  CHECK(trace.lost() == 2);    // the TIME record and record 0
+
+  // too small for a record - nothing; then whole records only, oldest first
+  CHECK(trace.read(out, rec - 1) == 0);
+  CHECK(trace.read(out, 2 * rec + 1) == 2 * rec);
+  CHECK(out[0] == CAT_TRC_USER && out[1] == 10 && out[2] == 0 && out[3] == sizeof(d) && out[4] == 1);
+  CHECK(out[rec] == CAT_TRC_USER && out[rec + 4] == 2);
+  CHECK(trace.read(out, sizeof(out)) == (fit - 1) * rec);
+  CHECK(out[4] == 3 && out[(fit - 2) * rec + 4] == fit + 1);
+  CHECK(trace.read(out, sizeof(out)) == 0);
+
+  // after a clear the decoder gets the time again
+  trace.clear();
+  CHECK(trace.lost() == 0);
+  trace.record(CAT_TRC_USER, d, sizeof(d));
+  CHECK(trace.read(out, sizeof(out)) == CAT_TRACE_HDR + 4 + rec);
+  CHECK(out[0] == CAT_TRC_TIME && out[3] == 4);
+  CHECK(out[4] == byte(testNow) && out[5] == byte(testNow >> 8) && out[6] == byte(testNow >> 16));
+  CHECK(out[8] == CAT_TRC_USER && out[9] == 0 && out[10] == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Metrics
+////////////////////////////////////////////////////////////////////////////////
+
+#if CAT_FEATURE_METRICS
+#if CAT_FEATURE_ASYNC
+// A rig whose set frequency defers its ACK - and with done set finishes the job before returning
+class AsyncRig : public TestRig {
+  public:
+    boolean done = true;
+    boolean ok = true;
+    boolean doneInGet = false;   // ... or finishes it in the next read frequency
+
+    void setFreq(CATFreq f) {
+      TestRig::setFreq(f);
+      if (radio.deferAck() && done) radio.completeAck(ok);
+    }
+
+    boolean getFreq(CATFreq &f) {
+      if (doneInGet && radio.ackPending()) radio.completeAck();
+      return TestRig::getFreq(f);
+    }
+};
+
+static void testAckCompletedInCallback() {
+  AsyncRig rig;
+
+  rig.command({0x05, 0x00, 0x40, 0x07, 0x14, 0x00});
+  CHECK(rig.acked());
+  CHECK(!rig.radio.ackPending());
+  CHECK(rig.radio.metrics().byOpcode[CAT_SET_FREQ] == 1);
+  CHECK(rig.radio.metrics().commands == 1);
+}
+
+static void testAckFailedInCallback() {
+  AsyncRig rig;
+
+  rig.ok = false;
+  rig.command({0x05, 0x00, 0x40, 0x07, 0x14, 0x00});
+  CHECK(rig.nacked());
+  CHECK(!rig.radio.ackPending());
+  CHECK(rig.radio.metrics().byOpcode[CAT_SET_FREQ] == 1);
+}
+
+static void testAckCompletedLater() {
+  AsyncRig rig;
+
+  rig.done = false;
+  rig.command({0x05, 0x00, 0x40, 0x07, 0x14, 0x00});
+  CHECK(rig.wire.tx.empty());
+  CHECK(rig.radio.ackPending());
+  CHECK(rig.radio.metrics().commands == 0);
+  rig.command({0x03});                       // answered meanwhile
+  CHECK(rig.sent({0x03, 0x00, 0x40, 0x07, 0x14, 0x00}));
+  rig.radio.completeAck();
+  CHECK(rig.acked());
+  CHECK(rig.radio.metrics().byOpcode[CAT_SET_FREQ] == 1);
+  CHECK(rig.radio.metrics().byOpcode[CAT_READ_FREQ] == 1);
+  CHECK(rig.radio.metrics().commands == 2);
+}
+
+static void testAckCompletedInPoll() {
+  AsyncRig rig;
+
+  rig.done = false;
+  rig.doneInGet = true;
+  rig.command({0x05, 0x00, 0x40, 0x07, 0x14, 0x00});
+  rig.command({0x03});
+  CHECK(rig.radio.metrics().byOpcode[CAT_SET_FREQ] == 1);
+  CHECK(rig.radio.metrics().byOpcode[CAT_READ_FREQ] == 1);
+  CHECK(rig.radio.metrics().commands == 2);
+}
+#endif
+
+static void testMetricsEveryOpcode() {
+  TestRig rig;
+
+  rig.command({0x25, 0x01});
+  rig.command({0x26, 0x00});
+  rig.command({0x26, 0x00});
+#if CAT_FEATURE_DUAL_VFO
+  // 25 and 26 have their own counters, as every command of the table
+  CHECK(rig.radio.metrics().byOpcode[CAT_VFO_FREQ] == 1);
+  CHECK(rig.radio.metrics().byOpcode[CAT_VFO_MODE] == 2);
+  CHECK(rig.radio.metrics().otherOpcodes == 0);
+#else
+  // ... and without them they are outside the table
+  CHECK(rig.radio.metrics().otherOpcodes == 3);
+  CHECK(rig.radio.metrics().rejects == 3);
+#endif
+  CHECK(rig.radio.metrics().commands == 3);
+}
+
+// Counters stop at the top of their type, and the worst latency at the top of its own
+static void testMetricsSaturate() {
+  CATMetrics m;
+
+  m.byOpcode[CAT_READ_FREQ] = UINT_MAX - 1;
+  m.command(CAT_READ_FREQ, 10);
+  CHECK(m.byOpcode[CAT_READ_FREQ] == UINT_MAX);
+  m.command(CAT_READ_FREQ, 10);
+  CHECK(m.byOpcode[CAT_READ_FREQ] == UINT_MAX);
+  CHECK(m.commands == 2);
+
+  m.rxErrors = UINT_MAX - 5;
+  CATMetrics::bump(m.rxErrors, 10);
+  CHECK(m.rxErrors == UINT_MAX);
+
+  m.command(CAT_READ_MODE, ULONG_MAX);
+  CHECK(m.worst[CAT_READ_MODE] == UINT_MAX);
+  CHECK(m.latency[CAT_METRICS_BUCKETS - 1] == 1);
+
+  m.commands = ULONG_MAX;
+  m.command(CAT_READ_MODE, 0);
+  CHECK(m.commands == ULONG_MAX);
+  m.reset();
+  CHECK(m.commands == 0 && m.byOpcode[CAT_READ_FREQ] == 0 && m.rxErrors == 0);
+}
+
+#if CAT_METRICS_CMD
+// The counters read out over CAT with the vendor command
+static void testMetricsReadout() {
+  TestTime time;               // a clock that stands still - every latency is 0 us
+  TestRig rig;
+
+  rig.command({0x03});
+  rig.command({0x03});
+  rig.command({0x04});
+  rig.feed({CAT_PREAMBLE, CAT_RIG_ADDR, CAT_EOM});    // a framing error
+  rig.command({0x0D});                                // a reject
+  rig.wire.tx.clear();
+
+  rig.command({CAT_METRICS_CMD, 0x00, 0x03});
+  CHECK(rig.sent({CAT_METRICS_CMD, 0x00, 0x03, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00}));
+  rig.command({CAT_METRICS_CMD, 0x01});
+  CHECK(rig.sent({CAT_METRICS_CMD, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+                  0x00, 0x00, 0x00, 0x01, 0x00, 0x00}));
+  rig.command({CAT_METRICS_CMD, 0x02, 0x00});        // the two 7E before it are commands too
+  CHECK(rig.sent({CAT_METRICS_CMD, 0x02, 0x00, 0x06, 0x00, 0x00}));
+  rig.command({CAT_METRICS_CMD, 0x02, CAT_METRICS_BUCKETS});
+  CHECK(rig.nacked());
+
+  // a count past six digits reads as 999999
+  const_cast<CATMetrics &>(rig.radio.metrics()).byOpcode[CAT_READ_FREQ] = 1234567;
+  rig.command({CAT_METRICS_CMD, 0x00, 0x03});
+  CHECK(rig.sent({CAT_METRICS_CMD, 0x00, 0x03, 0x99, 0x99, 0x99, 0x00, 0x00, 0x00}));
+
+  rig.command({CAT_METRICS_CMD, 0x03});
+  CHECK(rig.acked());
+  CHECK(rig.radio.metrics().commands == 1);         // the reset itself
+  rig.command({CAT_METRICS_CMD, 0x00, 0x03});
+  CHECK(rig.sent({CAT_METRICS_CMD, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}));
+}
+#endif
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct Test {
+  const char *name;
+  void (*run)();
+};
+
+static const Test tests[] = {
+  {"freq above long", testFreqAboveLong},
+#if CAT_FEATURE_DUAL_VFO
+  {"vfo freq above long", testVfoFreqAboveLong},
+#endif
+  {"shadow freq above long", testShadowFreqAboveLong},
+#if CAT_FREQ_BITS == 64
+  {"freq up to 10 GHz", testFreq10GHz},
+#else
+  {"freq too high for 32 bits", testFreqTooHigh},
+#endif
+  {"freq bad digits", testFreqBadDigits},
+  {"rx preamble inside a frame", testRxPreambleMidFrame},
+  {"rx jam code", testRxJam},
+#if CAT_RX_BYTE_TIMEOUT
+  {"rx stalled frame", testRxStall},
+#endif
+  {"rx queue full", testRxQueueFull},
+  {"link CI-V bus", testLinkCiv},
+  {"link USB", testLinkUsb},
+  {"link hamlib", testLinkHamlib},
+  {"tx queue full and wrapped", testTxRingFull},
+  {"check() budget", testCheckBudget},
+#if CAT_FEATURE_AUTOBAUD
+  {"autobaud guess from the first byte", testAutoBaudGuess},
+  {"autobaud rescan on errors", testAutoBaudRescan},
+#if CAT_FEATURE_METRICS
+  {"autobaud counts framing errors", testAutoBaudCountsErrors},
+#endif
+#endif
+#if CAT_FEATURE_TRANSCEIVE
+  {"transceive rate limit", testTcvRateLimit},
+  {"transceive queue full", testTcvQueueFull},
+#endif
+  {"split read", testSplitRead},
+#if CAT_FEATURE_DUAL_VFO
+  {"25 / 26 through the VFO select", testVfoFallback},
+#else
+  {"no 25 / 26", testVfoNone},
+#endif
+  {"command length outside the table's range", testTableLength},
+#if CAT_USER_COMMANDS
+  {"command added by the sketch", testAddCommand},
+#endif
+  {"shadow registers answer polls", testShadowAnswers},
+#if CAT_FEATURE_RESPONSE_CACHE
+  {"cache hits and misses", testCacheHits},
+  {"cache after commands", testCacheAfterCommands},
+  {"cache after updates", testCacheAfterUpdates},
+#endif
+#if CAT_FEATURE_COALESCE
+  {"coalesce interval", testCoalesceInterval},
+  {"coalesce flushed before PTT", testCoalesceBeforePtt},
+  {"coalesce flushed before a mode change", testCoalesceBeforeMode},
+  {"coalesce flushed before a read", testCoalesceBeforeRead},
+  {"coalesce shadow read", testCoalesceShadowRead},
+#endif
+#if CAT_FEATURE_PTT_PRIORITY
+  {"unkey takes the PTT lane", testUnkeyTakesLane},
+  {"key queues behind an unkey", testKeyBehindUnkey},
+  {"key replaces a key", testKeyReplacesKey},
+  {"key repeated", testKeyRepeated},
+  {"key behind a retune", testKeyBehindRetune},
+#endif
+#if CAT_FEATURE_MEMORY
+  {"memory read while writing", testMemReadWhileWriting},
+  {"memory record check", testMemRecordCheck},
+#if CAT_FREQ_BITS == 64
+  {"memory freq above 32 bits", testMemFreqAbove32Bits},
+#endif
+#endif
+#if CAT_FEATURE_BANDSTACK
+  {"band edge", testBandEdge},
+  {"band stacking registers", testBandStack},
+#endif
+  {"trace ring overwrite and read-out", testTraceOverwrite},
+#if CAT_FEATURE_METRICS
+#if CAT_FEATURE_ASYNC
+  {"ACK completed inside the callback", testAckCompletedInCallback},
+  {"ACK failed inside the callback", testAckFailedInCallback},
+  {"ACK completed later", testAckCompletedLater},
+  {"ACK completed in a poll", testAckCompletedInPoll},
+#endif
+  {"metrics count every opcode", testMetricsEveryOpcode},
+  {"metrics saturate", testMetricsSaturate},
+#if CAT_METRICS_CMD
+  {"metrics read out with 7E", testMetricsReadout},
+#endif
+#endif
+};
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "-v") == 0) printAll = true;
+
+  for (const Test &t : tests) {
+    int before = failed;
+    if (printAll) printf("%s\n", t.name);
+    t.run();
+    if (failed != before && !printAll) printf("%s: failed\n", t.name);
+  }
+  printf("%d tests, %d checks, %s\n", int(sizeof(tests) / sizeof(tests[0])), checks,
+         failed ? "FAILED" : "all pass");
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,169 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   cat_trace - decode a binary trace read out with IC746::traceRead()
+
+     cat_trace [file]      (stdin if no file is given)
+
+   One line per record:
+     time (ms)  gap (ms)  event  bytes  description
+
+   Times are from the first CAT_TRC_TIME record in the file - the recorder writes
+   one as its first record and after every gap of more than a second.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "IC746.h"
+#include "CATBcd.h"
+
+static const char *eventName(byte code) {
+  switch (code) {
+    case CAT_TRC_TIME:       return "TIME";
+    case CAT_TRC_RX:         return "RX";
+    case CAT_TRC_TX:         return "TX";
+    case CAT_TRC_TX_DROP:    return "TXDROP";
+    case CAT_TRC_RX_ERROR:   return "RXERR";
+    case CAT_TRC_RX_OVERRUN: return "OVERRUN";
+    case CAT_TRC_REJECT:     return "REJECT";
+    case CAT_TRC_BAUD:       return "BAUD";
+    case CAT_TRC_RX_RESYNC:  return "RESYNC";
+  }
+  return code >= CAT_TRC_USER ? "USER" : "?";
+}
+
+static const char *commandName(byte cmd) {
+  switch (cmd) {
+    case CAT_SET_TCV_FREQ:   return "transceive freq";
+    case CAT_SET_TCV_MODE:   return "transceive mode";
+    case CAT_READ_BAND_EDGE: return "read band edge";
+    case CAT_READ_FREQ:      return "read freq";
+    case CAT_READ_MODE:      return "read mode";
+    case CAT_SET_FREQ:       return "set freq";
+    case CAT_SET_MODE:       return "set mode";
+    case CAT_SET_VFO:        return "set vfo";
+    case CAT_SEL_MEM:        return "select memory";
+    case CAT_WRITE_MEM:      return "write memory";
+    case CAT_MEM_TO_VFO:     return "memory to vfo";
+    case CAT_CLEAR_MEM:      return "clear memory";
+    case CAT_SPLIT:          return "split";
+    case CAT_READ_SMETER:    return "s meter / squelch";
+    case CAT_READ_ID:        return "read id";
+    case CAT_MISC:           return "misc";
+    case CAT_PTT:            return "ptt";
+    case CAT_VFO_FREQ:       return "vfo freq";
+    case CAT_VFO_MODE:       return "vfo mode";
+    case CAT_ACK:            return "ACK";
+    case CAT_NACK:           return "NACK";
+  }
+  return "";
+}
+
+// Frequency field of a 03 / 05 / 00 / 25 frame, or the edges of a 02 answer, if it has one
+static void describeFrame(const byte *d, int n) {
+  if (n < 3) return;
+  printf("  %s", commandName(d[2]));
+  if ((d[2] == CAT_READ_FREQ || d[2] == CAT_SET_FREQ || d[2] == CAT_SET_TCV_FREQ) && n >= 3 + CAT_FREQ_BYTES) {
+    printf(" %llu Hz", (unsigned long long)catBCDToFreq(&d[3], CAT_FREQ_BYTES));
+  }
+  if (d[2] == CAT_VFO_FREQ && n >= 4 + CAT_FREQ_BYTES) {
+    printf(" %s %llu Hz", d[3] == CAT_VFO_SELECTED ? "selected" : "unselected",
+           (unsigned long long)catBCDToFreq(&d[4], CAT_FREQ_BYTES));
+  }
+  if (d[2] == CAT_READ_BAND_EDGE && n >= 4 + 2 * CAT_FREQ_BYTES) {
+    printf(" %llu - %llu Hz", (unsigned long long)catBCDToFreq(&d[3], CAT_FREQ_BYTES),
+           (unsigned long long)catBCDToFreq(&d[4 + CAT_FREQ_BYTES], CAT_FREQ_BYTES));
+  }
+}
+
+static double toMs(unsigned long long ticks) {
+  return ticks * (1 << CAT_TRACE_TICK_SHIFT) / 1000.0;
+}
+
+int main(int argc, char **argv) {
+  FILE *in = stdin;
+  byte hdr[CAT_TRACE_HDR], data[256];
+  unsigned long long ticks = 0;     // time in 1 << CAT_TRACE_TICK_SHIFT microsecond units
+  unsigned long long base = 0;      // ... of the first TIME record
+  boolean synced = false;
+  long records = 0;
+
+  if (argc > 2) {
+    fprintf(stderr, "usage: %s [trace file]\n", argv[0]);
+    return 1;
+  }
+  if (argc == 2 && !(in = fopen(argv[1], "rb"))) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  while (fread(hdr, 1, sizeof(hdr), in) == sizeof(hdr)) {
+    byte code = hdr[0];
+    unsigned int dt = hdr[1] | (hdr[2] << 8);
+    int n = hdr[3];
+
+    if (fread(data, 1, n, in) != (size_t)n) {
+      fprintf(stderr, "cat_trace: truncated record\n");
+      break;
+    }
+    records++;
+
+    if (code == CAT_TRC_TIME && n == 4) {
+      unsigned long t = data[0] | (data[1] << 8) | ((unsigned long)data[2] << 16) | ((unsigned long)data[3] << 24);
+      ticks = t >> CAT_TRACE_TICK_SHIFT;
+      if (!synced) base = ticks;
+      synced = true;
+      printf("%10.3f %9s  %-7s  micros %lu\n", toMs(ticks - base), "", "TIME", t);
+      continue;
+    }
+    ticks += dt;
+
+    printf("%10.3f %9.3f  %-7s ", toMs(ticks - base), toMs(dt), eventName(code));
+    switch (code) {
+      case CAT_TRC_RX:
+      case CAT_TRC_TX:
+      case CAT_TRC_TX_DROP:
+        for (int i = 0; i < n; i++) printf(" %02X", data[i]);
+        describeFrame(data, n);
+        break;
+      case CAT_TRC_RX_ERROR:
+        printf(" %d framing error(s)", data[0]);
+        break;
+      case CAT_TRC_RX_RESYNC:
+        printf(" %d frame(s) cut short", data[0]);
+        break;
+      case CAT_TRC_RX_OVERRUN:
+        printf(" %d command(s) lost", data[0] | (data[1] << 8));
+        break;
+      case CAT_TRC_REJECT:
+        printf(" opcode %02X length %d", data[0], data[1]);
+        break;
+      case CAT_TRC_BAUD:
+        printf(" %lu%s", data[0] | (data[1] << 8) | ((unsigned long)data[2] << 16) | ((unsigned long)data[3] << 24),
+               data[4] ? " locked" : "");
+        break;
+      default:
+        printf(" code %02X:", code);
+        for (int i = 0; i < n; i++) printf(" %02X", data[i]);
+        break;
+    }
+    printf("\n");
+  }
+
+  fprintf(stderr, "%ld records\n", records);
+  return 0;
+}
@@ -0,0 +1,277 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   civ_replay - replay a CI-V capture against the protocol engine
+
+     civ_replay [-x speed] [-s] [-t] [-c ms] [-P link] [-v] capture
+
+   Feeds the commands of a capture made with ic746_pty -R into a fresh IC746
+   engine driving the same emulated rig (EmuRig.h), and compares every frame it
+   sends with the recorded one.  The rig options stored in the capture are
+   applied first, -s / -t / -c / -P add to them.
+
+     -x  replay speed - 1 is the recorded timing, 10 ten times faster,
+         0 (default) as fast as the engine will go
+     -v  print the rig's log and every frame compared
+
+   Stops at the first mismatch and prints it with the command that caused it.
+   Exit status 0 if all frames match, 1 on a mismatch, 2 if the capture cannot
+   be read.  Frequency coalescing and transceive broadcasts depend on timing
+   (and on the front panel, which is not captured), so replay such captures at
+   speed 1.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "IC746.h"
+#include "CATRecorder.h"
+#include "EmuRig.h"
+
+#define REPLAY_FRAME_LENGTH  64
+
+//
+// ReplayTransport - the capture's RX bytes in, the engine's TX bytes split into frames out
+//
+class ReplayTransport : public CATTransport {
+  public:
+    byte rx[CAT_REC_MAX_DATA];
+    int rxHead = 0;
+    int rxCount = 0;
+    byte frame[REPLAY_FRAME_LENGTH];
+    int frameLen = 0;
+    boolean frameDone = false;
+
+    void begin(long baudrate, int mode) { (void)baudrate; (void)mode; }
+    int available() { return rxCount - rxHead; }
+    int read() { return rxHead < rxCount ? rx[rxHead++] : -1; }
+    int availableForWrite() { return frameDone ? 0 : REPLAY_FRAME_LENGTH; }   // one frame at a time
+
+    void write(byte b) {
+      if (frameLen < REPLAY_FRAME_LENGTH) frame[frameLen++] = b;
+      if (b == CAT_EOM) frameDone = true;
+    }
+
+    void push(const CATRecord &r) {
+      memcpy(rx, r.data, r.len);
+      rxHead = 0;
+      rxCount = r.len;
+    }
+};
+
+//
+// FrameReader - the recorded TX bytes, frame by frame
+//
+class FrameReader {
+  public:
+    std::vector<byte> bytes;
+    byte frame[REPLAY_FRAME_LENGTH];
+    int len = 0;
+
+    boolean next() {                 // the next recorded frame, false at the end
+      if (pos >= bytes.size()) return false;
+      len = 0;
+      while (pos < bytes.size()) {
+        byte b = bytes[pos++];
+        if (len < REPLAY_FRAME_LENGTH) frame[len++] = b;
+        if (b == CAT_EOM) break;
+      }
+      return true;
+    }
+
+  private:
+    size_t pos = 0;
+};
+
+// A chunk of commands, with the time it is due at
+struct Chunk {
+  double due;                        // us from the start of the capture
+  CATRecord r;
+};
+
+static EmuRig rig;
+static ReplayTransport wire;
+static FrameReader expected;
+static byte lastCmd[REPLAY_FRAME_LENGTH];
+static int lastCmdLen = 0;
+static long frames = 0;
+static long commands = 0;
+static boolean verbose = false;
+
+static void printFrame(const char *label, const byte *d, int n) {
+  printf("%-9s", label);
+  for (int i = 0; i < n; i++) printf(" %02X", d[i]);
+  printf("\n");
+}
+
+//
+// compare() - check the frame the engine just sent against the recording, false on mismatch
+//
+static boolean compare() {
+  if (!expected.next()) {
+    printf("frame %ld: not in the capture\n", frames + 1);
+    printFrame("command", lastCmd, lastCmdLen);
+    printFrame("sent", wire.frame, wire.frameLen);
+    return false;
+  }
+  frames++;
+  if (verbose) printFrame("frame", wire.frame, wire.frameLen);
+  if (expected.len != wire.frameLen || memcmp(expected.frame, wire.frame, wire.frameLen) != 0) {
+    printf("frame %ld: mismatch\n", frames);
+    printFrame("command", lastCmd, lastCmdLen);
+    printFrame("recorded", expected.frame, expected.len);
+    printFrame("sent", wire.frame, wire.frameLen);
+    return false;
+  }
+  wire.frameLen = 0;
+  wire.frameDone = false;
+  return true;
+}
+
+//
+// run() - let the engine work until it has nothing left to do, false on mismatch
+//
+static boolean run() {
+  for (;;) {
+    int waiting = rig.radio.check();
+    if (wire.frameDone) {
+      if (!compare()) return false;
+      continue;
+    }
+    if (!waiting && !wire.available() && !rig.radio.txPending()) return true;
+  }
+}
+
+// Remember the last command seen, for the mismatch report
+static void noteCommands(const CATRecord &r) {
+  for (int i = 0; i < r.len; i++) {
+    if (r.data[i] == CAT_PREAMBLE && (lastCmdLen == 0 || lastCmd[lastCmdLen - 1] == CAT_EOM)) lastCmdLen = 0;
+    if (lastCmdLen < REPLAY_FRAME_LENGTH) lastCmd[lastCmdLen++] = r.data[i];
+    if (r.data[i] == CAT_EOM) commands++;
+  }
+}
+
+// Options from the capture header and the command line: -s, -t, -c ms, -P link
+static boolean rigOption(char **argv, int &i, int argc, boolean &shadow, boolean &transceive, unsigned int &coalesce,
+                         int &link) {
+  if (strcmp(argv[i], "-P") == 0 && i + 1 < argc && linkProfile(argv[i + 1]) >= 0) {
+    link = linkProfile(argv[++i]);
+  } else if (strcmp(argv[i], "-s") == 0) {
+    shadow = true;
+  } else if (strcmp(argv[i], "-t") == 0) {
+    transceive = true;
+  } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+    coalesce = atoi(argv[++i]);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  const char *path = NULL;
+  double speed = 0;
+  boolean shadow = false, transceive = false;
+  unsigned int coalesce = 0;
+  int link = CAT_LINK_CIV;
+  char info[256];
+  char *words[32];
+  int nWords = 0;
+  CATRecord r;
+  FILE *f;
+
+  for (int i = 1; i < argc; i++) {
+    if (rigOption(argv, i, argc, shadow, transceive, coalesce, link)) continue;
+    if (strcmp(argv[i], "-x") == 0 && i + 1 < argc) {
+      speed = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-v") == 0) {
+      verbose = true;
+    } else if (argv[i][0] != '-' && !path) {
+      path = argv[i];
+    } else {
+      path = NULL;
+      break;
+    }
+  }
+  if (!path) {
+    fprintf(stderr, "usage: %s [-x speed] [-s] [-t] [-c ms] [-P link] [-v] capture\n", argv[0]);
+    return 2;
+  }
+  if (!(f = fopen(path, "rb"))) {
+    perror(path);
+    return 2;
+  }
+  if (!catReadCaptureHeader(f, info, sizeof(info))) {
+    fprintf(stderr, "%s: not a CI-V capture\n", path);
+    return 2;
+  }
+
+  for (char *w = strtok(info, " "); w && nWords < 32; w = strtok(NULL, " ")) words[nWords++] = w;
+  for (int i = 0; i < nWords; i++) rigOption(words, i, nWords, shadow, transceive, coalesce, link);
+  printf("replaying %s:%s%s", path, shadow ? " -s" : "", transceive ? " -t" : "");
+  if (coalesce) printf(" -c %u", coalesce);
+  if (link == CAT_LINK_USB) printf(" -P usb");
+  if (link == CAT_LINK_HAMLIB) printf(" -P hamlib");
+  if (speed > 0) {
+    printf(", speed x%g\n", speed);
+  } else {
+    printf(", full speed\n");
+  }
+
+  rig.verbose = verbose;
+  rig.setup(shadow, transceive, coalesce);
+  rig.radio.begin(wire, link);
+
+  // the whole capture up front - the responses are recorded after the commands they answer
+  std::vector<Chunk> chunks;
+  double due = 0;
+  while (catReadRecord(f, r)) {
+    due += r.dt;
+    if (r.dir == CAT_TRC_TX) {
+      expected.bytes.insert(expected.bytes.end(), r.data, r.data + r.len);
+    } else if (r.dir == CAT_TRC_RX) {
+      chunks.push_back(Chunk{due, r});
+    }
+  }
+  fclose(f);
+
+  unsigned long start = micros();
+  boolean ok = true;
+
+  for (size_t c = 0; ok && c < chunks.size(); c++) {
+    if (speed > 0) {                 // keep the engine running while waiting, as the main loop would
+      while (ok && (micros() - start) * speed < chunks[c].due) ok = run();
+      if (!ok) break;
+    }
+    noteCommands(chunks[c].r);
+    wire.push(chunks[c].r);
+    ok = run();
+  }
+
+  unsigned long us = micros() - start;
+  if (ok) ok = run();
+  if (ok && expected.next()) {
+    printf("frame %ld: recorded but not sent\n", frames + 1);
+    printFrame("recorded", expected.frame, expected.len);
+    ok = false;
+  }
+
+  printf("%ld commands, %ld frames compared, %s\n", commands, frames, ok ? "all match" : "MISMATCH");
+  printf("%.3f ms, %.0f commands/s\n", us / 1000.0, us ? commands * 1e6 / us : 0.0);
+  return ok ? 0 : 1;
+}
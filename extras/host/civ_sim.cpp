@@ -0,0 +1,707 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   civ_sim - virtual time simulation of a CAT program polling the library
+
+   Runs the real IC746 engine and the emulated rig (EmuRig.h) against a
+   simulated controller over a simulated serial line, in virtual time: every
+   byte takes its time on the wire at the chosen baud rate and framing, the
+   sketch's loop() calls check() once per loop period, and the controller waits
+   for the echo and the response of a command, plus its own turnaround time,
+   before sending the next.  The same options always give the same numbers.
+
+     civ_sim [-m mix] [-n cycles] [-b baud] [-f 8N2] [-L us] [-t us] [-p n]
+             [-i ms] [-T ms] [-P link] [-a | -r baud] [-e n] [-d us] [-A] [-g us] [-x] [-k] [-s]
+             [-M ms]
+
+     -m  poll mix (PollMixes.h): hamlib, wsjtx, omnirig, flrig, tune, split, split25, memory,
+         band, bandstack
+         (default wsjtx)
+     -n  times the mix is polled (default 100)
+     -b  baud rate (default 9600)
+     -f  framing, data bits / parity / stop bits (default 8N2)
+     -L  main loop period of the sketch, us - how often check() runs (default 200)
+     -t  controller turnaround, us from a response to its next command (default 1000)
+     -p  commands the controller sends before waiting for the responses (default 1)
+     -i  poll interval, ms from the start of one cycle to the next (default 0 - back to back)
+     -T  controller timeout, ms (default 200)
+     -P  link profile - civ (default), usb (no echo) or hamlib
+     -a  the rig starts with CAT_BAUD_AUTO and has to find the controller's rate
+     -r  the rig runs at this rate, whatever the controller uses
+     -e  line noise - one byte in n sent to the rig is lost (default 0 - none)
+     -d  the sketch's set frequency takes this long, us - a slow retune (default 0)
+     -A  the retune runs in the background, the ACK is deferred (deferAck / completeAck)
+     -g  the sketch's get functions take this long, us - a slow I2C read (default 0)
+     -x  receive from the RX interrupt (useExternalRx), not from check()
+     -k  the sketch calls servicePtt() every millisecond of a retune
+     -s  answer polls from the shadow registers
+     -M  memory channels in a 1 KB EEPROM, 3.3 ms a byte - written channels wait ms (CATMemory)
+
+   Prints the end-to-end latency of each command of the mix - first bit of
+   the command on the wire to the last bit of its response - the time a whole
+   poll cycle takes, and how busy each direction of the line was.  On a one
+   wire CI-V bus both directions share the wire, the sum has to stay well
+   under 100%.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <queue>
+#include <vector>
+
+#include "IC746.h"
+#include "CATMemStorage.h"
+#include "EmuRig.h"
+#include "PollMixes.h"
+
+#define SIM_UART_BUF_LENGTH  64     // receive and transmit buffers of the AVR HardwareSerial
+#define SIM_EEPROM_WRITE_US  3300   // AVR EEPROM byte write
+
+typedef unsigned long long Ns;
+#define NEVER   (~0ULL)
+
+// Virtual time, nanoseconds
+static Ns now = 0;
+
+static unsigned long long simMicros() {
+  return now / 1000;
+}
+
+//
+// Events
+//
+enum EventKind { RIG_RX, CTRL_RX, RIG_TX_DONE, LOOP, CTRL_SEND, CTRL_TIMEOUT, RIG_DONE };
+
+struct Event {
+  Ns t;
+  unsigned long seq;                // FIFO order for events at the same time
+  EventKind kind;
+  unsigned long arg;                // the byte for RIG_RX / CTRL_RX, the command for CTRL_TIMEOUT
+  bool operator<(const Event &e) const { return t != e.t ? t > e.t : seq > e.seq; }
+};
+
+static std::priority_queue<Event> events;
+static unsigned long eventSeq = 0;
+
+static void schedule(Ns t, EventKind kind, unsigned long arg = 0) {
+  events.push(Event{t, eventSeq++, kind, arg});
+}
+
+//
+// Character framing, from -f
+//
+static int dataBits = 8;
+static char parity = 'N';
+static int stopBits = 2;
+
+static int charBits() {
+  return 1 + dataBits + (parity != 'N') + stopBits;
+}
+
+// Level of bit i of a character, start bit first
+static int bitLevel(byte b, int i) {
+  if (i == 0) return 0;
+  if (i <= dataBits) return (b >> (i - 1)) & 1;
+  if (i == dataBits + 1 && parity != 'N') {
+    int ones = 0;
+    for (int j = 0; j < dataBits; j++) ones += (b >> j) & 1;
+    return parity == 'E' ? ones & 1 : !(ones & 1);
+  }
+  return 1;
+}
+
+//
+// Line - one direction of the serial line, a character at a time
+//
+// When sender and receiver are on the same rate each byte simply arrives when its
+// last bit is out.  When the rates can differ (-a, -r) the receiver is a UART of its
+// own: it waits for a falling edge, samples the middle of each of its bit times and
+// reads whatever the line holds - the garbage a real UART makes of a mismatched rate.
+//
+struct Span {                       // one character on the wire
+  Ns start;
+  Ns bitNs;
+  byte b;
+};
+
+struct Line {
+  EventKind arrival;                // event that delivers a received byte
+  Ns bitNs;                         // sender's bit time
+  Ns rxBitNs;                       // receiver's bit time
+  boolean sampled = false;          // decode the waveform instead of passing bytes
+  Ns freeAt = 0;                    // when the last queued byte is out
+  unsigned long bytes = 0;
+  unsigned long framingErrors = 0;
+  unsigned long loseEvery = 0;      // -e
+  unsigned long lost = 0;
+  unsigned long seed = 1;
+  Ns busy = 0;
+  std::deque<Span> wave;            // characters the receiver has not finished with
+  Ns cursor = 0;                    // the receiver looks for a start bit from here
+
+  Ns send(byte b) {                 // returns when the byte starts
+    Ns start = freeAt > now ? freeAt : now;
+    Ns charNs = charBits() * bitNs;
+    freeAt = start + charNs;
+    bytes++;
+    busy += charNs;
+    if (loseEvery && lose()) {       // on the wire, but the receiver never sees it
+      lost++;
+    } else if (sampled) {
+      wave.push_back(Span{start, bitNs, b});
+      decode(freeAt);
+    } else {
+      schedule(freeAt, arrival, b);
+    }
+    return start;
+  }
+
+  boolean lose() {                  // the same bytes on every run
+    seed = seed * 1103515245UL + 12345UL;
+    return (seed >> 16) % loseEvery == 0;
+  }
+
+  int level(Ns t) {
+    for (const Span &s : wave) {
+      if (t < s.start) break;
+      if (t < s.start + charBits() * s.bitNs) return bitLevel(s.b, int((t - s.start) / s.bitNs));
+    }
+    return 1;                       // idle
+  }
+
+  // First time at or after t the line is at the given level, NEVER if not on the wire yet
+  Ns find(Ns t, int lvl) {
+    if (lvl == 1 && level(t)) return t;
+    for (const Span &s : wave) {
+      for (int i = 0; i < charBits(); i++) {
+        Ns end = s.start + (i + 1) * s.bitNs;
+        if (end <= t || bitLevel(s.b, i) != lvl) continue;
+        Ns from = s.start + i * s.bitNs;
+        return from > t ? from : t;
+      }
+    }
+    return NEVER;
+  }
+
+  // Receive every character whose last sample is at or before upto - the line is
+  // known up to the later of now and freeAt, nothing sent later can start earlier
+  void decode(Ns upto) {
+    for (;;) {
+      Ns t0 = find(cursor, 0);
+      if (t0 == NEVER) break;
+      Ns stop = t0 + (1 + dataBits + (parity != 'N')) * rxBitNs + rxBitNs / 2;
+      if (stop > upto) break;
+      if (level(t0 + rxBitNs / 2)) {          // too short for a start bit
+        cursor = t0 + rxBitNs / 2;
+        continue;
+      }
+      byte v = 0;
+      for (int j = 0; j < dataBits; j++) {
+        if (level(t0 + (1 + j) * rxBitNs + rxBitNs / 2)) v |= 1 << j;
+      }
+      schedule(stop > now ? stop : now, arrival, v);
+      cursor = stop;
+      if (!level(stop)) {                     // framing error - no new start until the line goes high
+        framingErrors++;
+        Ns high = find(stop, 1);
+        if (high == NEVER) break;
+        cursor = high;
+      }
+    }
+    while (!wave.empty() && wave.front().start + charBits() * wave.front().bitNs <= cursor) wave.pop_front();
+  }
+};
+
+static Line toRig, toCtrl;
+static boolean rigRateFollows = false;   // the sketch sets the rig's rate, -a / -r
+static Ns lockedAt = 0;                  // when automatic baud rate locked
+
+//
+// SimTransport - the sketch's UART
+//
+class SimTransport : public CATTransport {
+  public:
+    std::deque<byte> rx;
+    int txQueued = 0;               // written, not yet completely sent
+    unsigned long overruns = 0;
+
+    long rate = 0;
+
+    void begin(long baudrate, int mode) {
+      (void)mode;                   // the framing is -f for both ends
+      rate = baudrate;
+      if (!rigRateFollows) return;
+      toRig.rxBitNs = toCtrl.bitNs = 1000000000ULL / baudrate;
+    }
+
+    int available() { return (int)rx.size(); }
+
+    int read() {
+      if (rx.empty()) return -1;
+      byte b = rx.front();
+      rx.pop_front();
+      return b;
+    }
+
+    void write(byte b) {
+      txQueued++;
+      toCtrl.send(b);
+      schedule(toCtrl.freeAt, RIG_TX_DONE);
+    }
+
+    int availableForWrite() { return SIM_UART_BUF_LENGTH - txQueued; }
+
+    void arrive(byte b) {
+      if (rx.size() >= SIM_UART_BUF_LENGTH) {
+        overruns++;
+        return;
+      }
+      rx.push_back(b);
+    }
+};
+
+static SimTransport uart;
+
+//
+// The controller
+//
+struct Pending {
+  unsigned long id;
+  int cmd;                          // index in the mix
+  Ns start;                         // first bit on the wire
+  boolean echoed;
+};
+
+struct Stats {
+  unsigned long count = 0;
+  Ns total = 0, min = ~0ULL, max = 0;
+
+  void add(Ns t) {
+    count++;
+    total += t;
+    if (t < min) min = t;
+    if (t > max) max = t;
+  }
+};
+
+static Mix mix;
+static std::vector<Stats> byCommand;
+static Stats cycles;
+static std::deque<Pending> inFlight;
+static unsigned long nextId = 0;
+static int nextCmd = 0;             // next command of the current cycle
+static int cyclesLeft;
+static Ns cycleStart;
+static byte rxFrame[POLL_FRAME_LENGTH + 3];
+static int rxLen = 0;
+static unsigned long timeouts = 0;
+static unsigned long nacks = 0;
+static unsigned long echoBytes = 0;
+
+static Ns turnaroundNs = 1000000;
+static Ns intervalNs = 0;
+static Ns timeoutNs = 200000000;
+static int window = 1;
+static std::deque<Ns> pttEom;       // when the PTT set commands in flight reach the rig
+
+static void endCycle();
+
+// Send commands of the cycle until the window is full
+static void ctrlSend() {
+  while ((int)inFlight.size() < window && nextCmd < (int)mix.frames.size()) {
+    const Frame &f = mix.frames[nextCmd];
+    Pending p = {nextId++, nextCmd++, 0, false};
+
+    p.start = toRig.send(CAT_PREAMBLE);
+    toRig.send(CAT_PREAMBLE);
+    for (int i = 0; i < f.len; i++) toRig.send(f.data[i]);
+    toRig.send(CAT_EOM);
+    if (p.cmd == 0) cycleStart = p.start;
+    if (f.len == pttOn.len && f.data[2] == CAT_PTT) pttEom.push_back(toRig.freeAt);
+    inFlight.push_back(p);
+    schedule(toRig.freeAt + timeoutNs, CTRL_TIMEOUT, p.id);
+  }
+}
+
+// A command is done, answered or given up on
+static void ctrlDone() {
+  if (!inFlight.empty() || nextCmd < (int)mix.frames.size()) {
+    schedule(now + turnaroundNs, CTRL_SEND);
+  } else {
+    endCycle();
+  }
+}
+
+static void endCycle() {
+  cycles.add(now - cycleStart);
+  if (--cyclesLeft <= 0) return;
+  nextCmd = 0;
+  if (intervalNs && cycleStart + intervalNs > now + turnaroundNs) {
+    schedule(cycleStart + intervalNs, CTRL_SEND);
+  } else {
+    schedule(now + turnaroundNs, CTRL_SEND);
+  }
+}
+
+static boolean isEcho(const Pending &p) {
+  const Frame &f = mix.frames[p.cmd];
+  return rxLen == f.len + 3 && memcmp(&rxFrame[2], f.data, f.len) == 0;
+}
+
+// An ACK / NACK, or a response to this command - anything else is left for the timeout
+// (the library sends ACK and NACK with the addresses the other way round, as V1.3 did).
+// An ACK / NACK answers the oldest command in flight, a response the oldest with its opcode -
+// a deferred ACK lets the polls behind it be answered first.
+static boolean isAnswer(const Pending &p) {
+  const Frame &f = mix.frames[p.cmd];
+  if (rxLen < CAT_FRAME_OVERHEAD + 3) return false;
+  if (rxFrame[4] == CAT_ACK || rxFrame[4] == CAT_NACK) return true;
+  return rxFrame[2] == CAT_CTRL_ADDR && rxFrame[3] == CAT_RIG_ADDR && rxFrame[4] == f.data[2];
+}
+
+static void ctrlReceive(byte b) {
+  if (rxLen < (int)sizeof(rxFrame)) rxFrame[rxLen++] = b;
+  if (b != CAT_EOM) return;
+
+  for (auto p = inFlight.begin(); p != inFlight.end(); ++p) {
+    if (!p->echoed && isEcho(*p)) {    // our own command coming back
+      p->echoed = true;
+      echoBytes += rxLen;
+      break;
+    } else if (isAnswer(*p)) {
+      if (rxFrame[4] == CAT_NACK) nacks++;
+      byCommand[p->cmd].add(now - p->start);
+      inFlight.erase(p);
+      ctrlDone();
+      break;
+    }
+  }
+  rxLen = 0;
+}
+
+static void ctrlTimeout(unsigned long id) {
+  for (auto p = inFlight.begin(); p != inFlight.end(); ++p) {
+    if (p->id != id) continue;
+    timeouts++;
+    inFlight.erase(p);
+    rxLen = 0;
+    ctrlDone();
+    return;
+  }
+}
+
+//
+// The sketch - a rig whose retune takes time, on an RX interrupt or not
+//
+static Ns retuneNs = 0;
+static Ns readNs = 0;
+static boolean asyncRetune = false;
+static boolean interruptRx = false;
+static boolean pollPtt = false;
+static Stats pttStats[2];           // unkey, key
+
+static void runEvent(const Event &e);
+
+class SimRig : public EmuRig {
+  public:
+    void setFreq(CATFreq f) {
+      EmuRig::setFreq(f);
+#if CAT_FEATURE_ASYNC
+      if (asyncRetune && retuneNs && radio.deferAck()) {
+        schedule(now + retuneNs, RIG_DONE);
+        return;
+      }
+#endif
+      busyFor(retuneNs);
+    }
+
+    boolean getFreq(CATFreq &f) {
+      busyFor(readNs);
+      return EmuRig::getFreq(f);
+    }
+
+    boolean getMode(byte &m) {
+      busyFor(readNs);
+      return EmuRig::getMode(m);
+    }
+
+    boolean getPtt(boolean &tx) {
+      busyFor(readNs);
+      return EmuRig::getPtt(tx);
+    }
+
+    void setPtt(boolean tx) {
+      EmuRig::setPtt(tx);
+      if (!pttEom.empty()) {
+        pttStats[tx].add(now - pttEom.front());
+        pttEom.pop_front();
+      }
+    }
+
+    // The main loop is stuck here - the line, the controller and the RX interrupt carry on
+    void busyFor(Ns ns) {
+      Ns end = now + ns;
+      boolean loopDue = false;
+
+      while (now < end) {
+        Ns step = pollPtt && end - now > 1000000 ? now + 1000000 : end;
+        while (!events.empty() && events.top().t <= step) {
+          Event e = events.top();
+          events.pop();
+          now = e.t;
+          if (e.kind == LOOP) {
+            loopDue = true;
+          } else {
+            runEvent(e);
+          }
+        }
+        now = step;
+#if CAT_FEATURE_PTT_PRIORITY
+        if (pollPtt) radio.servicePtt();
+#endif
+      }
+      if (loopDue) schedule(now, LOOP);
+    }
+};
+
+static SimRig rig;
+
+//
+// The EEPROM - the memory channels wait for it only when they must
+//
+class SimStorage : public CATMemStorage {
+  public:
+    Ns stalled = 0;
+
+    SimStorage() : CATMemStorage(CAT_MEM_STORAGE_SIZE, SIM_EEPROM_WRITE_US) {}
+
+    void wait() {
+      Ns ns = busyFor() * 1000ULL;
+      stalled += ns;
+      rig.busyFor(ns);
+    }
+};
+
+static SimStorage eeprom;
+
+static void runEvent(const Event &e) {
+  switch (e.kind) {
+    case RIG_RX:
+      if (interruptRx) {
+        rig.radio.receive(byte(e.arg));
+      } else {
+        uart.arrive(byte(e.arg));
+      }
+      break;
+    case CTRL_RX:
+      ctrlReceive(byte(e.arg));
+      break;
+    case RIG_TX_DONE:
+      uart.txQueued--;
+      break;
+    case CTRL_SEND:
+      ctrlSend();
+      break;
+    case CTRL_TIMEOUT:
+      ctrlTimeout(e.arg);
+      break;
+    case RIG_DONE:
+#if CAT_FEATURE_ASYNC
+      rig.radio.completeAck();
+#endif
+      break;
+    case LOOP:
+      break;
+  }
+}
+
+static boolean parseFraming(const char *s) {
+  if (strlen(s) != 3 || s[0] < '5' || s[0] > '8' || !strchr("NEO", s[1]) || (s[2] != '1' && s[2] != '2')) return false;
+  dataBits = s[0] - '0';
+  parity = s[1];
+  stopBits = s[2] - '0';
+  return true;
+}
+
+int main(int argc, char **argv) {
+  const char *mixName = "wsjtx";
+  const char *framing = "8N2";
+  long baud = 9600;
+  long rigBaud = 0;
+  boolean autoBaud = false;
+  int cyclesWanted = 100;
+  Ns loopNs = 200000;
+  boolean shadow = false;
+  boolean found = false;
+  int link = CAT_LINK_CIV;
+  long memDelay = -1;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+      mixName = argv[++i];
+    } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      cyclesWanted = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+      baud = atol(argv[++i]);
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      rigBaud = atol(argv[++i]);
+    } else if (strcmp(argv[i], "-a") == 0) {
+      autoBaud = true;
+    } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+      framing = argv[++i];
+    } else if (strcmp(argv[i], "-L") == 0 && i + 1 < argc) {
+      loopNs = atol(argv[++i]) * 1000ULL;
+    } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      turnaroundNs = atol(argv[++i]) * 1000ULL;
+    } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+      window = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+      intervalNs = atol(argv[++i]) * 1000000ULL;
+    } else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+      timeoutNs = atol(argv[++i]) * 1000000ULL;
+    } else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc) {
+      link = linkProfile(argv[++i]);
+    } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+      toRig.loseEvery = atol(argv[++i]);
+    } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+      retuneNs = atol(argv[++i]) * 1000ULL;
+    } else if (strcmp(argv[i], "-A") == 0) {
+      asyncRetune = true;
+    } else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+      readNs = atol(argv[++i]) * 1000ULL;
+    } else if (strcmp(argv[i], "-x") == 0) {
+      interruptRx = true;
+    } else if (strcmp(argv[i], "-k") == 0) {
+      pollPtt = true;
+    } else if (strcmp(argv[i], "-s") == 0) {
+      shadow = true;
+    } else if (strcmp(argv[i], "-M") == 0 && i + 1 < argc) {
+      memDelay = atol(argv[++i]);
+    } else {
+      argc = 0;
+      break;
+    }
+  }
+  for (const Mix &m : pollMixes()) {
+    if (strcmp(m.name, mixName) == 0) {
+      mix = m;
+      found = true;
+    }
+  }
+  if (!argc || !found || baud <= 0 || cyclesWanted < 1 || window < 1 || loopNs == 0 || link < 0 || rigBaud < 0 ||
+      memDelay > 65535 || !parseFraming(framing)) {
+    fprintf(stderr, "usage: %s [-m hamlib|wsjtx|omnirig|flrig|tune|split|split25|memory|band|bandstack]\n"
+                    "       [-n cycles] [-b baud] [-f 8N2] [-L loop us] [-t turnaround us] [-p in flight]\n"
+                    "       [-i interval ms] [-T timeout ms] [-P civ|usb|hamlib] [-a | -r baud]\n"
+                    "       [-e n] [-d retune us] [-A] [-g read us] [-x] [-k] [-s] [-M write delay ms]\n", argv[0]);
+    return 1;
+  }
+
+  toRig.arrival = RIG_RX;
+  toCtrl.arrival = CTRL_RX;
+  toRig.bitNs = toRig.rxBitNs = toCtrl.bitNs = toCtrl.rxBitNs = 1000000000ULL / baud;
+  rigRateFollows = toRig.sampled = toCtrl.sampled = autoBaud || rigBaud;
+  byCommand.resize(mix.frames.size());
+  cyclesLeft = cyclesWanted;
+
+  hostSetClock(simMicros);
+  rig.verbose = false;
+  rig.setup(shadow, false, 0);
+  rig.radio.begin(uart, autoBaud ? CAT_BAUD_AUTO : rigBaud ? rigBaud : baud, SERIAL_8N2, link);
+  rig.radio.useExternalRx(interruptRx);
+#if CAT_FEATURE_MEMORY
+  CATMemory memory(eeprom, memDelay < 0 ? 0 : (unsigned int)memDelay);
+  if (memDelay >= 0) rig.radio.setMemory(memory);
+#endif
+
+  schedule(0, LOOP);
+  schedule(0, CTRL_SEND);
+  while (!events.empty() && cyclesLeft > 0) {
+    Event e = events.top();
+    events.pop();
+    now = e.t;
+    switch (e.kind) {
+      case LOOP:
+        if (toRig.sampled) {                    // characters that ended in a quiet line
+          toRig.decode(now);
+          toCtrl.decode(now);
+        }
+        rig.radio.check();
+#if CAT_FEATURE_AUTOBAUD
+        if (autoBaud && !lockedAt && rig.radio.baudLocked()) lockedAt = now;
+#endif
+        schedule(now + loopNs, LOOP);
+        break;
+      default:
+        runEvent(e);
+        break;
+    }
+  }
+
+  printf("%ld baud %s (%.3f ms a byte), %s link, loop %.0f us, turnaround %.0f us, %d in flight, %s x %d\n\n",
+         baud, framing, charBits() * toRig.bitNs / 1e6, link == CAT_LINK_USB ? "usb" : link == CAT_LINK_HAMLIB ? "hamlib" : "civ",
+         loopNs / 1e3, turnaroundNs / 1e3, window, mix.name, cyclesWanted);
+  printf("%-20s %7s %9s %9s %9s\n", "command", "count", "mean ms", "min ms", "max ms");
+  for (size_t i = 0; i < mix.frames.size(); i++) {
+    char name[3 * POLL_FRAME_LENGTH];
+    const Stats &s = byCommand[i];
+    frameName(mix.frames[i], name);
+    if (!s.count) {
+      printf("%-20s %7d\n", name, 0);
+      continue;
+    }
+    printf("%-20s %7lu %9.3f %9.3f %9.3f\n", name, s.count, s.total / 1e6 / s.count, s.min / 1e6, s.max / 1e6);
+  }
+  if (cycles.count) {
+    printf("\npoll cycle %.3f ms mean, %.3f ms max\n", cycles.total / 1e6 / cycles.count, cycles.max / 1e6);
+  }
+  printf("line to rig %lu bytes, %.1f%% busy; to controller %lu bytes (%lu echo), %.1f%% busy; both %.1f%%\n",
+         toRig.bytes, 100.0 * toRig.busy / now, toCtrl.bytes, echoBytes, 100.0 * toCtrl.busy / now,
+         100.0 * (toRig.busy + toCtrl.busy) / now);
+  printf("%.3f s simulated, %lu timeouts, %lu NACKs, %lu bytes lost to UART overruns\n",
+         now / 1e9, timeouts, nacks, uart.overruns);
+  for (int tx = 1; tx >= 0; tx--) {
+    const Stats &s = pttStats[tx];
+    if (!s.count) continue;
+    printf("PTT %s %lu times, %.3f ms mean, %.3f ms max from the EOM to setPtt()\n",
+           tx ? "on " : "off", s.count, s.total / 1e6 / s.count, s.max / 1e6);
+  }
+  if (toRig.loseEvery) printf("%lu bytes lost on the line to the rig\n", toRig.lost);
+  if (rigRateFollows) {
+    printf("rig at %ld baud, %lu framing errors at the rig, %lu at the controller\n",
+           uart.rate, toRig.framingErrors, toCtrl.framingErrors);
+  }
+#if CAT_FEATURE_MEMORY
+  if (memDelay >= 0) {
+    printf("memory: %lu records written, %lu bytes, %lu writes coalesced, %u forced; busiest byte written %lu times;\n"
+           "        loop stalled %.3f ms by the EEPROM, %s still waiting\n",
+           memory.recordsWritten, eeprom.writes, memory.coalesced, memory.forced, eeprom.maxWear(),
+           eeprom.stalled / 1e6, memory.busy() ? "channels" : "nothing");
+  }
+#endif
+#if CAT_FEATURE_AUTOBAUD
+  if (autoBaud) {
+    if (rig.radio.baudLocked()) {
+      printf("automatic baud rate locked after %.3f s\n", lockedAt / 1e9);
+    } else {
+      printf("automatic baud rate not locked\n");
+    }
+  }
+#endif
+  return 0;
+}
@@ -0,0 +1,276 @@
+/*************************************************************************
+   IC746 CAT Library, by KK4DAS, Dean Souleles
+   ic746_pty - run the IC746 protocol engine as a Linux process
+
+   Creates a pseudo-terminal and answers CI-V commands on it with a simple
+   in-memory rig (two VFOs, mode, split, PTT, a sweeping S-meter).  Point
+   hamlib, WSJTX or flrig at the printed device (or at the -l symlink) and
+   select the ICOM IC-746.
+
+     ic746_pty [-l /tmp/ic746] [-s] [-t] [-c ms] [-P link] [-n rigs] [-T file] [-R file] [-M file]
+
+     -s  answer polls from the library's shadow registers instead of the handler
+     -t  transceive - broadcast frequency / mode changes made at the "front panel"
+     -c  coalesce set frequency commands, at most one retune per ms milliseconds
+     -P  link profile - civ (default), usb (no echo) or hamlib
+     -n  number of rigs, each with its own IC746 engine and pseudo-terminal
+         (symlinks /tmp/ic746, /tmp/ic746-2 ...)
+     -T  write the binary trace of rig 1 to file, decode it with cat_trace
+         (needs a build with -DCAT_FEATURE_TRACE=1)
+     -R  capture the CI-V bytes of rig 1 to file, replay it with civ_replay
+     -M  memory channels of rig 1 (08 - 0B, 1A 00), kept in file - a 1 KB EEPROM image
+
+   Built with -DCAT_FEATURE_METRICS=1 it prints each rig's metrics on exit.
+
+   The front panel is stdin, one command per line, optionally preceded by the rig number:
+     f <Hz>     tune the active VFO
+     m <mode>   select a mode, CI-V mode code in hex (00 LSB, 01 USB, 03 CW ...)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***************************************************************************/
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "IC746.h"
+#include "CATPtyTransport.h"
+#include "CATRecorder.h"
+#include "CATMemStorage.h"
+#include "EmuRig.h"
+
+#define MAX_RIGS  CAT_PTY_MAX_WAIT
+
+static volatile sig_atomic_t running = 1;
+
+//
+// Rig - one emulated rig on its own pseudo-terminal
+//
+class Rig : public EmuRig {
+  public:
+    CATPtyTransport pty;
+};
+
+static Rig rigs[MAX_RIGS];
+static int numRigs = 1;
+static CATRecorder recorder(rigs[0].pty);
+
+//
+// frontPanel() - local changes typed on stdin, for the rig number given (default 1)
+//
+static void frontPanel() {
+  static char line[64];
+  static int len = 0;
+  char c;
+
+  while (::read(0, &c, 1) == 1) {
+    if (c != '\n') {
+      if (len < (int)sizeof(line) - 1) line[len++] = c;
+      continue;
+    }
+    line[len] = 0;
+    len = 0;
+
+    char *p = line;
+    int n = (int)strtol(p, &p, 10);
+    while (*p == ' ') p++;
+    if (n < 1 || n > numRigs) n = 1;
+    Rig &rig = rigs[n - 1];
+
+    if (p[0] == 'f') {
+      rig.panelFreq(CATFreq(strtoull(p + 1, NULL, 10)));
+    } else if (p[0] == 'm') {
+      rig.panelMode(byte(strtol(p + 1, NULL, 16)));
+    }
+  }
+}
+
+#if CAT_FEATURE_METRICS
+//
+// printMetrics() - summary of a rig's metrics, printed on exit
+//
+static void printMetrics(Rig &rig) {
+  const CATMetrics &m = rig.radio.metrics();
+  unsigned long secs = (millis() - m.since) / 1000;
+
+  printf("%d: %lu commands in %lu s\n", rig.id, m.commands, secs);
+  for (int op = 0; op < CAT_METRICS_OPCODES; op++) {
+    if (m.byOpcode[op]) printf("   %02X  %6u  worst %5u us\n", op, m.byOpcode[op], m.worst[op]);
+  }
+  if (m.otherOpcodes) printf("   >%02X %6u\n", CAT_METRICS_OPCODES - 1, m.otherOpcodes);
+  printf("   latency us:");
+  for (int b = 0; b < CAT_METRICS_BUCKETS; b++) {
+    if (m.latency[b]) printf("  <%lu: %u", 1UL << b, m.latency[b]);
+  }
+  printf("\n   framing errors %u, RX overruns %u, TX drops %u, rejected %u\n",
+         m.rxErrors, m.rxOverruns, m.txDrops, m.rejects);
+#if CAT_FEATURE_PTT_PRIORITY
+  if (m.byOpcode[CAT_PTT]) printf("   PTT latency worst %lu us\n", rig.radio.pttLatencyMax());
+#endif
+}
+#endif
+
+static void stop(int sig) {
+  (void)sig;
+  running = 0;
+}
+
+int main(int argc, char **argv) {
+  const char *linkPath = NULL;
+  boolean shadow = false;
+  boolean transceive = false;
+  unsigned int coalesce = 0;
+  int profile = CAT_LINK_CIV;
+  CATPtyTransport *ports[MAX_RIGS];
+  FILE *traceFile = NULL;
+  const char *capturePath = NULL;
+#if CAT_FEATURE_MEMORY
+  const char *memoryPath = NULL;
+#endif
+  char options[64] = "";
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+      linkPath = argv[++i];
+    } else if (strcmp(argv[i], "-s") == 0) {
+      shadow = true;
+      strcat(options, " -s");
+    } else if (strcmp(argv[i], "-t") == 0) {
+      transceive = true;
+      strcat(options, " -t");
+    } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+      coalesce = atoi(argv[++i]);
+      snprintf(options + strlen(options), sizeof(options) - strlen(options), " -c %u", coalesce);
+#if CAT_FEATURE_TRACE
+    } else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+      if (!(traceFile = fopen(argv[++i], "wb"))) {
+        perror(argv[i]);
+        return 1;
+      }
+#endif
+    } else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc && linkProfile(argv[i + 1]) >= 0) {
+      profile = linkProfile(argv[++i]);
+      snprintf(options + strlen(options), sizeof(options) - strlen(options), " -P %s", argv[i]);
+    } else if (strcmp(argv[i], "-R") == 0 && i + 1 < argc) {
+      capturePath = argv[++i];
+#if CAT_FEATURE_MEMORY
+    } else if (strcmp(argv[i], "-M") == 0 && i + 1 < argc) {
+      memoryPath = argv[++i];
+#endif
+    } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      numRigs = atoi(argv[++i]);
+      if (numRigs < 1) numRigs = 1;
+      if (numRigs > MAX_RIGS) numRigs = MAX_RIGS;
+    } else {
+      fprintf(stderr, "usage: %s [-l symlink] [-s] [-t] [-c ms] [-P civ|usb|hamlib] [-n rigs] [-T file] [-R file] [-M file]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  // the rig options go in the capture, so the replay sets up the same rig
+  if (capturePath && !recorder.open(capturePath, options[0] ? options + 1 : "")) {
+    perror(capturePath);
+    return 1;
+  }
+
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+
+  for (int i = 0; i < numRigs; i++) {
+    Rig &rig = rigs[i];
+    char link[256];
+
+    // the first rig gets the symlink as given, the others a numbered one
+    if (linkPath && i > 0) {
+      snprintf(link, sizeof(link), "%s-%d", linkPath, i + 1);
+    } else if (linkPath) {
+      snprintf(link, sizeof(link), "%s", linkPath);
+    }
+    if (!rig.pty.open(linkPath ? link : NULL)) {
+      perror("ic746_pty: cannot create pseudo-terminal");
+      return 1;
+    }
+    rig.id = i + 1;
+    printf("IC746 %d listening on %s%s%s\n", rig.id, rig.pty.slaveName(),
+           linkPath ? " -> " : "", linkPath ? link : "");
+
+    rig.setup(shadow, transceive, coalesce);
+    if (i == 0 && capturePath) {
+      rig.radio.begin(recorder, profile);
+    } else {
+      rig.radio.begin(rig.pty, profile);
+    }
+    ports[i] = &rig.pty;
+  }
+#if CAT_FEATURE_MEMORY
+  CATMemStorage eeprom;
+  CATMemory memory(eeprom);
+  if (memoryPath) {
+    eeprom.load(memoryPath);
+    rigs[0].radio.setMemory(memory);
+    printf("IC746 1 memory channels in %s\n", memoryPath);
+  }
+#endif
+  fflush(stdout);
+
+  fcntl(0, F_SETFL, fcntl(0, F_GETFL) | O_NONBLOCK);
+
+  while (running) {
+    int queued = 0;
+    boolean txPending = false;
+
+    frontPanel();
+    for (int i = 0; i < numRigs; i++) {
+      queued += rigs[i].radio.check();
+      txPending |= rigs[i].radio.txPending() > 0;
+    }
+#if CAT_FEATURE_MEMORY
+    if (memoryPath && eeprom.dirty && !memory.busy()) eeprom.save(memoryPath);
+#endif
+#if CAT_FEATURE_TRACE
+    if (traceFile) {
+      byte records[CAT_TRACE_BUF_LENGTH];
+      int n;
+      while ((n = rigs[0].radio.traceRead(records, sizeof(records))) > 0) {
+        fwrite(records, 1, n, traceFile);
+      }
+    }
+#endif
+    if (queued == 0) {
+      fflush(stdout);
+      if (traceFile) fflush(traceFile);
+      CATPtyTransport::wait(ports, numRigs, txPending ? 1 : 20);   // idle - sleep until a client sends something
+    }
+  }
+
+#if CAT_FEATURE_MEMORY
+  if (memoryPath) {
+    memory.flush();                 // channels still waiting
+    if (eeprom.dirty && !eeprom.save(memoryPath)) perror(memoryPath);
+  }
+#endif
+  for (int i = 0; i < numRigs; i++) {
+#if CAT_FEATURE_METRICS
+    printMetrics(rigs[i]);
+#endif
+    rigs[i].pty.close();
+  }
+  if (traceFile) fclose(traceFile);
+  recorder.close();
+  return 0;
+}
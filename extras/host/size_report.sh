@@ -0,0 +1,63 @@
+#!/bin/sh
+#
+# IC746 CAT Library, by KK4DAS, Dean Souleles
+# size_report.sh - flash and RAM used by the library for each feature set
+#
+#   extras/host/size_report.sh [fqbn]      compile CATSize for a board with arduino-cli
+#                                          (default arduino:avr:nano)
+#   extras/host/size_report.sh --host      compile it with the host g++ -Os instead; the
+#                                          numbers are for comparing feature sets only
+#
+# Run from the library folder.  Each feature set is a list of IC746Config.h overrides.
+#
+
+LIB=$(pwd)
+SKETCH=$LIB/extras/host/CATSize
+OUT=${TMPDIR:-/tmp}/cat_size.$$
+FQBN=${1:-arduino:avr:nano}
+
+FEATURE_SETS="
+full|
+no-stubs|-DCAT_FEATURE_STUBS=0
+no-shadow|-DCAT_FEATURE_SHADOW=0 -DCAT_FEATURE_TRANSCEIVE=0
+no-transceive|-DCAT_FEATURE_TRANSCEIVE=0
+no-coalesce|-DCAT_FEATURE_COALESCE=0
+no-cache|-DCAT_FEATURE_RESPONSE_CACHE=0
+no-user-cmds|-DCAT_USER_COMMANDS=0
+no-memory|-DCAT_FEATURE_MEMORY=0
+no-bandstack|-DCAT_FEATURE_BANDSTACK=0
+small-rx-queue|-DCAT_RX_QUEUE_LENGTH=2
+freq-32|-DCAT_FREQ_BITS=32
+minimal|-DCAT_FEATURE_STUBS=0 -DCAT_FEATURE_SHADOW=0 -DCAT_FEATURE_TRANSCEIVE=0 -DCAT_FEATURE_COALESCE=0 -DCAT_FEATURE_RESPONSE_CACHE=0 -DCAT_USER_COMMANDS=0 -DCAT_FEATURE_MEMORY=0 -DCAT_FEATURE_BANDSTACK=0 -DCAT_RX_QUEUE_LENGTH=2
+"
+
+if [ "$FQBN" != "--host" ] && ! command -v arduino-cli > /dev/null; then
+  echo "size_report.sh: arduino-cli not found, use --host for a host build" >&2
+  exit 1
+fi
+
+mkdir -p "$OUT"
+trap 'rm -rf "$OUT"' EXIT
+
+# measure <flags> - prints "flash ram"
+measure() {
+  if [ "$FQBN" = "--host" ]; then
+    g++ -Os -ffunction-sections -fdata-sections -Wl,--gc-sections -DCAT_SIZE_HOST $1 \
+        -I "$LIB/extras/host" -I "$LIB" -o "$OUT/CATSize" -x c++ "$SKETCH/CATSize.ino" -x none \
+        "$LIB"/*.cpp "$LIB/extras/host/ArduinoHost.cpp" || return 1
+    size "$OUT/CATSize" | awk 'NR == 2 { print $1 + $2, $2 + $3 }'
+  else
+    arduino-cli compile -b "$FQBN" --library "$LIB" --build-path "$OUT/build" \
+        --build-property "compiler.cpp.extra_flags=$1" "$SKETCH" > "$OUT/log" 2>&1 || { cat "$OUT/log" >&2; return 1; }
+    awk '/Sketch uses/ { f = $3 } /Global variables use/ { r = $4 } END { print f, r }' "$OUT/log"
+  fi
+}
+
+printf "%-15s %8s %8s %8s %8s\n" "feature set" "flash" "delta" "ram" "delta"
+echo "$FEATURE_SETS" | while IFS='|' read -r name flags; do
+  [ -z "$name" ] && continue
+  sizes=$(measure "$flags") || exit 1
+  set -- $sizes
+  [ "$name" = "full" ] && { baseFlash=$1; baseRam=$2; }
+  printf "%-15s %8d %8d %8d %8d\n" "$name" "$1" $(($1 - baseFlash)) "$2" $(($2 - baseRam))
+done